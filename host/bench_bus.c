@@ -0,0 +1,235 @@
+/*!
+ * @file bench_bus.c
+ *
+ * Contention benchmark of the bus queue (ina234_bus.h) on the host. A simulated INA234 is read with ::INA234_acquire() at a fixed period
+ * through a critical client, while three other drivers share the bus with random arrivals, like their tasks and interrupts would:
+ *   high   : 2 byte register reads of another sensor
+ *   normal : 16 byte writes to a display or an IO expander
+ *   low    : EEPROM page writes (64 bytes by default)
+ * The completion interrupts are deferred by the bus time of the transfers (ina234_sim_bus::deferred), and the waits run
+ * ::INA234_Sim_idle(), so the transfers really overlap with the arrivals.
+ *
+ * It prints for each priority the number of the transactions, the missed deadlines and the errors, and the percentiles of the waits from
+ * the submission to the start (exact, and the p99 estimate of ::INA234_Bus_getWaitPercentile), then the latency of the monitoring reads
+ * from the call of ::INA234_acquire() to its return, all in simulated time.
+ *
+ * Build:
+ *   gcc -O2 -I. -I.. -o bench_bus bench_bus.c ina234_sim.c ../ina234_bus.c ../ina234.c -lm
+ *
+ * Usage:
+ *   bench_bus [-n reads] [-f i2c_frequency] [-p period_us] [-d deadline_us] [-e page_bytes] [-s seed]
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ina234_sim.h"
+#include "ina234_bus.h"
+
+#define BACKGROUND_CLIENTS			3
+#define MAX_PAGE								256
+
+/*!
+    @brief  One of the other drivers of the bus: it submits its transaction again after a random interval once the previous one is done
+*/
+typedef struct background{
+	INA234_BusTransaction		transaction;
+	double									mean_interval;					/*!< Mean of the exponential intervals (in us) */
+	double									next;										/*!< Virtual time of the next submission */
+} Background;
+
+static uint32_t __reads = 10000;
+static double __period = 1000.0;
+static uint32_t __deadline = 2000;
+static uint16_t __page = 64;
+static uint64_t __seed = 1;
+
+static INA234 ina234;
+static INA234_Sim sims[1 + BACKGROUND_CLIENTS];
+static INA234_Bus bus;
+static INA234_BusClient monitor;
+static Background background[BACKGROUND_CLIENTS];
+static uint8_t __buffers[BACKGROUND_CLIENTS][MAX_PAGE];
+
+static uint32_t* __waits[INA234_BUS_PRIORITIES];
+static uint32_t __wait_count[INA234_BUS_PRIORITIES];
+static uint32_t* __latencies;
+
+// The I2C callbacks of the application, forwarded to the queue
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef* hi2c){ INA234_Bus_onComplete(&bus, hi2c); }
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef* hi2c){ INA234_Bus_onComplete(&bus, hi2c); }
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef* hi2c){ INA234_Bus_onComplete(&bus, hi2c); }
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef* hi2c){ INA234_Bus_onComplete(&bus, hi2c); }
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef* hi2c){ INA234_Bus_onError(&bus, hi2c); }
+
+static uint32_t __simClock(void){
+	return (uint32_t)ina234_sim_bus.time_us;
+}
+
+static double __random(void){
+	// xorshift64*, so the runs are the same on every host for a seed
+	__seed ^= __seed >> 12;
+	__seed ^= __seed << 25;
+	__seed ^= __seed >> 27;
+	return ((__seed * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double __exponential(double mean){
+	return -mean * log(1.0 - __random());
+}
+
+/*!
+    @brief  Record the wait of each started transaction: the bus stats hold it when the transfer begins
+*/
+static void __eventHook(void* context, uint16_t DevAddress, EventType event, EventPhase phase, uint16_t argument){
+	(void)context;
+	(void)DevAddress;
+	(void)argument;
+	if(event != EVENT_BUS_TRANSFER || phase != PHASE_BEGIN)
+		return;
+
+	// The transfer that begins is the current one
+	BusPriority priority = bus.current->priority;
+	if(__wait_count[priority] < __reads * 8)
+		__waits[priority][__wait_count[priority]++] = bus.stats[priority].wait_last;
+}
+
+/*!
+    @brief  Submit the transactions of the other drivers that are due
+*/
+static void __background(void){
+	for(uint8_t i = 0; i < BACKGROUND_CLIENTS; i++){
+		Background* b = &background[i];
+		if(b->transaction.state == TRANSACTION_QUEUED || b->transaction.state == TRANSACTION_RUNNING || ina234_sim_bus.time_us < b->next)
+			continue;
+		INA234_Bus_submit(&bus, &b->transaction);
+		b->next = ina234_sim_bus.time_us + __exponential(b->mean_interval);
+	}
+}
+
+/*!
+    @brief  The idle function of the blocking waits: the other drivers keep running while the monitor waits
+*/
+static void __idle(void){
+	__background();
+	INA234_Sim_idle();
+}
+
+static void __setBackground(Background* b, BusOperation operation, BusPriority priority, uint16_t address, uint16_t MemAddress,
+														uint16_t MemAddSize, uint8_t* buffer, uint16_t size, double mean_interval){
+	memset(b, 0, sizeof(*b));
+	b->transaction.operation = operation;
+	b->transaction.priority = priority;
+	b->transaction.DevAddress = address << 1;
+	b->transaction.MemAddress = MemAddress;
+	b->transaction.MemAddSize = MemAddSize;
+	b->transaction.pData = buffer;
+	b->transaction.Size = size;
+	b->mean_interval = mean_interval;
+	b->next = __exponential(mean_interval);
+}
+
+static void __setup(void){
+	INA234_Sim_reset();
+	for(uint8_t i = 0; i <= BACKGROUND_CLIENTS; i++){
+		memset(&sims[i], 0, sizeof(sims[i]));
+		sims[i].shunt_mV = 10.0;
+		sims[i].bus_V = 12.0;
+		// The monitored INA234, another sensor, and stand-ins that acknowledge the writes of the display and the EEPROM
+		INA234_Sim_attach(&sims[i], &hi2c1, i == 0 ? 0x48 : i == 1 ? 0x41 : i == 2 ? 0x42 : 0x50);
+	}
+	memset(&ina234, 0, sizeof(ina234));
+	if(STATUS_OK != INA234_init(&ina234, 0x48, &hi2c1, 1, RANGE_20_48mV, NADC_1, CTIME_140us, CTIME_140us, MODE_CONTINUOUS_BOTH_SHUNT_BUS)){
+		fprintf(stderr, "INA234_init failed\n");
+		exit(1);
+	}
+	INA234_setClock(&ina234, __simClock);
+
+	INA234_Bus_init(&bus, &hi2c1, __simClock, 0);
+	bus.idle = __idle;
+	INA234_Bus_setEventHook(&bus, __eventHook, NULL);
+	INA234_BusClient_init(&monitor, &bus, BUS_PRIORITY_CRITICAL, __deadline);
+	INA234_Bus_attach(&ina234, &monitor);
+
+	__setBackground(&background[0], BUS_MEM_READ, BUS_PRIORITY_HIGH, 0x41, SHUNT_VOLTAGE_REGISTER, I2C_MEMADD_SIZE_8BIT, __buffers[0], 2, 2000.0);
+	__buffers[1][0] = 0x10;
+	__setBackground(&background[1], BUS_TRANSMIT, BUS_PRIORITY_NORMAL, 0x42, 0, I2C_MEMADD_SIZE_8BIT, __buffers[1], 16, 5000.0);
+	__setBackground(&background[2], BUS_MEM_WRITE, BUS_PRIORITY_LOW, 0x50, 0x0100, I2C_MEMADD_SIZE_16BIT, __buffers[2], __page, 10000.0);
+
+	ina234_sim_bus.deferred = 1;
+}
+
+static int __compare(const void* a, const void* b){
+	uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+	return (x > y) - (x < y);
+}
+
+static uint32_t __percentile(const uint32_t* values, uint32_t count, double percent){
+	if(!count)
+		return 0;
+	return values[(uint32_t)(percent / 100.0 * (count - 1) + 0.5)];
+}
+
+int main(int argc, char** argv){
+	static const char* names[INA234_BUS_PRIORITIES] = {"critical", "high", "normal", "low"};
+	INA234_Sample sample;
+	uint32_t failures = 0;
+
+	for(int i = 1; i + 1 < argc; i += 2){
+		if(!strcmp(argv[i], "-n"))
+			__reads = (uint32_t)atol(argv[i + 1]);
+		else if(!strcmp(argv[i], "-f"))
+			ina234_sim_bus.frequency = (uint32_t)atol(argv[i + 1]);
+		else if(!strcmp(argv[i], "-p"))
+			__period = atof(argv[i + 1]);
+		else if(!strcmp(argv[i], "-d"))
+			__deadline = (uint32_t)atol(argv[i + 1]);
+		else if(!strcmp(argv[i], "-e"))
+			__page = (uint16_t)atol(argv[i + 1]);
+		else if(!strcmp(argv[i], "-s"))
+			__seed = strtoull(argv[i + 1], NULL, 0) | 1;
+	}
+	if(__page > MAX_PAGE)
+		__page = MAX_PAGE;
+	uint32_t frequency = ina234_sim_bus.frequency;
+
+	__setup();
+	ina234_sim_bus.frequency = frequency;
+	for(uint8_t p = 0; p < INA234_BUS_PRIORITIES; p++)
+		__waits[p] = malloc(sizeof(uint32_t) * __reads * 8);
+	__latencies = malloc(sizeof(uint32_t) * __reads);
+
+	double start = ina234_sim_bus.time_us;
+	for(uint32_t i = 0; i < __reads; i++){
+		while(ina234_sim_bus.time_us < start + i * __period)
+			__idle();
+		double call = ina234_sim_bus.time_us;
+		if(STATUS_OK != INA234_acquire(&ina234, &sample))
+			failures++;
+		__latencies[i] = (uint32_t)(ina234_sim_bus.time_us - call);
+	}
+	double elapsed = ina234_sim_bus.time_us - start;
+
+	printf("%u monitoring reads every %.0fus with a %uus deadline, %u byte EEPROM pages, %u Hz I2C, bus busy %.1f%%\n",
+					(unsigned)__reads, __period, (unsigned)__deadline, (unsigned)__page, (unsigned)ina234_sim_bus.frequency,
+					100.0 * ina234_sim_bus.bits * 1e6 / ina234_sim_bus.frequency / elapsed);
+	for(uint8_t p = 0; p < INA234_BUS_PRIORITIES; p++){
+		INA234_BusStats* stats = &bus.stats[p];
+		qsort(__waits[p], __wait_count[p], sizeof(uint32_t), __compare);
+		printf("%-9s transactions %u, missed %u, errors %u\n", names[p], (unsigned)stats->transactions, (unsigned)stats->missed, (unsigned)stats->errors);
+		printf("  wait     p50 %u  p90 %u  p99 %u  max %u  (histogram p99 <= %u) (us)\n", (unsigned)__percentile(__waits[p], __wait_count[p], 50),
+						(unsigned)__percentile(__waits[p], __wait_count[p], 90), (unsigned)__percentile(__waits[p], __wait_count[p], 99),
+						(unsigned)stats->wait_max, (unsigned)INA234_Bus_getWaitPercentile(stats, 99));
+	}
+	qsort(__latencies, __reads, sizeof(uint32_t), __compare);
+	printf("monitor   %u failed reads\n", (unsigned)failures);
+	printf("  latency  p50 %u  p90 %u  p99 %u  max %u (us)\n", (unsigned)__percentile(__latencies, __reads, 50), (unsigned)__percentile(__latencies, __reads, 90),
+					(unsigned)__percentile(__latencies, __reads, 99), (unsigned)__percentile(__latencies, __reads, 100));
+
+	for(uint8_t p = 0; p < INA234_BUS_PRIORITIES; p++)
+		free(__waits[p]);
+	free(__latencies);
+	return 0;
+}
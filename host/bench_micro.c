@@ -0,0 +1,398 @@
+/*!
+ * @file bench_micro.c
+ *
+ * Microbenchmarks of the conversion and decode hot paths of the library, each next to its alternative implementations:
+ *   swap/...        byte order swap of __INA234_readTwoBytes (XOR swap of the library, temporary, shift/or, compiler builtin)
+ *   decode/...      raw I2C bytes to a shunt voltage (bitfield union + float scale of the library getters, shift/mask + float, shift/mask + fixed-point)
+ *   getter/...      scaling of a raw sample (float plan scale, ::INA234_Sample_getFixedQ8, ::INA234_Sample_getFixed)
+ *   alert/...       alert limit to register counts of INA234_alert_init (float division, float reciprocal, integer division)
+ *   calibration/... SHUNT_CAL of INA234_init (float division, integer division), and the whole __INA234_updatePlan
+ *
+ * Each benchmark is run over 1024 pseudo-random inputs, repeated until a run takes about 1ms. The median and the minimum of the runs
+ * are reported in ns per operation, with the relative spread (median absolute deviation / median) to tell if the machine was quiet.
+ *
+ * Build:
+ *   gcc -O2 -I. -I.. -o bench_micro bench_micro.c ina234_sim.c ../ina234.c -lm
+ * or, for several compilers and optimization levels:
+ *   ./bench_micro.sh
+ *
+ * Usage:
+ *   bench_micro [-r runs] [-o results.txt] [-b baseline.txt] [-t tolerance_percent]
+ *
+ * -o saves the results, and -b compares them with saved results: the program exits with 1 if the minimum of any benchmark is
+ * slower than its baseline by more than the tolerance (10% by default), so it can gate the regressions. Pin it to one core
+ * (taskset -c 2 ./bench_micro ...) and compare only the results of the same machine, compiler and flags.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ina234_sim.h"
+#include "ina234.h"
+
+#define INPUTS				1024
+#define RUN_TIME_NS		1000000
+#define RECHECKS			3
+
+// Keep a value alive without adding any instruction
+#define SINK(x)			__asm__ volatile("" : : "r"(x))
+#define OPAQUE(x)		__asm__ volatile("" : "+r"(x))
+
+typedef uint32_t (*BenchFunction)(uint32_t repeats);
+
+/*!
+    @brief  One microbenchmark and its result
+*/
+typedef struct bench{
+	const char*		name;
+	BenchFunction	function;
+	double				ns;				/*!< Median ns per operation */
+	double				min;			/*!< Fastest run, in ns per operation. Used for the regression gate, as it is the least sensitive to the noise. */
+	double				spread;		/*!< Median absolute deviation / median */
+} Bench;
+
+static uint8_t	__bytes[INPUTS][2];				// big endian register values, as received from I2C
+static INA234_Sample __samples[INPUTS];
+static float		__limits[INPUTS];					// alert limits in mV
+static int32_t	__limits_uv[INPUTS];			// the same in uV
+static float		__resistors[INPUTS];			// shunt resistors in Ohm
+static uint32_t	__resistors_mohm[INPUTS];	// the same in mOhm
+
+static INA234 ina234;
+
+// Byte swap -------------------------------------------------------------------
+static uint32_t __swapXor(uint32_t repeats){
+	for(uint32_t r = 0; r < repeats; r++)
+		for(uint32_t i = 0; i < INPUTS; i++){
+			ina234.reg.raw_data[0] = __bytes[i][0];
+			ina234.reg.raw_data[1] = __bytes[i][1];
+			__INA234_swapBytes(&ina234);
+			SINK(ina234.reg.power_register.POWER);
+		}
+	return repeats * INPUTS;
+}
+
+static uint32_t __swapTemp(uint32_t repeats){
+	for(uint32_t r = 0; r < repeats; r++)
+		for(uint32_t i = 0; i < INPUTS; i++){
+			ina234.reg.raw_data[0] = __bytes[i][1];
+			ina234.reg.raw_data[1] = __bytes[i][0];
+			SINK(ina234.reg.power_register.POWER);
+		}
+	return repeats * INPUTS;
+}
+
+static uint32_t __swapShift(uint32_t repeats){
+	for(uint32_t r = 0; r < repeats; r++)
+		for(uint32_t i = 0; i < INPUTS; i++){
+			uint16_t value = (uint16_t)((__bytes[i][0] << 8) | __bytes[i][1]);
+			SINK(value);
+		}
+	return repeats * INPUTS;
+}
+
+static uint32_t __swapBuiltin(uint32_t repeats){
+	for(uint32_t r = 0; r < repeats; r++)
+		for(uint32_t i = 0; i < INPUTS; i++){
+			uint16_t value;
+			memcpy(&value, __bytes[i], 2);
+			value = __builtin_bswap16(value);
+			SINK(value);
+		}
+	return repeats * INPUTS;
+}
+
+// Decode -----------------------------------------------------------------------
+static uint32_t __decodeBitfieldFloat(uint32_t repeats){
+	for(uint32_t r = 0; r < repeats; r++)
+		for(uint32_t i = 0; i < INPUTS; i++){
+			ina234.reg.raw_data[0] = __bytes[i][0];
+			ina234.reg.raw_data[1] = __bytes[i][1];
+			__INA234_swapBytes(&ina234);
+			float value = ina234.reg.shunt_voltage_register.VSHUNT * ina234.plan.shunt_voltage_lsb;
+			SINK(value);
+		}
+	return repeats * INPUTS;
+}
+
+static uint32_t __decodeShiftFloat(uint32_t repeats){
+	float lsb = ina234.plan.shunt_voltage_lsb;
+	for(uint32_t r = 0; r < repeats; r++)
+		for(uint32_t i = 0; i < INPUTS; i++){
+			int16_t raw = (int16_t)((__bytes[i][0] << 8) | __bytes[i][1]) >> 4;
+			float value = raw * lsb;
+			SINK(value);
+		}
+	return repeats * INPUTS;
+}
+
+static uint32_t __decodeShiftFixed(uint32_t repeats){
+	int32_t scale = __INA234_Q8(SHUNT_VOLTAGE_20_48mv_LSB);
+	OPAQUE(scale);
+	for(uint32_t r = 0; r < repeats; r++)
+		for(uint32_t i = 0; i < INPUTS; i++){
+			int32_t raw = (int16_t)((__bytes[i][0] << 8) | __bytes[i][1]) >> 4;
+			int32_t value = raw * scale;
+			SINK(value);
+		}
+	return repeats * INPUTS;
+}
+
+// Getters ----------------------------------------------------------------------
+static uint32_t __getterFloat(uint32_t repeats){
+	for(uint32_t r = 0; r < repeats; r++)
+		for(uint32_t i = 0; i < INPUTS; i++){
+			float value = __samples[i].current * ina234.plan.current_lsb;
+			SINK(value);
+		}
+	return repeats * INPUTS;
+}
+
+static uint32_t __getterFixedQ8(uint32_t repeats){
+	for(uint32_t r = 0; r < repeats; r++)
+		for(uint32_t i = 0; i < INPUTS; i++){
+			int32_t value = INA234_Sample_getFixedQ8(&__samples[i], CHANNEL_CURRENT);
+			SINK(value);
+		}
+	return repeats * INPUTS;
+}
+
+static uint32_t __getterFixed(uint32_t repeats){
+	for(uint32_t r = 0; r < repeats; r++)
+		for(uint32_t i = 0; i < INPUTS; i++){
+			int32_t value = INA234_Sample_getFixed(&__samples[i], CHANNEL_CURRENT);
+			SINK(value);
+		}
+	return repeats * INPUTS;
+}
+
+// Alert limit ------------------------------------------------------------------
+static uint32_t __alertFloatDivision(uint32_t repeats){
+	float lsb = ina234.plan.shunt_voltage_lsb;
+	OPAQUE(lsb);
+	for(uint32_t r = 0; r < repeats; r++)
+		for(uint32_t i = 0; i < INPUTS; i++){
+			int32_t value = (int32_t)(__limits[i] / lsb);
+			SINK(value);
+		}
+	return repeats * INPUTS;
+}
+
+static uint32_t __alertFloatReciprocal(uint32_t repeats){
+	float inverse = 1.0f / ina234.plan.shunt_voltage_lsb;
+	OPAQUE(inverse);
+	for(uint32_t r = 0; r < repeats; r++)
+		for(uint32_t i = 0; i < INPUTS; i++){
+			int32_t value = (int32_t)(__limits[i] * inverse);
+			SINK(value);
+		}
+	return repeats * INPUTS;
+}
+
+static uint32_t __alertInteger(uint32_t repeats){
+	int32_t lsb_uv = 10;
+	OPAQUE(lsb_uv);
+	for(uint32_t r = 0; r < repeats; r++)
+		for(uint32_t i = 0; i < INPUTS; i++){
+			int32_t value = __limits_uv[i] / lsb_uv;
+			SINK(value);
+		}
+	return repeats * INPUTS;
+}
+
+// Calibration ------------------------------------------------------------------
+static uint32_t __calibrationFloat(uint32_t repeats){
+	for(uint32_t r = 0; r < repeats; r++)
+		for(uint32_t i = 0; i < INPUTS; i++){
+			uint16_t value = (uint16_t)(20.48 / (CURRENT_LSB * __resistors[i]));
+			SINK(value);
+		}
+	return repeats * INPUTS;
+}
+
+static uint32_t __calibrationInteger(uint32_t repeats){
+	uint32_t numerator = (uint32_t)(20.48 * 1000.0 / CURRENT_LSB);
+	OPAQUE(numerator);
+	for(uint32_t r = 0; r < repeats; r++)
+		for(uint32_t i = 0; i < INPUTS; i++){
+			uint16_t value = (uint16_t)(numerator / __resistors_mohm[i]);
+			SINK(value);
+		}
+	return repeats * INPUTS;
+}
+
+static uint32_t __calibrationUpdatePlan(uint32_t repeats){
+	for(uint32_t r = 0; r < repeats; r++)
+		for(uint32_t i = 0; i < INPUTS; i++){
+			ina234.ShuntResistor = __resistors[i];
+			ina234.alert_limit = __limits[i];
+			uint8_t changed = __INA234_updatePlan(&ina234);
+			SINK(changed);
+		}
+	return repeats * INPUTS;
+}
+
+static Bench __benchmarks[] = {
+	{"swap/xor_library",						__swapXor, 0, 0, 0},
+	{"swap/temporary",							__swapTemp, 0, 0, 0},
+	{"swap/shift_or",								__swapShift, 0, 0, 0},
+	{"swap/builtin",								__swapBuiltin, 0, 0, 0},
+	{"decode/bitfield_float_library",	__decodeBitfieldFloat, 0, 0, 0},
+	{"decode/shift_mask_float",			__decodeShiftFloat, 0, 0, 0},
+	{"decode/shift_mask_fixed",			__decodeShiftFixed, 0, 0, 0},
+	{"getter/float_library",				__getterFloat, 0, 0, 0},
+	{"getter/fixed_q8_library",			__getterFixedQ8, 0, 0, 0},
+	{"getter/fixed_rounded_library",	__getterFixed, 0, 0, 0},
+	{"alert/float_division_library",	__alertFloatDivision, 0, 0, 0},
+	{"alert/float_reciprocal",			__alertFloatReciprocal, 0, 0, 0},
+	{"alert/integer_division",			__alertInteger, 0, 0, 0},
+	{"calibration/float_library",		__calibrationFloat, 0, 0, 0},
+	{"calibration/integer",					__calibrationInteger, 0, 0, 0},
+	{"calibration/update_plan_library",	__calibrationUpdatePlan, 0, 0, 0},
+};
+
+#define BENCHMARKS	(sizeof(__benchmarks) / sizeof(__benchmarks[0]))
+
+static void __initInputs(void){
+	uint32_t state = 0x12345678;
+
+	for(uint32_t i = 0; i < INPUTS; i++){
+		state = state * 1664525 + 1013904223;
+		uint16_t word = state >> 16;
+		__bytes[i][0] = word >> 8;
+		__bytes[i][1] = word & 0xFF;
+
+		__samples[i].shunt_voltage = (int16_t)word >> 4;
+		__samples[i].bus_voltage = (word >> 4) & 0x7FF;
+		__samples[i].power = word;
+		__samples[i].current = (int16_t)word >> 4;
+		__samples[i].adc_range = word & 1;
+
+		__limits_uv[i] = (int32_t)(state % 20000);
+		__limits[i] = __limits_uv[i] / 1000.0f;
+		__resistors_mohm[i] = 10 + state % 990;
+		__resistors[i] = __resistors_mohm[i] / 1000.0f;
+	}
+
+	ina234.adc_range = RANGE_20_48mV;
+	ina234.alert_on = ALERT_SHUNT_OVER_LIMIT;
+	ina234.ShuntResistor = 0.1;
+	__INA234_updatePlan(&ina234);
+}
+
+static int __compareDouble(const void* a, const void* b){
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+/*!
+    @brief  Run one benchmark: calibrate the repeats to about ::RUN_TIME_NS, then take the median of the runs
+*/
+static void __run(Bench* bench, uint32_t runs){
+	double times[runs], deviations[runs];
+	uint32_t repeats = 1;
+
+	// Calibration (and warm up)
+	while(1){
+		uint64_t start = INA234_Sim_hostTime();
+		bench->function(repeats);
+		if(INA234_Sim_hostTime() - start >= RUN_TIME_NS / 4 || repeats >= (1u << 20))
+			break;
+		repeats *= 2;
+	}
+	repeats *= 4;
+
+	for(uint32_t i = 0; i < runs; i++){
+		uint64_t start = INA234_Sim_hostTime();
+		uint32_t operations = bench->function(repeats);
+		times[i] = (double)(INA234_Sim_hostTime() - start) / operations;
+	}
+	qsort(times, runs, sizeof(double), __compareDouble);
+	bench->ns = times[runs / 2];
+	bench->min = times[0];
+
+	for(uint32_t i = 0; i < runs; i++)
+		deviations[i] = times[i] > bench->ns ? times[i] - bench->ns : bench->ns - times[i];
+	qsort(deviations, runs, sizeof(double), __compareDouble);
+	bench->spread = bench->ns > 0 ? deviations[runs / 2] / bench->ns : 0;
+}
+
+/*!
+    @brief  Compare the results with a baseline file. A benchmark slower than its baseline is run again (up to ::RECHECKS times)
+						before it is reported, so a single noisy run (an interrupt, a frequency change) does not fail the gate.
+    @return	The number of the benchmarks slower than the baseline by more than the tolerance
+*/
+static uint32_t __compare(const char* path, double tolerance, uint32_t runs){
+	FILE* file = fopen(path, "r");
+	char name[64];
+	double ns;
+	uint32_t regressions = 0;
+
+	if(!file){
+		perror(path);
+		exit(2);
+	}
+	while(2 == fscanf(file, "%63s %lf", name, &ns)){
+		for(uint32_t i = 0; i < BENCHMARKS; i++){
+			if(strcmp(name, __benchmarks[i].name))
+				continue;
+			double change = (__benchmarks[i].min - ns) / ns * 100.0;
+			for(uint32_t j = 0; j < RECHECKS && change > tolerance; j++){
+				double min = __benchmarks[i].min;
+				__run(&__benchmarks[i], runs);
+				if(__benchmarks[i].min > min)
+					__benchmarks[i].min = min;
+				change = (__benchmarks[i].min - ns) / ns * 100.0;
+			}
+			if(change > tolerance){
+				printf("REGRESSION %-34s %8.3f -> %8.3f ns (%+.1f%%)\n", name, ns, __benchmarks[i].min, change);
+				regressions++;
+			}
+		}
+	}
+	fclose(file);
+	return regressions;
+}
+
+int main(int argc, char** argv){
+	uint32_t runs = 15;
+	const char* output = NULL;
+	const char* baseline = NULL;
+	double tolerance = 10.0;
+
+	for(int i = 1; i + 1 < argc; i += 2){
+		if(!strcmp(argv[i], "-r"))
+			runs = (uint32_t)atol(argv[i + 1]);
+		else if(!strcmp(argv[i], "-o"))
+			output = argv[i + 1];
+		else if(!strcmp(argv[i], "-b"))
+			baseline = argv[i + 1];
+		else if(!strcmp(argv[i], "-t"))
+			tolerance = atof(argv[i + 1]);
+	}
+	if(runs < 3)
+		runs = 3;
+
+	__initInputs();
+
+	for(uint32_t i = 0; i < BENCHMARKS; i++){
+		__run(&__benchmarks[i], runs);
+		printf("%-34s %8.3f ns  (min %.3f, spread %.1f%%)\n", __benchmarks[i].name, __benchmarks[i].ns, __benchmarks[i].min, __benchmarks[i].spread * 100.0);
+	}
+
+	if(output){
+		FILE* file = fopen(output, "w");
+		if(!file){
+			perror(output);
+			return 2;
+		}
+		for(uint32_t i = 0; i < BENCHMARKS; i++)
+			fprintf(file, "%s %.4f\n", __benchmarks[i].name, __benchmarks[i].min);
+		fclose(file);
+	}
+
+	if(baseline && __compare(baseline, tolerance, runs))
+		return 1;
+	return 0;
+}
@@ -0,0 +1,38 @@
+#!/bin/sh
+# Build and run bench_micro.c with every available compiler and optimization level.
+#
+# Usage:
+#   ./bench_micro.sh [results_directory] [baseline_directory]
+#
+# The results of each combination are saved as <results_directory>/<compiler>_<level>.txt (results by default).
+# If a baseline directory is given, each combination is compared with the file of the same name, and the script
+# exits with 1 if any of them regressed (see bench_micro.c).
+
+RESULTS=${1:-results}
+BASELINE=$2
+COMPILERS=${COMPILERS:-"gcc clang"}
+LEVELS=${LEVELS:-"-O0 -O1 -O2 -O3 -Os"}
+STATUS=0
+
+mkdir -p "$RESULTS"
+RESULTS=$(cd "$RESULTS" && pwd)
+[ -n "$BASELINE" ] && BASELINE=$(cd "$BASELINE" && pwd)
+cd "$(dirname "$0")" || exit 2
+
+for CC in $COMPILERS; do
+	command -v "$CC" > /dev/null || { echo "$CC not found, skipped"; continue; }
+	for LEVEL in $LEVELS; do
+		NAME="${CC}_${LEVEL#-}"
+		BINARY="/tmp/bench_micro_$NAME"
+		"$CC" $LEVEL -I. -I.. -o "$BINARY" bench_micro.c ina234_sim.c ../ina234.c -lm || { STATUS=2; continue; }
+		
+		echo "== $CC $LEVEL"
+		if [ -n "$BASELINE" ] && [ -f "$BASELINE/$NAME.txt" ]; then
+			"$BINARY" -o "$RESULTS/$NAME.txt" -b "$BASELINE/$NAME.txt" || STATUS=1
+		else
+			"$BINARY" -o "$RESULTS/$NAME.txt"
+		fi
+	done
+done
+
+exit $STATUS
@@ -0,0 +1,433 @@
+/*!
+ * @file bench_pipeline.c
+ *
+ * End-to-end throughput benchmark of the whole pipeline on the host: simulated INA234 (ina234_sim.c) -> driver (ina234.c)
+ * -> encoder -> transport -> decoder. The same loops as main.c are run:
+ *   fast-read : raw reads of the shunt voltage register into pool blocks, sent as raw bytes (main.c "Fast read")
+ *   read-all  : ::INA234_readAll(), deadband, ::INA234_Report_format() text lines (main.c "Read all")
+ *   binary    : ::INA234_acquire(), deadband, ::INA234_Proto_encode() frames (main.c "Binary telemetry")
+ *
+ * For each loop it prints:
+ *   - the sustained rate (samples per second of host CPU, and per second of simulated bus time at the I2C clock)
+ *   - the host CPU per sample of each stage (ns)
+ *   - the latency percentiles from the start of the read to the decoded sample, including the batching, both in host CPU time
+ *     and in simulated time (I2C transactions plus the transport link)
+ *
+ * Build:
+ *   gcc -O2 -I. -I.. -o bench_pipeline bench_pipeline.c ina234_sim.c ina234_wave.c ../ina234.c ../ina234_report.c ../ina234_proto.c -lm
+ *
+ * Usage:
+ *   bench_pipeline [-n samples] [-f i2c_frequency] [-t transport_bytes_per_second] [-w scenario_or_file] [-s seed]
+ *
+ * -w feeds the chip with a load waveform (see ina234_wave.h): a built-in scenario or a waveform file. By default a 1kHz ripple is used.
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ina234_sim.h"
+#include "ina234_wave.h"
+#include "ina234_report.h"
+#include "ina234_proto.h"
+
+#define SAMPLES_PER_BATCH			500
+#define MIN_SAMPLES_PER_BATCH	20
+#define TX_BLOCKS							4
+
+typedef enum Stage {STAGE_DEVICE, STAGE_DRIVER, STAGE_ENCODER, STAGE_TRANSPORT, STAGE_DECODER, STAGES} Stage;
+
+static const char* __stageNames[STAGES] = {"device", "driver", "encoder", "transport", "decoder"};
+
+/*!
+    @brief  Results of one benchmarked loop
+*/
+typedef struct bench_result{
+	uint64_t	stage_ns[STAGES];
+	uint32_t	acquired;								/*!< Samples read from the chip */
+	uint32_t	delivered;							/*!< Samples decoded on the other side */
+	uint64_t	host_ns;
+	double		sim_us;
+	uint64_t	bytes;
+	uint64_t*	latencies;							/*!< Host ns */
+	uint64_t*	sim_latencies;					/*!< Simulated ns */
+	uint32_t	latency_count;
+} BenchResult;
+
+static uint32_t __samples = 200000;
+static double __transport_rate = 1000000.0; // USB FS CDC, in bytes per second of simulated time
+
+static INA234 ina234;
+static INA234_Sim sim;
+static INA234_Wave __wave;
+static uint8_t __use_wave = 0;
+static uint8_t __transport[SAMPLES_PER_BATCH * 2 * TX_BLOCKS];
+
+static uint32_t __simClock(void){
+	return (uint32_t)ina234_sim_bus.time_us;
+}
+
+static void __source(void* context, double time_us, double* shunt_mV, double* bus_V){
+	(void)context;
+	// 1kHz load ripple on a 1A (at 1 Ohm shunt, 20.48mV range) load with a slow bus droop
+	*shunt_mV = 10.0 + 8.0 * sin(2.0 * M_PI * time_us / 1000.0);
+	*bus_V = 12.0 - 0.5 * sin(2.0 * M_PI * time_us / 50000.0);
+}
+
+static void __setup(void){
+	INA234_Sim_reset();
+	memset(&sim, 0, sizeof(sim));
+	sim.source = __source;
+	if(__use_wave)
+		INA234_Wave_attach(&__wave, &sim);
+	INA234_Sim_attach(&sim, &hi2c1, 0x48);
+	memset(&ina234, 0, sizeof(ina234));
+
+	if(STATUS_OK != INA234_init(&ina234, 0x48, &hi2c1, 1, RANGE_20_48mV, NADC_1, CTIME_140us, CTIME_140us, MODE_CONTINUOUS_BOTH_SHUNT_BUS)){
+		fprintf(stderr, "INA234_init failed\n");
+		exit(1);
+	}
+	INA234_setClock(&ina234, __simClock);
+}
+
+static void __start(BenchResult* result){
+	memset(result, 0, sizeof(*result));
+	result->latencies = malloc(sizeof(uint64_t) * __samples);
+	result->sim_latencies = malloc(sizeof(uint64_t) * __samples);
+	result->host_ns = INA234_Sim_hostTime();
+	result->sim_us = ina234_sim_bus.time_us;
+}
+
+static void __stop(BenchResult* result){
+	result->host_ns = INA234_Sim_hostTime() - result->host_ns;
+	result->sim_us = ina234_sim_bus.time_us - result->sim_us;
+}
+
+/*!
+    @brief  Time a driver call, splitting the time spent inside the simulated chip from the driver itself
+*/
+#define TIMED_DRIVER(result, call) do{ \
+		uint64_t __device = ina234_sim_bus.cpu_ns; \
+		uint64_t __start_ns = INA234_Sim_hostTime(); \
+		call; \
+		uint64_t __total = INA234_Sim_hostTime() - __start_ns; \
+		(result)->stage_ns[STAGE_DEVICE] += ina234_sim_bus.cpu_ns - __device; \
+		(result)->stage_ns[STAGE_DRIVER] += __total - (ina234_sim_bus.cpu_ns - __device); \
+	}while(0)
+
+static void __latency(BenchResult* result, uint64_t read_time, double read_sim_time){
+	result->latencies[result->latency_count] = INA234_Sim_hostTime() - read_time;
+	result->sim_latencies[result->latency_count] = (uint64_t)((ina234_sim_bus.time_us - read_sim_time) * 1e3);
+	result->latency_count++;
+}
+
+#define TIMED(result, stage, call) do{ \
+		uint64_t __start_ns = INA234_Sim_hostTime(); \
+		call; \
+		(result)->stage_ns[stage] += INA234_Sim_hostTime() - __start_ns; \
+	}while(0)
+
+// State of the "Fast read" loop, shared with its transmitter like the globals of main.c
+static uint8_t __pool_storage[INA234_POOL_STORAGE_SIZE(SAMPLES_PER_BATCH * 2, TX_BLOCKS)];
+static uint64_t __read_times[TX_BLOCKS][SAMPLES_PER_BATCH];
+static double __read_sim_times[TX_BLOCKS][SAMPLES_PER_BATCH];
+static INA234_Pool __pool;
+static INA234_BlockQueue __tx_queue;
+static INA234_BatchControl __batch_control;
+static INA234_Block* __tx_block;
+static uint32_t __tx_start;
+static double __tx_end;
+static volatile int32_t __checksum;
+
+static uint32_t __blockIndex(INA234_Block* block){
+	return (uint32_t)((uint8_t*)block - __pool_storage) / INA234_POOL_BLOCK_STRIDE(SAMPLES_PER_BATCH * 2);
+}
+
+/*!
+    @brief  main.c ServiceTransmit(): complete the batch in flight once the simulated link is done with it, and start the next one.
+						The transport is modelled as a copy which takes the simulated time of the link, overlapping with the next reads.
+*/
+static void __serviceTransmit(BenchResult* result){
+	if(__tx_block && ina234_sim_bus.time_us >= __tx_end){
+		uint32_t index = __blockIndex(__tx_block);
+		uint16_t size = __tx_block->length / 2;
+
+		TIMED(result, STAGE_DECODER, {
+			for(uint16_t i = 0; i < __tx_block->length; i += 2)
+				__checksum += (int16_t)((__transport[i] << 8) | __transport[i + 1]) >> 4;
+		});
+		result->delivered += size;
+		for(uint16_t i = 0; i < size; i++)
+			__latency(result, __read_times[index][i], __read_sim_times[index][i]);
+		INA234_Batch_transmitted(&__batch_control, HAL_GetTick() - __tx_start, __tx_queue.length);
+		INA234_Pool_free(&__pool, __tx_block);
+		__tx_block = NULL;
+	}
+	if(!__tx_block && (__tx_block = INA234_BlockQueue_get(&__tx_queue))){
+		__tx_start = HAL_GetTick();
+		TIMED(result, STAGE_TRANSPORT, memcpy(__transport, __tx_block->data, __tx_block->length));
+		result->bytes += __tx_block->length;
+		__tx_end = ina234_sim_bus.time_us + __tx_block->length * 1e6 / __transport_rate;
+	}
+}
+
+/*!
+    @brief  Wait (in simulated time) until the batch in flight is transmitted
+*/
+static void __waitTransmit(BenchResult* result){
+	if(__tx_block && ina234_sim_bus.time_us < __tx_end)
+		INA234_Sim_advance(__tx_end - ina234_sim_bus.time_us);
+	__serviceTransmit(result);
+}
+
+/*!
+    @brief  main.c "Fast read": batches of raw shunt voltage reads, sent as they are
+*/
+static void __benchFastRead(BenchResult* result){
+	INA234_Block* batch;
+	uint8_t raw[2];
+	uint32_t fill_start;
+
+	INA234_Pool_init(&__pool, __pool_storage, SAMPLES_PER_BATCH * 2, TX_BLOCKS);
+	INA234_BlockQueue_init(&__tx_queue);
+	INA234_Batch_init(&__batch_control, MIN_SAMPLES_PER_BATCH, SAMPLES_PER_BATCH);
+	__tx_block = NULL;
+
+	__start(result);
+	while(result->acquired < __samples){
+		uint16_t size = __batch_control.size;
+		if(size > __samples - result->acquired)
+			size = __samples - result->acquired;
+
+		// All the blocks are queued: the link is the bottleneck
+		batch = INA234_Pool_alloc(&__pool);
+		if(!batch){
+			__waitTransmit(result);
+			continue;
+		}
+		uint32_t index = __blockIndex(batch);
+		fill_start = HAL_GetTick();
+		for(uint16_t i = 0; i < size; i++){
+			__read_times[index][i] = INA234_Sim_hostTime();
+			__read_sim_times[index][i] = ina234_sim_bus.time_us;
+			TIMED_DRIVER(result, HAL_I2C_Mem_Read(&hi2c1, ina234.I2C_ADDR, SHUNT_VOLTAGE_REGISTER, I2C_MEMADD_SIZE_8BIT, raw, 2, 100));
+			TIMED(result, STAGE_ENCODER, {
+				batch->data[i * 2 + 0] = raw[0];
+				batch->data[i * 2 + 1] = raw[1];
+			});
+			__serviceTransmit(result);
+		}
+		batch->length = size * 2;
+		INA234_Batch_filled(&__batch_control, size, HAL_GetTick() - fill_start);
+		INA234_BlockQueue_put(&__tx_queue, batch);
+		result->acquired += size;
+		__serviceTransmit(result);
+	}
+	while(__tx_block)
+		__waitTransmit(result);
+	__stop(result);
+}
+
+/*!
+    @brief  Parse one line of ::INA234_Report_format(), like a host terminal script would
+*/
+static uint8_t __parseLine(const char* line, double values[4]){
+	static const char* keys[4] = {"Shunt Voltage: ", "Bus Voltage: ", "Current: ", "Power: "};
+
+	for(uint8_t i = 0; i < 4; i++){
+		const char* position = strstr(line, keys[i]);
+		if(!position)
+			return 0;
+		values[i] = strtod(position + strlen(keys[i]), NULL);
+		line = position;
+	}
+	return 1;
+}
+
+/*!
+    @brief  main.c "Read all": readAll, deadband, and the integer formatter
+*/
+static void __benchReadAll(BenchResult* result){
+	INA234_Deadband deadband;
+	INA234_Sample sample;
+	char line[INA234_REPORT_LINE_SIZE];
+	uint16_t length = 0;
+	double values[4];
+	volatile double checksum = 0;
+
+	INA234_Deadband_init(&deadband, 2, 2, 2, 2, 5000000);
+
+	__start(result);
+	while(result->acquired < __samples){
+		uint64_t read_time = INA234_Sim_hostTime();
+		double read_sim_time = ina234_sim_bus.time_us;
+		TIMED_DRIVER(result, {
+			INA234_readAll(&ina234);
+			INA234_getPublished(&ina234, &sample);
+		});
+		result->acquired++;
+
+		uint8_t send;
+		TIMED(result, STAGE_ENCODER, {
+			send = INA234_Deadband_check(&deadband, &sample);
+			if(send)
+				length = INA234_Report_format(line, &sample);
+		});
+		if(!send)
+			continue;
+
+		TIMED(result, STAGE_TRANSPORT, memcpy(__transport, line, length));
+		result->bytes += length;
+		INA234_Sim_advance(length * 1e6 / __transport_rate);
+
+		uint8_t parsed;
+		TIMED(result, STAGE_DECODER, {
+			__transport[length] = 0;
+			parsed = __parseLine((const char*)__transport, values);
+		});
+		if(parsed){
+			checksum += values[0];
+			__latency(result, read_time, read_sim_time);
+			result->delivered++;
+		}
+	}
+	__stop(result);
+}
+
+/*!
+    @brief  main.c "Binary telemetry": acquire, deadband, and the framed binary protocol
+*/
+static void __benchBinary(BenchResult* result){
+	INA234_Deadband deadband;
+	INA234_Sample sample;
+	INA234_ProtoEncoder encoder;
+	INA234_ProtoDecoder decoder;
+	INA234_ProtoFrame frame, decoded;
+	uint16_t length = 0;
+	Status status;
+
+	INA234_Deadband_init(&deadband, 2, 2, 2, 2, 5000000);
+	INA234_Proto_initEncoder(&encoder);
+	INA234_Proto_initDecoder(&decoder);
+
+	__start(result);
+	while(result->acquired < __samples){
+		uint64_t read_time = INA234_Sim_hostTime();
+		double read_sim_time = ina234_sim_bus.time_us;
+		TIMED_DRIVER(result, status = INA234_acquire(&ina234, &sample));
+		if(STATUS_OK != status || !sample.fresh)
+			continue;
+		result->acquired++;
+
+		uint8_t send;
+		TIMED(result, STAGE_ENCODER, {
+			send = INA234_Deadband_check(&deadband, &sample);
+			if(send){
+				INA234_Report_sampleFrame(&frame, 0, &sample);
+				length = INA234_Proto_encode(&encoder, &frame, __transport + SAMPLES_PER_BATCH);
+			}
+		});
+		if(!send)
+			continue;
+
+		TIMED(result, STAGE_TRANSPORT, memcpy(__transport, __transport + SAMPLES_PER_BATCH, length));
+		result->bytes += length;
+		INA234_Sim_advance(length * 1e6 / __transport_rate);
+
+		uint8_t frames = 0;
+		TIMED(result, STAGE_DECODER, {
+			for(uint16_t i = 0; i < length; i++)
+				if(INA234_Proto_decode(&decoder, __transport[i], &decoded))
+					for(frames++; INA234_Proto_next(&decoder, &decoded); frames++);
+		});
+		if(frames){
+			__latency(result, read_time, read_sim_time);
+			result->delivered++;
+		}
+	}
+	__stop(result);
+
+	if(decoder.crc_errors || decoder.parse_errors || decoder.lost_frames)
+		fprintf(stderr, "binary: %u CRC errors, %u parse errors, %u lost frames\n", (unsigned)decoder.crc_errors, (unsigned)decoder.parse_errors,
+						(unsigned)decoder.lost_frames);
+}
+
+static int __compare(const void* a, const void* b){
+	uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+	return (x > y) - (x < y);
+}
+
+static double __percentile(const BenchResult* result, const uint64_t* latencies, double percent){
+	if(!result->latency_count)
+		return 0;
+	uint32_t index = (uint32_t)(percent / 100.0 * (result->latency_count - 1) + 0.5);
+	return latencies[index] / 1e3;
+}
+
+static void __print(const char* name, BenchResult* result){
+	qsort(result->latencies, result->latency_count, sizeof(uint64_t), __compare);
+	qsort(result->sim_latencies, result->latency_count, sizeof(uint64_t), __compare);
+
+	printf("%-10s acquired %u, delivered %u, %.1f bytes/sample\n", name, (unsigned)result->acquired, (unsigned)result->delivered,
+					result->delivered ? (double)result->bytes / result->delivered : 0.0);
+	printf("  rate     %.0f samples/s host CPU, %.0f samples/s at %u Hz I2C (simulated)\n",
+					result->acquired * 1e9 / result->host_ns, result->acquired * 1e6 / result->sim_us, (unsigned)ina234_sim_bus.frequency);
+	printf("  cpu      ");
+	for(uint8_t i = 0; i < STAGES; i++)
+		printf("%s %.1f  ", __stageNames[i], (double)result->stage_ns[i] / result->acquired);
+	printf("(ns/sample)\n");
+	printf("  latency  host p50 %.2f  p90 %.2f  p99 %.2f  max %.2f (us)\n", __percentile(result, result->latencies, 50),
+					__percentile(result, result->latencies, 90), __percentile(result, result->latencies, 99), __percentile(result, result->latencies, 100));
+	printf("           sim  p50 %.2f  p90 %.2f  p99 %.2f  max %.2f (us)\n", __percentile(result, result->sim_latencies, 50),
+					__percentile(result, result->sim_latencies, 90), __percentile(result, result->sim_latencies, 99), __percentile(result, result->sim_latencies, 100));
+
+	free(result->latencies);
+	free(result->sim_latencies);
+}
+
+int main(int argc, char** argv){
+	BenchResult result;
+	const char* seed = NULL;
+
+	INA234_Wave_init(&__wave);
+	for(int i = 1; i + 1 < argc; i += 2){
+		if(!strcmp(argv[i], "-n"))
+			__samples = (uint32_t)atol(argv[i + 1]);
+		else if(!strcmp(argv[i], "-f"))
+			ina234_sim_bus.frequency = (uint32_t)atol(argv[i + 1]);
+		else if(!strcmp(argv[i], "-t"))
+			__transport_rate = atof(argv[i + 1]);
+		else if(!strcmp(argv[i], "-w")){
+			int line = INA234_Wave_load(&__wave, argv[i + 1]);
+			if(line){
+				fprintf(stderr, "%s:%d: %s\n", argv[i + 1], line, __wave.error);
+				return 1;
+			}
+			__use_wave = 1;
+		}
+		else if(!strcmp(argv[i], "-s"))
+			seed = argv[i + 1];
+	}
+	if(seed)
+		__wave.seed = strtoull(seed, NULL, 0);
+	uint32_t frequency = ina234_sim_bus.frequency;
+
+	__setup();
+	ina234_sim_bus.frequency = frequency;
+	__benchFastRead(&result);
+	__print("fast-read", &result);
+	printf("  batch    size %u, %u grows, %u shrinks\n", (unsigned)__batch_control.size, (unsigned)__batch_control.grows, (unsigned)__batch_control.shrinks);
+
+	__setup();
+	ina234_sim_bus.frequency = frequency;
+	__benchReadAll(&result);
+	__print("read-all", &result);
+
+	__setup();
+	ina234_sim_bus.frequency = frequency;
+	__benchBinary(&result);
+	__print("binary", &result);
+
+	return 0;
+}
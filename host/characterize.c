@@ -0,0 +1,340 @@
+/*!
+ * @file characterize.c
+ *
+ * Accuracy versus throughput of every AVG (::NumSamples) x VSHCT x VBUSCT (::ConvTime) setting, measured on the simulated INA234
+ * (ina234_sim.c) with the real driver (ina234.c). For each setting the chip runs in the continuous shunt and bus mode and
+ * ::INA234_acquireNext() reads the samples, like an application that reads each new conversion. It prints:
+ *   period    conversion period (us) from the datasheet timing
+ *   rate      fresh samples per second of simulated time
+ *   latency   mean time (us) from the middle of the conversion window to the sample in the MCU
+ *   shunt     RMS error (uV) of the shunt voltage against the input averaged over the conversion, and the ENOB over the full range
+ *   bus       RMS error (mV) of the bus voltage against the input averaged over the conversion
+ *   track     RMS error (uV) of the shunt voltage against the input when the sample is read (noise plus the signal change since the conversion)
+ *   i2c       share of the I2C bus time taken by the reads and the conversion ready polls
+ * The settings marked with * are on the Pareto front of the rate and the ENOB: no other setting is both faster and more accurate.
+ *
+ * The input is a slow ramp from 10mV and 12V by default, over about 7 ADC codes during the samples of each setting, so the conversions
+ * land at every position within the codes and the errors are the ADC noise (see INA234_Sim::noise_uV) and its quantization. The
+ * chip quantizes each of its averaged ADC samples and reports the mean of their codes, so the averaging removes the noise down to
+ * the quantization error (about 1/sqrt(12) LSB RMS) unless the noise is large enough to dither the codes.
+ * -w uses a load waveform instead (a built-in scenario or a file, see ina234_wave.h), and -c a captured signal: a text file of
+ * "time_us shunt_mV bus_V" lines, interpolated linearly and repeated. The simulated chip averages the input over the conversion
+ * window of each ADC sample, like the integrating ADC, and the shunt column compares against that average: it is the ADC noise only,
+ * and the track column adds the filtering of the averaging and the change of the signal during the latency.
+ *
+ * Build:
+ *   gcc -O2 -I. -I.. -o characterize characterize.c ina234_sim.c ina234_wave.c ../ina234.c -lm
+ *
+ * Usage:
+ *   characterize [-n samples] [-u noise_uV] [-r 81|20] [-f i2c_frequency] [-w scenario_or_file] [-s seed] [-c capture.txt] [-p 1] [-o results.csv]
+ *
+ * -n is the number of samples of each setting (100 by default), -u the RMS noise of one 140us shunt conversion (25uV by default),
+ * -r the shunt range in mV, -p 1 prints only the Pareto front and -o also writes all of the results as CSV.
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ina234_sim.h"
+#include "ina234_wave.h"
+#include "ina234.h"
+
+#define SETTINGS					(8 * 8 * 8)
+#define SHUNT_BITS				12
+#define RAMP_CODES				7.3
+
+static const uint16_t __numberOfSamples[8] = {1, 4, 16, 64, 128, 256, 512, 1024};
+static const uint16_t __conversionTimes[8] = {140, 204, 332, 588, 1100, 2116, 4156, 8244};
+
+/*!
+    @brief  Results of one setting
+*/
+typedef struct result{
+	NumSamples	avg;
+	ConvTime		vshct;
+	ConvTime		vbusct;
+	uint32_t		period;
+	double			rate;										/*!< Fresh samples per second */
+	double			latency;								/*!< us */
+	double			shunt_rms;							/*!< uV */
+	double			enob;
+	double			bus_rms;								/*!< mV */
+	double			track_rms;							/*!< uV */
+	double			load;										/*!< Share of the I2C bus time */
+	uint32_t		gaps;
+	uint8_t			pareto;
+} Result;
+
+/*!
+    @brief  Captured signal: samples interpolated linearly and repeated
+*/
+typedef struct capture{
+	double*		time;
+	double*		shunt;
+	double*		bus;
+	uint32_t	count;
+} Capture;
+
+static INA234 ina234;
+static INA234_Sim sim;
+static INA234_Wave __wave;
+static Capture __capture;
+static INA234_SimSource __input;
+static void* __input_context;
+
+// Input of the registers read last (recorded by __transfer)
+static double __read_time, __read_shunt, __read_bus;
+
+// Slopes of the default input (per us), set for each setting so the input moves over RAMP_CODES codes during its samples
+static double __ramp_shunt, __ramp_bus;
+
+static uint32_t __samples = 100;
+static double __noise_uV = 25.0;
+static ADCRange __range = RANGE_81_92mV;
+
+static uint32_t __simClock(void){
+	return (uint32_t)ina234_sim_bus.time_us;
+}
+
+static void __simSleep(uint32_t time){
+	INA234_Sim_advance(time);
+}
+
+/*!
+    @brief  Default input: slow ramps from 10mV and 12V, so the conversions land at every position within the ADC codes
+*/
+static void __rampSample(void* context, double time_us, double* shunt_mV, double* bus_V){
+	(void)context;
+	*shunt_mV = 10.0 + __ramp_shunt * time_us;
+	*bus_V = 12.0 + __ramp_bus * time_us;
+}
+
+static void __captureSample(void* context, double time_us, double* shunt_mV, double* bus_V){
+	const Capture* capture = context;
+	double span = capture->time[capture->count - 1] - capture->time[0];
+	double t = capture->time[0] + (span > 0 ? fmod(time_us, span) : 0);
+	uint32_t low = 0, high = capture->count - 1;
+
+	while(high - low > 1){
+		uint32_t middle = (low + high) / 2;
+		if(capture->time[middle] <= t)
+			low = middle;
+		else
+			high = middle;
+	}
+	double dt = capture->time[high] - capture->time[low];
+	double k = dt > 0 ? (t - capture->time[low]) / dt : 0;
+	if(k > 1)
+		k = 1;
+	*shunt_mV = capture->shunt[low] + k * (capture->shunt[high] - capture->shunt[low]);
+	*bus_V = capture->bus[low] + k * (capture->bus[high] - capture->bus[low]);
+}
+
+static int __captureLoad(Capture* capture, const char* path){
+	FILE* file = fopen(path, "r");
+	char line[256];
+	uint32_t capacity = 0;
+
+	if(!file)
+		return 0;
+	while(fgets(line, sizeof(line), file)){
+		double t, shunt, bus = 0;
+		if(line[0] == '#' || sscanf(line, "%lf %lf %lf", &t, &shunt, &bus) < 2)
+			continue;
+		if(capture->count == capacity){
+			capacity = capacity ? 2 * capacity : 1024;
+			capture->time = realloc(capture->time, capacity * sizeof(double));
+			capture->shunt = realloc(capture->shunt, capacity * sizeof(double));
+			capture->bus = realloc(capture->bus, capacity * sizeof(double));
+		}
+		capture->time[capture->count] = t;
+		capture->shunt[capture->count] = shunt;
+		capture->bus[capture->count] = bus;
+		capture->count++;
+	}
+	fclose(file);
+	return capture->count >= 2;
+}
+
+/*!
+    @brief  Register access of the driver (see ::INA234_setTransfer). The simulated chip converts up to the end of a read before
+						returning the registers, so the input of the last conversion (ina234_sim::converted_shunt_mV) belongs to the value just read.
+*/
+static Status __transfer(void* context, uint16_t DevAddress, uint8_t MemAddress, uint8_t* pData, uint16_t Size, uint8_t write){
+	HAL_StatusTypeDef status;
+	(void)context;
+
+	if(write)
+		return HAL_OK == HAL_I2C_Mem_Write(&hi2c1, DevAddress, MemAddress, I2C_MEMADD_SIZE_8BIT, pData, Size, INA234_I2C_TIMEOUT) ? STATUS_OK : STATUS_TimeOut;
+
+	status = HAL_I2C_Mem_Read(&hi2c1, DevAddress, MemAddress, I2C_MEMADD_SIZE_8BIT, pData, Size, INA234_I2C_TIMEOUT);
+	if(MemAddress == SHUNT_VOLTAGE_REGISTER){
+		__read_time = sim.converted_us;
+		__read_shunt = sim.converted_shunt_mV;
+	}
+	else if(MemAddress == BUS_VOLTAGE_REGISTER){
+		__read_bus = sim.converted_bus_V;
+	}
+	return HAL_OK == status ? STATUS_OK : STATUS_TimeOut;
+}
+
+static void __run(Result* result){
+	INA234_Sample sample;
+	double shunt_lsb = __range == RANGE_81_92mV ? SHUNT_VOLTAGE_81_92mv_LSB : SHUNT_VOLTAGE_20_48mv_LSB;
+	double shunt_sum = 0, bus_sum = 0, track_sum = 0, latency_sum = 0;
+	uint32_t frequency = ina234_sim_bus.frequency;
+
+	INA234_Sim_reset();
+	ina234_sim_bus.frequency = frequency;
+	memset(&sim, 0, sizeof(sim));
+	sim.source = __input;
+	sim.source_context = __input_context;
+	sim.noise_uV = __noise_uV;
+	INA234_Sim_attach(&sim, &hi2c1, 0x48);
+	memset(&ina234, 0, sizeof(ina234));
+
+	if(STATUS_OK != INA234_init(&ina234, 0x48, &hi2c1, 1, __range, result->avg, result->vbusct, result->vshct, MODE_CONTINUOUS_BOTH_SHUNT_BUS)){
+		fprintf(stderr, "INA234_init failed\n");
+		exit(1);
+	}
+	INA234_setClock(&ina234, __simClock);
+	INA234_setSleep(&ina234, __simSleep);
+	INA234_setTransfer(&ina234, __transfer, NULL);
+	result->period = INA234_getConversionPeriod(&ina234);
+	__ramp_shunt = RAMP_CODES * shunt_lsb / ((__samples + 2.0) * result->period);
+	__ramp_bus = RAMP_CODES * BUS_VOLTAGE_LSB / ((__samples + 2.0) * result->period);
+
+	// The first conversion after the configuration is not measured
+	INA234_acquireNext(&ina234, &sample, 3 * result->period);
+	ina234.gaps = 0;
+	double start_us = ina234_sim_bus.time_us;
+	uint64_t start_bits = ina234_sim_bus.bits;
+	uint32_t fresh = 0;
+
+	for(uint32_t i = 0; i < __samples; i++){
+		if(STATUS_OK != INA234_acquireNext(&ina234, &sample, 3 * result->period) || !sample.fresh)
+			continue;
+		fresh++;
+
+		double shunt_mV, bus_V;
+		__input(__input_context, ina234_sim_bus.time_us, &shunt_mV, &bus_V);
+		double error = sample.shunt_voltage * shunt_lsb - __read_shunt;
+		double track = sample.shunt_voltage * shunt_lsb - shunt_mV;
+		double bus_error = sample.bus_voltage * BUS_VOLTAGE_LSB - __read_bus;
+		shunt_sum += error * error;
+		track_sum += track * track;
+		bus_sum += bus_error * bus_error;
+		latency_sum += ina234_sim_bus.time_us - (__read_time - result->period / 2.0);
+	}
+
+	double elapsed = ina234_sim_bus.time_us - start_us;
+	result->rate = fresh * 1e6 / elapsed;
+	result->latency = fresh ? latency_sum / fresh : 0;
+	result->shunt_rms = fresh ? sqrt(shunt_sum / fresh) * 1e3 : 0;
+	result->bus_rms = fresh ? sqrt(bus_sum / fresh) * 1e3 : 0;
+	result->track_rms = fresh ? sqrt(track_sum / fresh) * 1e3 : 0;
+	result->load = (ina234_sim_bus.bits - start_bits) * 1e6 / ((double)ina234_sim_bus.frequency * elapsed);
+	result->gaps = ina234.gaps;
+
+	// The ENOB over the full (bipolar) range, limited to the ADC resolution when the error is below the quantization noise
+	double full_scale = 4096 * shunt_lsb * 1e3;
+	result->enob = result->shunt_rms > 0 ? log2(full_scale / (result->shunt_rms * sqrt(12.0))) : SHUNT_BITS;
+	if(result->enob > SHUNT_BITS)
+		result->enob = SHUNT_BITS;
+}
+
+static void __pareto(Result* results, uint32_t count){
+	for(uint32_t i = 0; i < count; i++){
+		results[i].pareto = 1;
+		for(uint32_t j = 0; j < count && results[i].pareto; j++)
+			if(results[j].rate >= results[i].rate && results[j].enob >= results[i].enob &&
+					(results[j].rate > results[i].rate || results[j].enob > results[i].enob))
+				results[i].pareto = 0;
+	}
+}
+
+int main(int argc, char** argv){
+	static Result results[SETTINGS];
+	const char* seed = NULL;
+	const char* csv = NULL;
+	uint8_t pareto_only = 0;
+	uint32_t count = 0;
+
+	INA234_Wave_init(&__wave);
+	for(int i = 1; i + 1 < argc; i += 2){
+		if(!strcmp(argv[i], "-n"))
+			__samples = (uint32_t)atol(argv[i + 1]);
+		else if(!strcmp(argv[i], "-u"))
+			__noise_uV = atof(argv[i + 1]);
+		else if(!strcmp(argv[i], "-r"))
+			__range = atoi(argv[i + 1]) == 20 ? RANGE_20_48mV : RANGE_81_92mV;
+		else if(!strcmp(argv[i], "-f"))
+			ina234_sim_bus.frequency = (uint32_t)atol(argv[i + 1]);
+		else if(!strcmp(argv[i], "-w")){
+			INA234_Wave_init(&__wave);
+			int line = INA234_Wave_load(&__wave, argv[i + 1]);
+			if(line){
+				fprintf(stderr, "%s:%d: %s\n", argv[i + 1], line, __wave.error);
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "-s"))
+			seed = argv[i + 1];
+		else if(!strcmp(argv[i], "-c")){
+			if(!__captureLoad(&__capture, argv[i + 1])){
+				fprintf(stderr, "%s: can not read at least two samples\n", argv[i + 1]);
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "-p"))
+			pareto_only = atoi(argv[i + 1]) != 0;
+		else if(!strcmp(argv[i], "-o"))
+			csv = argv[i + 1];
+	}
+	if(seed)
+		__wave.seed = strtoull(seed, NULL, 0);
+	__input = __capture.count ? __captureSample : __wave.count ? INA234_Wave_sample : __rampSample;
+	__input_context = __capture.count ? (void*)&__capture : (void*)&__wave;
+
+	for(uint8_t avg = 0; avg < 8; avg++)
+		for(uint8_t vshct = 0; vshct < 8; vshct++)
+			for(uint8_t vbusct = 0; vbusct < 8; vbusct++){
+				Result* result = &results[count++];
+				memset(result, 0, sizeof(*result));
+				result->avg = avg;
+				result->vshct = vshct;
+				result->vbusct = vbusct;
+				__run(result);
+			}
+	__pareto(results, count);
+
+	printf("%4s %5s %6s | %8s %9s %10s | %8s %5s %7s %8s | %6s %4s\n", "AVG", "VSHCT", "VBUSCT", "period", "rate", "latency", "shunt", "ENOB", "bus", "track", "i2c", "gaps");
+	printf("%4s %5s %6s | %8s %9s %10s | %8s %5s %7s %8s | %6s %4s\n", "", "(us)", "(us)", "(us)", "(Hz)", "(us)", "(uV)", "", "(mV)", "(uV)", "(%)", "");
+	for(uint32_t i = 0; i < count; i++){
+		const Result* r = &results[i];
+		if(pareto_only && !r->pareto)
+			continue;
+		printf("%4u %5u %6u | %8u %9.2f %10.0f | %8.2f %5.2f %7.3f %8.2f | %6.3f %4u %s\n", __numberOfSamples[r->avg], __conversionTimes[r->vshct],
+						__conversionTimes[r->vbusct], (unsigned)r->period, r->rate, r->latency, r->shunt_rms, r->enob, r->bus_rms, r->track_rms,
+						r->load * 100.0, (unsigned)r->gaps, r->pareto ? "*" : "");
+	}
+
+	if(csv){
+		FILE* file = fopen(csv, "w");
+		if(!file){
+			fprintf(stderr, "%s: can not write\n", csv);
+			return 1;
+		}
+		fprintf(file, "avg,vshct_us,vbusct_us,period_us,rate_hz,latency_us,shunt_rms_uv,enob,bus_rms_mv,track_rms_uv,i2c_load,gaps,pareto\n");
+		for(uint32_t i = 0; i < count; i++){
+			const Result* r = &results[i];
+			fprintf(file, "%u,%u,%u,%u,%.4f,%.1f,%.3f,%.3f,%.4f,%.3f,%.5f,%u,%u\n", __numberOfSamples[r->avg], __conversionTimes[r->vshct],
+							__conversionTimes[r->vbusct], (unsigned)r->period, r->rate, r->latency, r->shunt_rms, r->enob, r->bus_rms, r->track_rms,
+							r->load, (unsigned)r->gaps, r->pareto);
+		}
+		fclose(file);
+	}
+	return 0;
+}
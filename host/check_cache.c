@@ -0,0 +1,145 @@
+/*!
+ * @file check_cache.c
+ *
+ * Check of the register cache (::INA234_setCache) against the timebase error of the chip. The simulated chip converts a ramp, so every
+ * conversion gives a new shunt voltage, with its conversion period scaled by each clock error (ina234_sim::period_scale). The shunt voltage
+ * is read at random intervals of up to 1/8 of the period, and a read served from the cache is stale if the chip has converted a new value
+ * since. For each clock error it prints the hit rate, the number of the stale reads and the timing measurements.
+ *
+ * Build:
+ *   gcc -O2 -I. -I.. -o check_cache check_cache.c ina234_sim.c ../ina234.c -lm
+ *
+ * Usage:
+ *   check_cache [-n reads] [-e max_clock_error_percent] [-s seed]
+ *
+ * Then it reads the shunt voltage with a latched limit alert configured, and counts the reads that cleared the alert flag.
+ *
+ * It exits with 1 if a stale read was served or the alert flag was cleared, so it can gate the changes of the cache.
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ina234_sim.h"
+#include "ina234.h"
+
+static uint32_t __reads = 200000;
+static double __max_error = 10.0;
+static uint64_t __seed = 1;
+
+static INA234 ina234;
+static INA234_Sim sim;
+
+static uint32_t __simClock(void){
+	return (uint32_t)ina234_sim_bus.time_us;
+}
+
+static void __source(void* context, double time_us, double* shunt_mV, double* bus_V){
+	(void)context;
+	// One LSB (10uV) every 10us, so no two conversions give the same code
+	*shunt_mV = 1.0 + fmod(time_us * 1e-3, 18.0);
+	*bus_V = 12.0;
+}
+
+static double __random(void){
+	// xorshift64*, so the runs are the same on every host for a seed
+	__seed ^= __seed >> 12;
+	__seed ^= __seed << 25;
+	__seed ^= __seed >> 27;
+	return ((__seed * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*!
+    @brief  Read the shunt voltage at random times with the chip off by error_percent, and count the stale cache hits
+*/
+static uint32_t __check(double error_percent){
+	uint32_t stale = 0;
+
+	INA234_Sim_reset();
+	memset(&sim, 0, sizeof(sim));
+	sim.source = __source;
+	sim.period_scale = 1.0 + error_percent / 100.0;
+	INA234_Sim_attach(&sim, &hi2c1, 0x48);
+	memset(&ina234, 0, sizeof(ina234));
+	if(STATUS_OK != INA234_init(&ina234, 0x48, &hi2c1, 1, RANGE_20_48mV, NADC_1, CTIME_588us, CTIME_588us, MODE_CONTINUOUS_BOTH_SHUNT_BUS)){
+		fprintf(stderr, "INA234_init failed\n");
+		exit(1);
+	}
+	INA234_setClock(&ina234, __simClock);
+	INA234_setCache(&ina234, 1);
+
+	uint32_t period = INA234_getConversionPeriod(&ina234);
+	for(uint32_t i = 0; i < __reads; i++){
+		INA234_Sim_advance(__random() * period / 8);
+
+		uint32_t hits = ina234.cache_hits;
+		float value = INA234_getShuntVoltage(&ina234);
+		float latest = (float)(((int16_t)sim.regs[SHUNT_VOLTAGE_REGISTER] >> 4) * SHUNT_VOLTAGE_20_48mv_LSB);
+		if(ina234.cache_hits != hits && fabsf(value - latest) > SHUNT_VOLTAGE_20_48mv_LSB / 2)
+			stale++;
+	}
+
+	uint32_t total = ina234.cache_hits + ina234.cache_misses;
+	printf("%+6.1f%%  hits %5.1f%%  stale %6u  syncs %6u\n", error_percent, total ? 100.0 * ina234.cache_hits / total : 0.0,
+					(unsigned)stale, (unsigned)ina234.cache_syncs);
+	return stale;
+}
+
+/*!
+    @brief  Read the shunt voltage at random times with a latched limit alert configured, and count the reads that cleared the alert flag
+*/
+static uint32_t __checkAlert(void){
+	uint32_t cleared = 0;
+
+	INA234_Sim_reset();
+	memset(&sim, 0, sizeof(sim));
+	sim.source = __source;
+	INA234_Sim_attach(&sim, &hi2c1, 0x48);
+	memset(&ina234, 0, sizeof(ina234));
+	if(STATUS_OK != INA234_init(&ina234, 0x48, &hi2c1, 1, RANGE_20_48mV, NADC_1, CTIME_588us, CTIME_588us, MODE_CONTINUOUS_BOTH_SHUNT_BUS) ||
+			STATUS_OK != INA234_alert_init(&ina234, ALERT_SHUNT_OVER_LIMIT, ALERT_ACTIVE_LOW, ALERT_LATCHED, ALERT_CONV_DISABLE, 0.5)){
+		fprintf(stderr, "INA234_init failed\n");
+		exit(1);
+	}
+	INA234_setClock(&ina234, __simClock);
+	INA234_setCache(&ina234, 1);
+
+	// The ramp is always over the limit, so the flag is set at every conversion and only a read of the flag clears it
+	uint32_t period = INA234_getConversionPeriod(&ina234);
+	INA234_Sim_advance(period);
+	for(uint32_t i = 0; i < __reads / 10; i++){
+		INA234_Sim_advance(__random() * period / 2);
+		INA234_getShuntVoltage(&ina234);
+		if(!(sim.regs[MASK_ENABLE_REGISTER] & 0x0010))
+			cleared++;
+	}
+	printf("latched alert  %u reads cleared the alert flag\n", (unsigned)cleared);
+	return cleared;
+}
+
+int main(int argc, char** argv){
+	static const double errors[] = {0.0, 0.5, 1.0, 3.0, 5.0, 10.0};
+	uint32_t stale = 0;
+
+	for(int i = 1; i + 1 < argc; i += 2){
+		if(!strcmp(argv[i], "-n"))
+			__reads = (uint32_t)atol(argv[i + 1]);
+		else if(!strcmp(argv[i], "-e"))
+			__max_error = atof(argv[i + 1]);
+		else if(!strcmp(argv[i], "-s"))
+			__seed = strtoull(argv[i + 1], NULL, 0) | 1;
+	}
+
+	printf("clock    %u reads each, tolerance %u%%\n", (unsigned)__reads, (unsigned)INA234_CACHE_TOLERANCE);
+	for(uint8_t i = 0; i < sizeof(errors) / sizeof(errors[0]); i++){
+		if(errors[i] > __max_error)
+			break;
+		stale += __check(errors[i]);
+		if(errors[i] > 0)
+			stale += __check(-errors[i]);
+	}
+	stale += __checkAlert();
+	return stale ? 1 : 0;
+}
@@ -0,0 +1,216 @@
+/*!
+ * @file check_replay.c
+ *
+ * Check of the record and replay of the bus (ina234_trace.h). Several simulated INA234 on one bus are attached to a trace and read
+ * with ::INA234_acquire() at random times while a load waveform (ina234_wave.h) drives their inputs. The trace is serialized, loaded
+ * into another trace and replayed on new ina234 objects with the clock of the trace, and every replayed sample must be equal to the
+ * recorded one (values, timestamp, sequence and fresh flag) with no mismatched transaction. It also checks that one ina234 object more
+ * than ::INA234_TRACE_DEVICES is refused by ::INA234_Trace_attach() and ::INA234_Trace_replay() and keeps its own transport, and that
+ * ::INA234_Trace_detach() of one object leaves the others recorded.
+ *
+ * Build:
+ *   gcc -O2 -I. -I.. -o check_replay check_replay.c ina234_sim.c ina234_wave.c ../ina234_trace.c ../ina234.c -lm
+ *
+ * Usage:
+ *   check_replay [-n reads] [-d devices] [-w scenario_or_file] [-s seed]
+ *
+ * It exits with 1 if a sample does not replay identically, so it can gate the changes of the trace and of the driver.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ina234_sim.h"
+#include "ina234_wave.h"
+#include "ina234_trace.h"
+
+#define MAX_RECORDS				(1 << 18)
+#define FIRST_ADDRESS			0x40
+
+static uint32_t __reads = 5000;
+static uint8_t __devices = 4;
+static uint64_t __seed = 1;
+
+static INA234 ina234[INA234_TRACE_DEVICES + 1];
+static INA234_Sim sims[INA234_TRACE_DEVICES + 1];
+static INA234_Wave __wave;
+static INA234_Trace trace;
+static INA234_TraceRecord records[MAX_RECORDS];
+static INA234_TraceRecord loaded[MAX_RECORDS];
+static uint8_t buffer[MAX_RECORDS * INA234_TRACE_RECORD_SIZE];
+
+static INA234_Sample* __recorded;
+static uint8_t* __order;
+
+static uint32_t __simClock(void){
+	return (uint32_t)ina234_sim_bus.time_us;
+}
+
+static uint32_t __traceClock(void){
+	return trace.time;
+}
+
+static double __random(void){
+	// xorshift64*, so the runs are the same on every host for a seed
+	__seed ^= __seed >> 12;
+	__seed ^= __seed << 25;
+	__seed ^= __seed >> 27;
+	return ((__seed * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void __init(uint8_t count, INA234_Clock clock){
+	for(uint8_t i = 0; i < count; i++){
+		memset(&ina234[i], 0, sizeof(ina234[i]));
+		if(STATUS_OK != INA234_init(&ina234[i], FIRST_ADDRESS + i, &hi2c1, 1, RANGE_20_48mV, NADC_4, CTIME_332us, CTIME_140us, MODE_CONTINUOUS_BOTH_SHUNT_BUS)){
+			fprintf(stderr, "INA234_init failed\n");
+			exit(1);
+		}
+		INA234_setClock(&ina234[i], clock);
+	}
+}
+
+/*!
+    @brief  Check that the trace refuses one ina234 object more than it can route, and leaves it on its own transport
+*/
+static uint32_t __checkLimit(void){
+	uint32_t failures = 0;
+
+	INA234_Sim_reset();
+	for(uint8_t i = 0; i <= INA234_TRACE_DEVICES; i++){
+		memset(&sims[i], 0, sizeof(sims[i]));
+		INA234_Sim_attach(&sims[i], &hi2c1, FIRST_ADDRESS + i);
+	}
+	__init(INA234_TRACE_DEVICES + 1, __simClock);
+
+	INA234_Trace_init(&trace, records, MAX_RECORDS, __simClock);
+	for(uint8_t i = 0; i < INA234_TRACE_DEVICES; i++)
+		if(STATUS_OK != INA234_Trace_attach(&trace, &ina234[i]))
+			failures++;
+	if(STATUS_OK == INA234_Trace_attach(&trace, &ina234[INA234_TRACE_DEVICES]) || ina234[INA234_TRACE_DEVICES].transfer ||
+			STATUS_OK == INA234_Trace_replay(&trace, &ina234[INA234_TRACE_DEVICES]) || ina234[INA234_TRACE_DEVICES].transfer)
+		failures++;
+	printf("limit     %u of %u ina234 objects attached, one more %s\n", (unsigned)trace.devices_count, (unsigned)(INA234_TRACE_DEVICES + 1),
+					failures ? "NOT refused" : "refused");
+	return failures;
+}
+
+/*!
+    @brief  Check that detaching an ina234 object only gives back its own transport, and that the others are still recorded.
+						It runs on the objects attached by __checkLimit().
+*/
+static uint32_t __checkDetach(void){
+	uint32_t failures = 0;
+	INA234_Sample sample;
+
+	INA234_Trace_detach(&trace, &ina234[1]);
+	if(ina234[1].transfer || trace.devices_count != INA234_TRACE_DEVICES - 1 || trace.mode != TRACE_RECORD)
+		failures++;
+
+	// The others are still recorded, and detaching an object again (or one never attached) changes nothing
+	uint32_t head = trace.head;
+	INA234_acquire(&ina234[0], &sample);
+	if(trace.head == head)
+		failures++;
+	INA234_Trace_detach(&trace, &ina234[1]);
+	INA234_Trace_detach(&trace, &ina234[INA234_TRACE_DEVICES]);
+	if(trace.devices_count != INA234_TRACE_DEVICES - 1 || ina234[INA234_TRACE_DEVICES].transfer)
+		failures++;
+
+	for(uint8_t i = 0; i < INA234_TRACE_DEVICES; i++)
+		INA234_Trace_detach(&trace, &ina234[i]);
+	if(trace.devices_count || trace.mode != TRACE_OFF || ina234[0].transfer)
+		failures++;
+	printf("detach    %s\n", failures ? "FAILED" : "each object on its own");
+	return failures;
+}
+
+/*!
+    @brief  Read the chips at random times and record the transactions, then replay them and compare the samples
+*/
+static uint32_t __checkReplay(void){
+	INA234_Sample sample;
+	uint32_t different = 0, failed = 0;
+
+	INA234_Sim_reset();
+	for(uint8_t i = 0; i < __devices; i++){
+		memset(&sims[i], 0, sizeof(sims[i]));
+		INA234_Wave_attach(&__wave, &sims[i]);
+		sims[i].noise_uV = 25.0;
+		INA234_Sim_attach(&sims[i], &hi2c1, FIRST_ADDRESS + i);
+	}
+	__init(__devices, __simClock);
+
+	INA234_Trace_init(&trace, records, MAX_RECORDS, __simClock);
+	for(uint8_t i = 0; i < __devices; i++)
+		INA234_Trace_attach(&trace, &ina234[i]);
+	uint32_t period = INA234_getConversionPeriod(&ina234[0]);
+	for(uint32_t i = 0; i < __reads; i++){
+		INA234_Sim_advance(__random() * period);
+		__order[i] = (uint8_t)(__random() * __devices);
+		if(STATUS_OK != INA234_acquire(&ina234[__order[i]], &__recorded[i]))
+			failed++;
+	}
+	uint32_t length = INA234_Trace_serialize(&trace, buffer, sizeof(buffer));
+
+	// A PC without the chips: the replayed ina234 objects are initialized on the simulated bus, then only see the trace
+	__init(__devices, __traceClock);
+	INA234_Trace_init(&trace, loaded, MAX_RECORDS, NULL);
+	uint32_t count = INA234_Trace_load(&trace, buffer, length);
+	for(uint8_t i = 0; i < __devices; i++)
+		INA234_Trace_replay(&trace, &ina234[i]);
+	for(uint32_t i = 0; i < __reads; i++){
+		memset(&sample, 0, sizeof(sample));
+		Status status = INA234_acquire(&ina234[__order[i]], &sample);
+		const INA234_Sample* r = &__recorded[i];
+		if(status != STATUS_OK || sample.timestamp != r->timestamp || sample.sequence != r->sequence || sample.shunt_voltage != r->shunt_voltage ||
+				sample.bus_voltage != r->bus_voltage || sample.power != r->power || sample.current != r->current || sample.adc_range != r->adc_range ||
+				sample.fresh != r->fresh){
+			if(!different)
+				fprintf(stderr, "sample %u of 0x%02x: recorded t=%u seq=%u shunt=%d, replayed t=%u seq=%u shunt=%d\n", (unsigned)i, FIRST_ADDRESS + __order[i],
+								(unsigned)r->timestamp, (unsigned)r->sequence, r->shunt_voltage, (unsigned)sample.timestamp, (unsigned)sample.sequence, sample.shunt_voltage);
+			different++;
+		}
+	}
+
+	printf("replay    %u reads of %u chips (%u failed), %u records, %u replayed, %u mismatches, %u different samples\n", (unsigned)__reads,
+					(unsigned)__devices, (unsigned)failed, (unsigned)count, (unsigned)trace.replayed, (unsigned)trace.mismatches, (unsigned)different);
+	return different + trace.mismatches;
+}
+
+int main(int argc, char** argv){
+	uint32_t failures = 0;
+
+	INA234_Wave_init(&__wave);
+	INA234_Wave_load(&__wave, "ripple");
+	for(int i = 1; i + 1 < argc; i += 2){
+		if(!strcmp(argv[i], "-n"))
+			__reads = (uint32_t)atol(argv[i + 1]);
+		else if(!strcmp(argv[i], "-d"))
+			__devices = (uint8_t)atoi(argv[i + 1]);
+		else if(!strcmp(argv[i], "-w")){
+			INA234_Wave_init(&__wave);
+			int line = INA234_Wave_load(&__wave, argv[i + 1]);
+			if(line){
+				fprintf(stderr, "%s:%d: %s\n", argv[i + 1], line, __wave.error);
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "-s"))
+			__seed = strtoull(argv[i + 1], NULL, 0) | 1;
+	}
+	if(__devices < 1)
+		__devices = 1;
+	if(__devices > INA234_TRACE_DEVICES)
+		__devices = INA234_TRACE_DEVICES;
+	__recorded = malloc(sizeof(INA234_Sample) * __reads);
+	__order = malloc(__reads);
+
+	failures += __checkLimit();
+	failures += __checkDetach();
+	failures += __checkReplay();
+
+	free(__recorded);
+	free(__order);
+	return failures ? 1 : 0;
+}
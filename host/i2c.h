@@ -0,0 +1,16 @@
+/*!
+ * @file i2c.h
+ *
+ * Host replacement of the CubeMX i2c.h (see main.h).
+ *
+ */
+
+#ifndef __HOST_I2C_H_
+#define __HOST_I2C_H_
+
+#include "main.h"
+
+extern I2C_HandleTypeDef hi2c1;
+extern I2C_HandleTypeDef hi2c2;
+
+#endif
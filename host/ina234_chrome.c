@@ -0,0 +1,271 @@
+/*!
+ * @file ina234_chrome.c
+ *
+ * Export of INA234 traces as Chrome trace events (see ina234_chrome.h).
+ *
+ */
+
+#include "ina234_chrome.h"
+#include "ina234_bus.h"
+
+/*!
+    @brief  Names of the ::EventType values
+*/
+static const char* const __INA234_Chrome_events[EVENTS] = {
+	[EVENT_ACQUIRE]					= "acquire",
+	[EVENT_SNAPSHOT]				= "readSnapshot",
+	[EVENT_ACQUIRE_NEXT]		= "acquireNext",
+	[EVENT_WAIT]						= "waitForData",
+	[EVENT_SLEEP]						= "sleep",
+	[EVENT_POLL]						= "poll",
+	[EVENT_SNAPSHOT_RETRY]	= "snapshot retry",
+	[EVENT_SAMPLE]					= "sample",
+	[EVENT_ALERT_ISR]				= "alert ISR",
+	[EVENT_ALERT_SLEEP]			= "sleepUntilAlert",
+	[EVENT_SWEEP_ISR]				= "sweep ISR",
+	[EVENT_BUS_WAIT]				= "bus wait",
+	[EVENT_BUS_TRANSFER]		= "bus transfer",
+	[EVENT_BUS_MISSED]			= "missed deadline",
+	[EVENT_BUS_ISR]					= "I2C callback",
+};
+
+static const char* const __INA234_Chrome_operations[] = {
+	[BUS_MEM_READ]	= "mem read",
+	[BUS_MEM_WRITE]	= "mem write",
+	[BUS_TRANSMIT]	= "transmit",
+	[BUS_RECEIVE]		= "receive",
+};
+
+static const char* const __INA234_Chrome_priorities[INA234_BUS_PRIORITIES] = {"critical", "high", "normal", "low"};
+
+/*!
+    @brief  Name of a register, or NULL if it is unknown
+*/
+static const char* __INA234_Chrome_register(uint8_t reg){
+	switch (reg) {
+		case CONFIGURATION_REGISTER:	return "CONFIGURATION";
+		case SHUNT_VOLTAGE_REGISTER:	return "SHUNT_VOLTAGE";
+		case BUS_VOLTAGE_REGISTER:		return "BUS_VOLTAGE";
+		case POWER_REGISTER:					return "POWER";
+		case CURRENT_REGISTER:				return "CURRENT";
+		case CALIBRATION_REGISTER:		return "CALIBRATION";
+		case MASK_ENABLE_REGISTER:		return "MASK_ENABLE";
+		case ALERT_LIMIT_REGISTER:		return "ALERT_LIMIT";
+		case MANUFACTURERID_REGISTER:	return "MANUFACTURER_ID";
+		case DEVICEID_REGISTER:				return "DEVICE_ID";
+	}
+	return NULL;
+}
+
+static const char* __INA234_Chrome_status(uint16_t status){
+	return status == STATUS_OK ? "ok" : status == STATUS_TimeOut ? "timeout" : status == STATUS_Torn ? "torn" : "?";
+}
+
+/*!
+    @brief  Thread of the events of a device: its 7 bit address
+*/
+static uint32_t __INA234_Chrome_thread(uint8_t address){
+	return address >> 1;
+}
+
+/*!
+    @brief  Start a trace event with its common fields. The caller adds the specific ones and closes it.
+*/
+static void __INA234_Chrome_open(INA234_Chrome* self, const char* ph, const char* name, const char* cat, int64_t ts, uint32_t pid, uint32_t tid){
+	fprintf(self->file, "%s\n{\"ph\":\"%s\",\"name\":\"%s\",\"cat\":\"%s\",\"ts\":%lld,\"pid\":%u,\"tid\":%u",
+					self->events ? "," : "", ph, name, cat, (long long)ts, (unsigned)pid, (unsigned)tid);
+	self->events++;
+}
+
+/*!
+    @brief  Write a JSON string with the quotes and backslashes escaped
+*/
+static void __INA234_Chrome_string(INA234_Chrome* self, const char* text){
+	fputc('"', self->file);
+	for(; *text; text++){
+		if(*text == '"' || *text == '\\')
+			fputc('\\', self->file);
+		if((unsigned char)*text >= 0x20)
+			fputc(*text, self->file);
+	}
+	fputc('"', self->file);
+}
+
+/*!
+    @brief  Write the metadata event that names a process or a thread
+*/
+static void __INA234_Chrome_name(INA234_Chrome* self, const char* kind, uint32_t pid, uint32_t tid, const char* name){
+	__INA234_Chrome_open(self, "M", kind, "__metadata", 0, pid, tid);
+	fprintf(self->file, ",\"args\":{\"name\":");
+	__INA234_Chrome_string(self, name);
+	fprintf(self->file, "}}");
+}
+
+/*!
+    @brief  Write one I2C transaction as a complete span of the bus thread
+*/
+static void __INA234_Chrome_transaction(INA234_Chrome* self, const INA234_TraceRecord* record, int64_t ts, uint32_t pid){
+	const char* reg = __INA234_Chrome_register(record->reg);
+	uint8_t write = record->flags & INA234_TRACE_WRITE;
+	char name[48];
+
+	if(record->address == 0 && write && record->size == 0)
+		snprintf(name, sizeof(name), "general call reset");
+	else if(reg)
+		snprintf(name, sizeof(name), "%s %s", write ? (record->size ? "write" : "pointer") : "read", reg);
+	else
+		snprintf(name, sizeof(name), "%s 0x%02X", write ? (record->size ? "write" : "pointer") : "read", record->reg);
+
+	__INA234_Chrome_open(self, "X", name, "i2c", ts, pid, INA234_CHROME_BUS_THREAD);
+	fprintf(self->file, ",\"dur\":%u,\"args\":{\"device\":\"0x%02X\",\"register\":\"0x%02X\"", record->duration, record->address >> 1, record->reg);
+	if(record->size == 2)
+		fprintf(self->file, ",\"data\":\"0x%02X%02X\"", record->data[0], record->data[1]);
+	else if(record->size == 1)
+		fprintf(self->file, ",\"data\":\"0x%02X\"", record->data[0]);
+	fprintf(self->file, ",\"status\":\"%s\"}}", (record->flags & INA234_TRACE_ERROR) ? "error" : "ok");
+}
+
+/*!
+    @brief  Write one event of the driver or of the bus queue
+*/
+static void __INA234_Chrome_event(INA234_Chrome* self, const INA234_TraceRecord* record, int64_t ts, uint32_t pid){
+	EventType event = (EventType)record->reg;
+	EventPhase phase = (EventPhase)record->size;
+	uint16_t argument = record->data[0] | ((uint16_t)record->data[1] << 8);
+	uint32_t tid = __INA234_Chrome_thread(record->address);
+	const char* ph = phase == PHASE_BEGIN ? "B" : phase == PHASE_END ? "E" : "i";
+
+	if(event >= EVENTS || phase > PHASE_INSTANT)
+		return;
+
+	switch (event) {
+		case EVENT_BUS_WAIT:
+			// Async span, since the waits of the devices overlap
+			__INA234_Chrome_open(self, phase == PHASE_BEGIN ? "b" : "e", __INA234_Chrome_events[event], "bus", ts, pid, tid);
+			fprintf(self->file, ",\"id\":\"0x%02X.%u\",\"args\":{\"priority\":\"%s\"}}", record->address >> 1, argument,
+							argument < INA234_BUS_PRIORITIES ? __INA234_Chrome_priorities[argument] : "?");
+			return;
+
+		case EVENT_BUS_TRANSFER:
+			__INA234_Chrome_open(self, ph, __INA234_Chrome_events[event], "bus", ts, pid, INA234_CHROME_QUEUE_THREAD);
+			if(phase == PHASE_BEGIN)
+				fprintf(self->file, ",\"args\":{\"device\":\"0x%02X\",\"operation\":\"%s\"}}", record->address >> 1,
+								argument <= BUS_RECEIVE ? __INA234_Chrome_operations[argument] : "?");
+			else
+				fprintf(self->file, ",\"args\":{\"status\":\"%s\"}}", __INA234_Chrome_status(argument));
+			return;
+
+		case EVENT_BUS_MISSED:
+			__INA234_Chrome_open(self, "i", __INA234_Chrome_events[event], "bus", ts, pid, INA234_CHROME_QUEUE_THREAD);
+			fprintf(self->file, ",\"s\":\"t\",\"args\":{\"device\":\"0x%02X\",\"priority\":\"%s\"}}", record->address >> 1,
+							argument < INA234_BUS_PRIORITIES ? __INA234_Chrome_priorities[argument] : "?");
+			return;
+
+		case EVENT_BUS_ISR:
+			__INA234_Chrome_open(self, "i", __INA234_Chrome_events[event], "bus", ts, pid, INA234_CHROME_QUEUE_THREAD);
+			fprintf(self->file, ",\"s\":\"t\",\"args\":{\"device\":\"0x%02X\",\"status\":\"%s\"}}", record->address >> 1, __INA234_Chrome_status(argument));
+			return;
+
+		default:
+			break;
+	}
+
+	__INA234_Chrome_open(self, ph, __INA234_Chrome_events[event], event == EVENT_ALERT_ISR || event == EVENT_SWEEP_ISR ? "isr" : "driver", ts, pid, tid);
+	if(phase == PHASE_INSTANT)
+		fprintf(self->file, ",\"s\":\"t\"");
+
+	switch (event) {
+		case EVENT_SLEEP:
+			if(phase == PHASE_BEGIN)
+				fprintf(self->file, ",\"args\":{\"time_us\":%u}", argument);
+			break;
+		case EVENT_POLL:
+			fprintf(self->file, ",\"args\":{\"CVRF\":%u}", argument);
+			break;
+		case EVENT_SNAPSHOT_RETRY:
+			fprintf(self->file, ",\"args\":{\"attempt\":%u}", argument);
+			break;
+		case EVENT_SAMPLE:
+			fprintf(self->file, ",\"args\":{\"fresh\":%u}", argument);
+			break;
+		case EVENT_SWEEP_ISR:
+			fprintf(self->file, ",\"args\":{\"item\":%u}", argument);
+			break;
+		case EVENT_ALERT_ISR:
+			break;
+		default:
+			if(phase == PHASE_END)
+				fprintf(self->file, ",\"args\":{\"status\":\"%s\"}", __INA234_Chrome_status(argument));
+			break;
+	}
+	fputc('}', self->file);
+}
+
+/*!
+    @brief  Start an export: write the header of the JSON
+    @param  self
+            A pointer to the export object (struct)
+		@param  file
+						The output
+*/
+void INA234_Chrome_begin(INA234_Chrome* self, FILE* file){
+	self->file = file;
+	self->events = 0;
+	fprintf(file, "{\"traceEvents\":[");
+}
+
+/*!
+    @brief  Write all of the records of a trace as one process
+    @param  self
+            A pointer to the export object (struct)
+		@param  trace
+						The trace, for example filled by ::INA234_Trace_load()
+		@param  pid
+						Process id of the trace. Each trace added to the same export needs its own.
+		@param  name
+						Process name shown in the viewer, for example the name of the bus
+		@return	Number of the trace events written
+*/
+uint32_t INA234_Chrome_addTrace(INA234_Chrome* self, const INA234_Trace* trace, uint32_t pid, const char* name){
+	uint32_t count = INA234_Trace_count(trace);
+	uint32_t events = self->events;
+	uint8_t devices[128] = {0};
+	INA234_TraceRecord record;
+	char thread[32];
+
+	__INA234_Chrome_name(self, "process_name", pid, 0, name);
+	__INA234_Chrome_name(self, "thread_name", pid, INA234_CHROME_BUS_THREAD, "I2C bus");
+	__INA234_Chrome_name(self, "thread_name", pid, INA234_CHROME_QUEUE_THREAD, "bus queue");
+	for(uint32_t i = 0; i < count; i++){
+		INA234_Trace_get(trace, i, &record);
+		if((record.flags & INA234_TRACE_EVENT) && record.reg < EVENT_BUS_WAIT && !devices[record.address >> 1]){
+			devices[record.address >> 1] = 1;
+			snprintf(thread, sizeof(thread), "INA234 0x%02X", record.address >> 1);
+			__INA234_Chrome_name(self, "thread_name", pid, __INA234_Chrome_thread(record.address), thread);
+		}
+	}
+
+	// A transaction is written when it ends, with the time it started, so the timestamps may go back a little: unwrap them by signed differences
+	int64_t time = 0;
+	uint32_t previous = 0;
+	for(uint32_t i = 0; i < count; i++){
+		INA234_Trace_get(trace, i, &record);
+		time = i ? time + (int32_t)(record.timestamp - previous) : record.timestamp;
+		previous = record.timestamp;
+
+		if(record.flags & INA234_TRACE_EVENT)
+			__INA234_Chrome_event(self, &record, time, pid);
+		else
+			__INA234_Chrome_transaction(self, &record, time, pid);
+	}
+	return self->events - events;
+}
+
+/*!
+    @brief  Finish an export: close the JSON
+    @param  self
+            A pointer to the export object (struct)
+*/
+void INA234_Chrome_end(INA234_Chrome* self){
+	fprintf(self->file, "\n]}\n");
+}
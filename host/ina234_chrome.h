@@ -0,0 +1,42 @@
+/*!
+ * @file ina234_chrome.h
+ *
+ * Export of INA234 traces (see ina234_trace.h) as Chrome trace events (JSON), to open in chrome://tracing or https://ui.perfetto.dev.
+ * Each trace is one process. In it, each device is one thread with the spans of its acquisitions, waits and sleeps (::INA234_setEventHook)
+ * and the instants of its polls, samples and interrupts. The I2C transactions are spans of the "I2C bus" thread, named after their register,
+ * and the transfers of the bus queue (::INA234_Bus_setEventHook) are spans of the "bus queue" thread, with their queue waits as async spans.
+ * The timestamps are the microseconds of the trace clock, unwrapped at 2^32, so the traces recorded with the same clock (for example the
+ * traces of two buses of the same MCU) share one timeline.
+ *
+ *   INA234_Chrome chrome;
+ *   INA234_Chrome_begin(&chrome, stdout);
+ *   INA234_Chrome_addTrace(&chrome, &trace, 1, "I2C1");
+ *   INA234_Chrome_end(&chrome);
+ *
+ */
+
+#ifndef __INA234_CHROME_H_
+#define __INA234_CHROME_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include "ina234_trace.h"
+
+#define INA234_CHROME_BUS_THREAD		0				// Thread of the I2C transactions
+#define INA234_CHROME_QUEUE_THREAD	1				// Thread of the transfers of the bus queue
+
+/*!
+    @brief  Class (struct) of an export
+*/
+typedef struct ina234_chrome{
+
+	FILE*			file;
+	uint32_t	events;													/*!< Number of the trace events written */
+
+} INA234_Chrome;
+
+void			INA234_Chrome_begin(INA234_Chrome* self, FILE* file);
+uint32_t	INA234_Chrome_addTrace(INA234_Chrome* self, const INA234_Trace* trace, uint32_t pid, const char* name);
+void			INA234_Chrome_end(INA234_Chrome* self);
+
+#endif
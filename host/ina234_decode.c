@@ -0,0 +1,82 @@
+/*!
+ * @file ina234_decode.c
+ *
+ * Host decoder of the INA234 binary telemetry protocol (see ina234_proto.h).
+ * It reads the raw byte stream of the USB CDC or UART port from a file (or stdin) and prints one CSV line per frame.
+ *
+ * Build:
+ *   gcc -O2 -I.. -o ina234_decode ina234_decode.c ../ina234_proto.c
+ *
+ * Usage:
+ *   ina234_decode [-c maximum_expected_current] [file]
+ *
+ * The maximum expected current must match MAXIMUM_EXPECTED_CURRENT of the firmware (5.0 by default).
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ina234_proto.h"
+
+int main(int argc, char** argv){
+	double maximum_expected_current = 5.0;
+	FILE* input = stdin;
+	
+	for(int i = 1; i < argc; i++){
+		if(!strcmp(argv[i], "-c") && i + 1 < argc){
+			maximum_expected_current = atof(argv[++i]);
+		}
+		else{
+			input = fopen(argv[i], "rb");
+			if(!input){
+				perror(argv[i]);
+				return 1;
+			}
+		}
+	}
+	
+	double current_lsb = maximum_expected_current / 2048.0;
+	double power_lsb = current_lsb * 0.032;
+	
+	INA234_ProtoDecoder decoder;
+	INA234_ProtoFrame frame;
+	int byte;
+	
+	INA234_Proto_initDecoder(&decoder);
+	
+	while((byte = fgetc(input)) != EOF){
+		if(!INA234_Proto_decode(&decoder, (uint8_t)byte, &frame))
+			continue;
+		
+		// The bytes after a resynchronization can hold more than one frame
+		do{
+			switch (frame.type) {
+				case PROTO_SAMPLE:
+					printf("sample,%u,%u,%u,%u,%.3f,%.3f,%.4f,%.4f\n",
+								 frame.device, frame.sequence,
+								 (unsigned)frame.payload.sample.timestamp, (unsigned)frame.payload.sample.sequence,
+								 frame.payload.sample.shunt_voltage * ((frame.payload.sample.flags & INA234_PROTO_FLAG_RANGE_20_48mV) ? 0.01 : 0.04),
+								 frame.payload.sample.bus_voltage * 0.025,
+								 frame.payload.sample.current * current_lsb,
+								 frame.payload.sample.power * power_lsb);
+					break;
+				case PROTO_STATS:
+					printf("stats,%u,%u,%u,%u,%u,%u,%u\n",
+								 frame.device, frame.sequence,
+								 (unsigned)frame.payload.stats.duplicates, (unsigned)frame.payload.stats.gaps,
+								 (unsigned)frame.payload.stats.snapshots, (unsigned)frame.payload.stats.tears, (unsigned)frame.payload.stats.torn_snapshots);
+					break;
+				case PROTO_ALERT:
+					printf("alert,%u,%u,%u,%u,0x%04X\n",
+								 frame.device, frame.sequence,
+								 (unsigned)frame.payload.alert.timestamp, frame.payload.alert.source, frame.payload.alert.mask_enable);
+					break;
+			}
+		}while(INA234_Proto_next(&decoder, &frame));
+	}
+	
+	fprintf(stderr, "frames: %u, crc errors: %u, parse errors: %u, lost frames: %u\n", (unsigned)decoder.frames, (unsigned)decoder.crc_errors,
+					(unsigned)decoder.parse_errors, (unsigned)decoder.lost_frames);
+	return 0;
+}
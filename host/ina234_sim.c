@@ -0,0 +1,592 @@
+/*!
+ * @file ina234_sim.c
+ *
+ * Simulated INA234 chips and the host HAL functions used by the library (see ina234_sim.h).
+ *
+ */
+
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include "ina234_sim.h"
+#include "ina234.h"
+
+I2C_HandleTypeDef hi2c1 = {.State = HAL_I2C_STATE_READY};
+I2C_HandleTypeDef hi2c2 = {.State = HAL_I2C_STATE_READY};
+
+INA234_SimBus ina234_sim_bus = {.frequency = 400000};
+
+static INA234_Sim* __INA234_Sim_devices[INA234_SIM_MAX_DEVICES];
+static uint8_t __INA234_Sim_count = 0;
+
+static uint8_t __INA234_Sim_open = 0;	// A sequential transfer holds the bus (no STOP yet)
+
+// Completion callbacks deferred to INA234_Sim_advance (ina234_sim_bus::deferred)
+static struct{
+	I2C_HandleTypeDef*	hi2c;
+	void								(*callback)(I2C_HandleTypeDef* hi2c);
+	double							due;
+	uint8_t							mem;				// A memory transfer, which HAL_I2C_Master_Abort_IT rejects
+} __INA234_Sim_pending[INA234_SIM_MAX_BUSES];
+static uint8_t __INA234_Sim_firing = 0;
+static uint8_t __INA234_Sim_async = 0;		// Inside an _IT or _DMA transfer: with ina234_sim_bus::deferred, the bus time is added to __INA234_Sim_async_us instead of the virtual time
+static double __INA234_Sim_async_us = 0;
+
+static const uint16_t __INA234_Sim_conversionTimes[8] = {140, 204, 332, 588, 1100, 2116, 4156, 8244};
+static const uint16_t __INA234_Sim_numberOfSamples[8] = {1, 4, 16, 64, 128, 256, 512, 1024};
+
+/*!
+    @brief  Host monotonic time in nano seconds
+*/
+uint64_t INA234_Sim_hostTime(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*!
+    @brief  Remove all of the simulated chips and reset the virtual time
+*/
+void INA234_Sim_reset(void){
+	__INA234_Sim_count = 0;
+	__INA234_Sim_open = 0;
+	memset(__INA234_Sim_pending, 0, sizeof(__INA234_Sim_pending));
+	memset(&ina234_sim_bus, 0, sizeof(ina234_sim_bus));
+	ina234_sim_bus.frequency = 400000;
+}
+
+/*!
+    @brief  Put a simulated chip on a bus. The registers get their reset values.
+*/
+void INA234_Sim_attach(INA234_Sim* self, I2C_HandleTypeDef* hi2c, uint8_t address){
+	memset(self->regs, 0, sizeof(self->regs));
+	self->hi2c = hi2c;
+	self->address = address;
+	self->regs[CONFIGURATION_REGISTER] = 0x4127 & 0x3FFF;
+	self->regs[MANUFACTURERID_REGISTER] = INA234_MANUFACTURER_ID;
+	self->regs[DEVICEID_REGISTER] = INA234_DEVICE_ID << 4;
+	self->next_conversion = 0;
+	self->conversions = 0;
+	if(!self->noise_state)
+		self->noise_state = 0x9E3779B97F4A7C15ULL ^ address;
+	hi2c->State = HAL_I2C_STATE_READY;
+	__INA234_Sim_devices[__INA234_Sim_count++] = self;
+}
+
+static INA234_Sim* __INA234_Sim_find(I2C_HandleTypeDef* hi2c, uint16_t DevAddress){
+	for(uint8_t i = 0; i < __INA234_Sim_count; i++)
+		if(__INA234_Sim_devices[i]->hi2c == hi2c && __INA234_Sim_devices[i]->address == (DevAddress >> 1))
+			return __INA234_Sim_devices[i];
+	return NULL;
+}
+
+static double __INA234_Sim_gaussian(INA234_Sim* self){
+	// xorshift64* and Box-Muller, deterministic per chip
+	double u[2];
+	for(int i = 0; i < 2; i++){
+		self->noise_state ^= self->noise_state >> 12;
+		self->noise_state ^= self->noise_state << 25;
+		self->noise_state ^= self->noise_state >> 27;
+		u[i] = ((self->noise_state * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+	}
+	return sqrt(-2.0 * log(u[0] + 1e-300)) * cos(2.0 * M_PI * u[1]);
+}
+
+static uint32_t __INA234_Sim_period(INA234_Sim* self){
+	uint16_t config = self->regs[CONFIGURATION_REGISTER];
+	uint8_t mode = config & 0x07;
+	uint32_t period = 0;
+	
+	if(mode & 0x01)
+		period += __INA234_Sim_conversionTimes[(config >> 3) & 0x07];
+	if(mode & 0x02)
+		period += __INA234_Sim_conversionTimes[(config >> 6) & 0x07];
+	period *= __INA234_Sim_numberOfSamples[(config >> 9) & 0x07];
+	return self->period_scale > 0 ? (uint32_t)lround(period * self->period_scale) : period;
+}
+
+static int32_t __INA234_Sim_clamp(double value, int32_t min, int32_t max){
+	long rounded = lround(value);
+	return rounded < min ? min : rounded > max ? max : (int32_t)rounded;
+}
+
+/*!
+    @brief  Average the inputs of a simulated chip over one conversion window, like the integrating ADC, with a midpoint sample every
+						INA234_SIM_WINDOW_STEP us (at least 4)
+*/
+static void __INA234_Sim_integrate(INA234_Sim* self, double start_us, double length_us, double* shunt_mV, double* bus_V){
+	uint32_t steps = (uint32_t)(length_us / INA234_SIM_WINDOW_STEP);
+	double shunt_sum = 0, bus_sum = 0;
+	
+	if(steps < 4)
+		steps = 4;
+	for(uint32_t i = 0; i < steps; i++){
+		double shunt = self->shunt_mV, bus = self->bus_V;
+		self->source(self->source_context, start_us + (i + 0.5) * length_us / steps, &shunt, &bus);
+		shunt_sum += shunt;
+		bus_sum += bus;
+	}
+	*shunt_mV = shunt_sum / steps;
+	*bus_V = bus_sum / steps;
+}
+
+/*!
+    @brief  Do one conversion of the simulated chip, which ends at the given virtual time
+*/
+static void __INA234_Sim_convert(INA234_Sim* self, double time_us){
+	uint16_t config = self->regs[CONFIGURATION_REGISTER];
+	uint8_t mode = config & 0x07;
+	double shunt_mV = self->shunt_mV, bus_V = self->bus_V;
+	
+	// Each of the averaged ADC samples converts the shunt voltage, then the bus voltage, over its own conversion time, with its own noise
+	// and quantization, and the chip reports the mean of their codes
+	double scale = self->period_scale > 0 ? self->period_scale : 1.0;
+	double shunt_ct = (mode & 0x01) ? __INA234_Sim_conversionTimes[(config >> 3) & 0x07] : 0;
+	double bus_ct = (mode & 0x02) ? __INA234_Sim_conversionTimes[(config >> 6) & 0x07] : 0;
+	uint16_t n = __INA234_Sim_numberOfSamples[(config >> 9) & 0x07];
+	double start = time_us - n * (shunt_ct + bus_ct) * scale, shunt_sum = 0, bus_sum = 0, unused;
+	double shunt_lsb = (config & 0x1000) ? SHUNT_VOLTAGE_20_48mv_LSB : SHUNT_VOLTAGE_81_92mv_LSB;
+	int64_t shunt_codes = 0, bus_codes = 0;
+	
+	for(uint16_t i = 0; i < n; i++, start += (shunt_ct + bus_ct) * scale){
+		double shunt = shunt_mV, bus = bus_V;
+		if(self->source && (mode & 0x01))
+			__INA234_Sim_integrate(self, start, shunt_ct * scale, &shunt, &unused);
+		if(self->source && (mode & 0x02))
+			__INA234_Sim_integrate(self, start + shunt_ct * scale, bus_ct * scale, &unused, &bus);
+		shunt_sum += shunt;
+		bus_sum += bus;
+		
+		// Input referred noise: white noise, lower for the longer conversion times
+		if(self->noise_uV > 0 && (mode & 0x01))
+			shunt += self->noise_uV * 1e-3 * sqrt(140.0 / shunt_ct) * __INA234_Sim_gaussian(self);
+		if(self->noise_uV > 0 && (mode & 0x02))
+			bus += self->noise_uV * 1e-3 * 25.0 * sqrt(140.0 / bus_ct) * __INA234_Sim_gaussian(self) * 1e-3;
+		shunt_codes += __INA234_Sim_clamp(shunt / shunt_lsb, -2048, 2047);
+		bus_codes += __INA234_Sim_clamp(bus / BUS_VOLTAGE_LSB, 0, 2047);
+	}
+	self->converted_us = time_us;
+	self->converted_shunt_mV = shunt_sum / n;
+	self->converted_bus_V = bus_sum / n;
+	
+	int32_t vshunt = (int16_t)self->regs[SHUNT_VOLTAGE_REGISTER] >> 4;
+	int32_t vbus = self->regs[BUS_VOLTAGE_REGISTER] >> 4;
+	
+	if(mode & 0x01)
+		vshunt = __INA234_Sim_clamp((double)shunt_codes / n, -2048, 2047);
+	if(mode & 0x02)
+		vbus = __INA234_Sim_clamp((double)bus_codes / n, 0, 2047);
+	
+	uint16_t shunt_cal = self->regs[CALIBRATION_REGISTER] & 0x7FFF;
+	int32_t current = __INA234_Sim_clamp((double)vshunt * shunt_cal / 2048.0, -2048, 2047);
+	int32_t power = __INA234_Sim_clamp(fabs((double)current) * vbus * 25.0 / 32.0, 0, 65535);
+	
+	self->regs[SHUNT_VOLTAGE_REGISTER] = (uint16_t)(vshunt << 4);
+	self->regs[BUS_VOLTAGE_REGISTER] = (uint16_t)(vbus << 4);
+	self->regs[CURRENT_REGISTER] = (uint16_t)(current << 4);
+	self->regs[POWER_REGISTER] = (uint16_t)power;
+	
+	// Alert flags
+	uint16_t mask = self->regs[MASK_ENABLE_REGISTER];
+	int16_t limit = (int16_t)self->regs[ALERT_LIMIT_REGISTER];
+	uint8_t reached = ((mask & 0x8000) && vshunt > limit) || ((mask & 0x4000) && vshunt < limit) ||
+										((mask & 0x2000) && vbus > limit) || ((mask & 0x1000) && vbus < limit) ||
+										((mask & 0x0800) && power > (uint16_t)limit);
+	if(reached)
+		mask |= 0x0010;
+	else if(!(mask & 0x0001))
+		mask &= ~0x0010;
+	self->regs[MASK_ENABLE_REGISTER] = mask | 0x0008;
+	
+	self->conversions++;
+}
+
+/*!
+    @brief  Run the conversions of a simulated chip up to the current virtual time
+*/
+static void __INA234_Sim_update(INA234_Sim* self){
+	uint8_t mode = self->regs[CONFIGURATION_REGISTER] & 0x07;
+	uint32_t period = __INA234_Sim_period(self);
+	double now = ina234_sim_bus.time_us;
+	
+	if(period == 0 || mode == 0 || mode == 4 || self->next_conversion == 0 || now < self->next_conversion)
+		return;
+	
+	if(mode & 0x04){
+		uint64_t count = (uint64_t)((now - self->next_conversion) / period);
+		self->next_conversion += count * period;
+		__INA234_Sim_convert(self, self->next_conversion);
+		self->next_conversion += period;
+	}
+	else{
+		// Single shot: one conversion, then stay idle until the configuration is written again
+		__INA234_Sim_convert(self, self->next_conversion);
+		self->next_conversion = 0;
+	}
+}
+
+/*!
+    @brief  Advance the virtual time and run the conversions of all of the simulated chips
+*/
+void INA234_Sim_advance(double time_us){
+	ina234_sim_bus.time_us += time_us;
+	for(uint8_t i = 0; i < __INA234_Sim_count; i++)
+		__INA234_Sim_update(__INA234_Sim_devices[i]);
+	
+	// The deferred completion interrupts of the transfers that ended (the transfers started by the callbacks are completed by a later advance)
+	if(__INA234_Sim_firing)
+		return;
+	__INA234_Sim_firing = 1;
+	for(uint8_t i = 0; i < INA234_SIM_MAX_BUSES; i++){
+		I2C_HandleTypeDef* hi2c = __INA234_Sim_pending[i].hi2c;
+		if(!hi2c || __INA234_Sim_pending[i].due > ina234_sim_bus.time_us)
+			continue;
+		__INA234_Sim_pending[i].hi2c = NULL;
+		hi2c->State = HAL_I2C_STATE_READY;
+		__INA234_Sim_pending[i].callback(hi2c);
+	}
+	__INA234_Sim_firing = 0;
+}
+
+/*!
+    @brief  Wait for an interrupt, like a WFI or an RTOS yield: advance the virtual time to the next deferred completion (see ina234_sim_bus::deferred),
+						or by 1us if there is none. Use it as the idle function of the blocking waits (for example ina234_bus::idle), because the virtual time
+						and HAL_GetTick() only move when the simulation is advanced.
+*/
+void INA234_Sim_idle(void){
+	double due = ina234_sim_bus.time_us + 1.0;
+	
+	for(uint8_t i = 0; i < INA234_SIM_MAX_BUSES; i++)
+		if(__INA234_Sim_pending[i].hi2c && __INA234_Sim_pending[i].due < due)
+			due = __INA234_Sim_pending[i].due;
+	INA234_Sim_advance(due > ina234_sim_bus.time_us ? due - ina234_sim_bus.time_us : 0);
+}
+
+/*!
+    @brief  Call the completion callback of an _IT or _DMA transfer: before returning, or from the next INA234_Sim_advance if ina234_sim_bus::deferred is set
+*/
+static void __INA234_Sim_complete(I2C_HandleTypeDef* hi2c, void (*callback)(I2C_HandleTypeDef* hi2c), uint8_t mem){
+	if(!ina234_sim_bus.deferred){
+		callback(hi2c);
+		return;
+	}
+	for(uint8_t i = 0; i < INA234_SIM_MAX_BUSES; i++){
+		if(!__INA234_Sim_pending[i].hi2c){
+			__INA234_Sim_pending[i].hi2c = hi2c;
+			__INA234_Sim_pending[i].callback = callback;
+			__INA234_Sim_pending[i].due = ina234_sim_bus.time_us + __INA234_Sim_async_us;
+			__INA234_Sim_pending[i].mem = mem;
+			hi2c->State = HAL_I2C_STATE_BUSY;
+			return;
+		}
+	}
+	callback(hi2c);
+}
+
+static void __INA234_Sim_clock(uint32_t bits){
+	ina234_sim_bus.bits += bits;
+	if(__INA234_Sim_async && ina234_sim_bus.deferred)
+		__INA234_Sim_async_us += bits * 1e6 / ina234_sim_bus.frequency;
+	else
+		INA234_Sim_advance(bits * 1e6 / ina234_sim_bus.frequency);
+}
+
+static void __INA234_Sim_beginAsync(void){
+	__INA234_Sim_async = 1;
+	__INA234_Sim_async_us = 0;
+}
+
+static void __INA234_Sim_transaction(uint32_t bits){
+	ina234_sim_bus.transactions++;
+	__INA234_Sim_clock(bits);
+}
+
+static void __INA234_Sim_write(INA234_Sim* self, uint8_t MemAddress, uint16_t value){
+	switch (MemAddress) {
+		case CONFIGURATION_REGISTER:
+			if(value & 0x8000){
+				uint8_t address = self->address;
+				I2C_HandleTypeDef* hi2c = self->hi2c;
+				memset(self->regs, 0, sizeof(self->regs));
+				self->hi2c = hi2c;
+				self->address = address;
+				self->regs[CONFIGURATION_REGISTER] = 0x4127 & 0x3FFF;
+				self->regs[MANUFACTURERID_REGISTER] = INA234_MANUFACTURER_ID;
+				self->regs[DEVICEID_REGISTER] = INA234_DEVICE_ID << 4;
+			}
+			else{
+				self->regs[CONFIGURATION_REGISTER] = value & 0x3FFF;
+			}
+			self->next_conversion = (uint64_t)ina234_sim_bus.time_us + __INA234_Sim_period(self);
+			break;
+		case CALIBRATION_REGISTER:
+			self->regs[CALIBRATION_REGISTER] = value & 0x7FFF;
+			break;
+		case MASK_ENABLE_REGISTER:
+			self->regs[MASK_ENABLE_REGISTER] = (value & 0xFC03) | (self->regs[MASK_ENABLE_REGISTER] & 0x003C);
+			break;
+		case ALERT_LIMIT_REGISTER:
+			self->regs[ALERT_LIMIT_REGISTER] = value;
+			break;
+	}
+}
+
+static uint16_t __INA234_Sim_read(INA234_Sim* self, uint8_t MemAddress){
+	uint16_t value = self->regs[MemAddress & 0x3F];
+	
+	// Reading the mask/enable register clears the conversion ready flag and the latched alert
+	if(MemAddress == MASK_ENABLE_REGISTER)
+		self->regs[MASK_ENABLE_REGISTER] &= ~0x0018;
+	return value;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size, uint32_t Timeout){
+	uint64_t start = INA234_Sim_hostTime();
+	INA234_Sim* sim = __INA234_Sim_find(hi2c, DevAddress);
+	(void)Timeout;
+	
+	hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+	if(!sim){
+		__INA234_Sim_transaction(10);
+		ina234_sim_bus.nacks++;
+		hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+		ina234_sim_bus.cpu_ns += INA234_Sim_hostTime() - start;
+		return HAL_ERROR;
+	}
+	
+	// START, address, register, repeated START, address, data bytes, STOP
+	__INA234_Sim_transaction(1 + 9 + 9 * (MemAddSize == I2C_MEMADD_SIZE_16BIT ? 2 : 1) + 1 + 9 + 9 * Size + 1);
+	sim->pointer = MemAddress;
+	
+	for(uint16_t i = 0; i < Size; i += 2){
+		uint16_t value = __INA234_Sim_read(sim, MemAddress + i / 2);
+		pData[i] = value >> 8;
+		if(i + 1 < Size)
+			pData[i + 1] = value & 0xFF;
+	}
+	
+	ina234_sim_bus.cpu_ns += INA234_Sim_hostTime() - start;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size, uint32_t Timeout){
+	uint64_t start = INA234_Sim_hostTime();
+	INA234_Sim* sim = __INA234_Sim_find(hi2c, DevAddress);
+	(void)Timeout;
+	
+	hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+	if(!sim){
+		__INA234_Sim_transaction(10);
+		ina234_sim_bus.nacks++;
+		hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+		ina234_sim_bus.cpu_ns += INA234_Sim_hostTime() - start;
+		return HAL_ERROR;
+	}
+	
+	__INA234_Sim_transaction(1 + 9 + 9 * (MemAddSize == I2C_MEMADD_SIZE_16BIT ? 2 : 1) + 9 * Size + 1);
+	sim->pointer = MemAddress;
+	if(Size >= 2)
+		__INA234_Sim_write(sim, MemAddress, (uint16_t)((pData[0] << 8) | pData[1]));
+	
+	ina234_sim_bus.cpu_ns += INA234_Sim_hostTime() - start;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size){
+	if(hi2c->State != HAL_I2C_STATE_READY)
+		return HAL_BUSY;
+	
+	// The data is transferred immediately in the simulation, see __INA234_Sim_complete for the callback
+	__INA234_Sim_beginAsync();
+	HAL_StatusTypeDef result = HAL_I2C_Mem_Read(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size, 0);
+	__INA234_Sim_async = 0;
+	__INA234_Sim_complete(hi2c, result == HAL_OK ? HAL_I2C_MemRxCpltCallback : HAL_I2C_ErrorCallback, 1);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size){
+	if(hi2c->State != HAL_I2C_STATE_READY)
+		return HAL_BUSY;
+	
+	__INA234_Sim_beginAsync();
+	HAL_StatusTypeDef result = HAL_I2C_Mem_Write(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size, 0);
+	__INA234_Sim_async = 0;
+	__INA234_Sim_complete(hi2c, result == HAL_OK ? HAL_I2C_MemTxCpltCallback : HAL_I2C_ErrorCallback, 1);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size){
+	return HAL_I2C_Mem_Read_IT(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size){
+	return HAL_I2C_Mem_Write_IT(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size, uint32_t Timeout){
+	(void)Timeout;
+	__INA234_Sim_transaction(1 + 9 + 9 * Size + 1);
+	
+	// General call reset
+	if(DevAddress == 0x00 && Size == 1 && pData[0] == 0x06){
+		for(uint8_t i = 0; i < __INA234_Sim_count; i++)
+			if(__INA234_Sim_devices[i]->hi2c == hi2c)
+				__INA234_Sim_write(__INA234_Sim_devices[i], CONFIGURATION_REGISTER, 0x8000);
+	}
+	return HAL_OK;
+}
+
+/*!
+    @brief  One sequential transfer. Every frame starts with a (repeated) START and the address; the STOP is only sent by the last frames.
+						The transfer completes immediately, so the completion callback is called before returning, like a very fast interrupt.
+*/
+static HAL_StatusTypeDef __INA234_Sim_frame(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size, uint32_t XferOptions, uint8_t read){
+	uint64_t start = INA234_Sim_hostTime();
+	INA234_Sim* sim = __INA234_Sim_find(hi2c, DevAddress);
+	uint8_t stop = XferOptions == I2C_LAST_FRAME || XferOptions == I2C_FIRST_AND_LAST_FRAME;
+	
+	if(hi2c->State != HAL_I2C_STATE_READY)
+		return HAL_BUSY;
+	__INA234_Sim_beginAsync();
+	
+	if(!__INA234_Sim_open)
+		ina234_sim_bus.transactions++;
+	__INA234_Sim_open = !stop;
+	ina234_sim_bus.frames++;
+	hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+	hi2c->XferOptions = XferOptions;
+	
+	if(!sim){
+		// The HAL sends a STOP after a NACK
+		__INA234_Sim_open = 0;
+		__INA234_Sim_clock(10 + 1);
+		ina234_sim_bus.nacks++;
+		hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+		ina234_sim_bus.cpu_ns += INA234_Sim_hostTime() - start;
+		__INA234_Sim_async = 0;
+		__INA234_Sim_complete(hi2c, HAL_I2C_ErrorCallback, 0);
+		return HAL_OK;
+	}
+	
+	__INA234_Sim_clock(1 + 9 + 9 * Size + stop);
+	
+	if(read){
+		for(uint16_t i = 0; i < Size; i += 2){
+			uint16_t value = __INA234_Sim_read(sim, sim->pointer);
+			pData[i] = value >> 8;
+			if(i + 1 < Size)
+				pData[i + 1] = value & 0xFF;
+		}
+	}
+	else if(Size >= 1){
+		sim->pointer = pData[0];
+		if(Size >= 3)
+			__INA234_Sim_write(sim, pData[0], (uint16_t)((pData[1] << 8) | pData[2]));
+	}
+	
+	ina234_sim_bus.cpu_ns += INA234_Sim_hostTime() - start;
+	__INA234_Sim_async = 0;
+	if(read)
+		__INA234_Sim_complete(hi2c, HAL_I2C_MasterRxCpltCallback, 0);
+	else
+		__INA234_Sim_complete(hi2c, HAL_I2C_MasterTxCpltCallback, 0);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Transmit_IT(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size, uint32_t XferOptions){
+	return __INA234_Sim_frame(hi2c, DevAddress, pData, Size, XferOptions, 0);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_IT(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size, uint32_t XferOptions){
+	return __INA234_Sim_frame(hi2c, DevAddress, pData, Size, XferOptions, 1);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Transmit_DMA(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size, uint32_t XferOptions){
+	return __INA234_Sim_frame(hi2c, DevAddress, pData, Size, XferOptions, 0);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_DMA(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size, uint32_t XferOptions){
+	return __INA234_Sim_frame(hi2c, DevAddress, pData, Size, XferOptions, 1);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size){
+	return __INA234_Sim_frame(hi2c, DevAddress, pData, Size, I2C_FIRST_AND_LAST_FRAME, 0);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive_IT(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size){
+	return __INA234_Sim_frame(hi2c, DevAddress, pData, Size, I2C_FIRST_AND_LAST_FRAME, 1);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_DMA(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size){
+	return __INA234_Sim_frame(hi2c, DevAddress, pData, Size, I2C_FIRST_AND_LAST_FRAME, 0);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive_DMA(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size){
+	return __INA234_Sim_frame(hi2c, DevAddress, pData, Size, I2C_FIRST_AND_LAST_FRAME, 1);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Abort_IT(I2C_HandleTypeDef* hi2c, uint16_t DevAddress){
+	(void)DevAddress;
+	// Like the HAL, only the master transfers can be aborted
+	for(uint8_t i = 0; i < INA234_SIM_MAX_BUSES; i++)
+		if(__INA234_Sim_pending[i].hi2c == hi2c && __INA234_Sim_pending[i].mem)
+			return HAL_ERROR;
+	
+	__INA234_Sim_open = 0;
+	for(uint8_t i = 0; i < INA234_SIM_MAX_BUSES; i++)
+		if(__INA234_Sim_pending[i].hi2c == hi2c)
+			__INA234_Sim_pending[i].hi2c = NULL;
+	__INA234_Sim_clock(1);
+	hi2c->State = HAL_I2C_STATE_READY;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef* hi2c){
+	// The peripheral is reset: the running transfer stops without a callback
+	__INA234_Sim_open = 0;
+	for(uint8_t i = 0; i < INA234_SIM_MAX_BUSES; i++)
+		if(__INA234_Sim_pending[i].hi2c == hi2c)
+			__INA234_Sim_pending[i].hi2c = NULL;
+	hi2c->State = HAL_I2C_STATE_RESET;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef* hi2c){
+	hi2c->State = HAL_I2C_STATE_READY;
+	hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+	return HAL_OK;
+}
+
+// Weak completion callbacks, like the HAL ones
+__attribute__((weak)) void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef* hi2c){ (void)hi2c; }
+__attribute__((weak)) void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef* hi2c){ (void)hi2c; }
+__attribute__((weak)) void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef* hi2c){ (void)hi2c; }
+__attribute__((weak)) void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef* hi2c){ (void)hi2c; }
+__attribute__((weak)) void HAL_I2C_ErrorCallback(I2C_HandleTypeDef* hi2c){ (void)hi2c; }
+
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint32_t Trials, uint32_t Timeout){
+	(void)Timeout;
+	for(uint32_t i = 0; i < Trials; i++){
+		__INA234_Sim_transaction(1 + 9 + 1);
+		if(__INA234_Sim_find(hi2c, DevAddress))
+			return HAL_OK;
+		ina234_sim_bus.nacks++;
+	}
+	return HAL_ERROR;
+}
+
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef* hi2c){
+	return hi2c->State;
+}
+
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef* hi2c){
+	return hi2c->ErrorCode;
+}
+
+uint32_t HAL_GetTick(void){
+	return (uint32_t)(ina234_sim_bus.time_us / 1000.0);
+}
+
+void HAL_Delay(uint32_t Delay){
+	INA234_Sim_advance(Delay * 1000.0);
+}
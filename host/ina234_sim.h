@@ -0,0 +1,77 @@
+/*!
+ * @file ina234_sim.h
+ *
+ * Simulated INA234 chips behind the host HAL (see main.h). The simulation keeps a virtual time which is advanced by the
+ * I2C transactions (at ina234_sim_bus::frequency) and by HAL_Delay, converts the analog inputs at the configured
+ * conversion period, and updates the registers like the real chip.
+ *
+ */
+
+#ifndef __INA234_SIM_H_
+#define __INA234_SIM_H_
+
+#include <stdint.h>
+#include "main.h"
+
+#define INA234_SIM_MAX_DEVICES		16
+#define INA234_SIM_MAX_BUSES			4
+#define INA234_SIM_WINDOW_STEP		35				// Time (in us) between the samples of the source in a conversion window
+
+/*! 
+    @brief  Analog inputs of a simulated chip at a given time. The chip averages them over the conversion windows, so it calls the source
+						several times for each conversion.
+*/
+typedef void (*INA234_SimSource)(void* context, double time_us, double* shunt_mV, double* bus_V);
+
+/*! 
+    @brief  Class (struct) of one simulated INA234
+*/
+typedef struct ina234_sim{
+	
+	I2C_HandleTypeDef*	hi2c;
+	uint8_t							address;							/*!< 7bit I2C address */
+	uint16_t						regs[0x40];
+	uint8_t							pointer;							/*!< Register pointer, set by the writes and used by the plain reads */
+	
+	double							shunt_mV;							/*!< Shunt voltage input, used if there is no source */
+	double							bus_V;								/*!< Bus voltage input, used if there is no source */
+	INA234_SimSource		source;
+	void*								source_context;
+	
+	double							noise_uV;							/*!< RMS input referred noise of one 140us shunt conversion (0 for an ideal ADC) */
+	uint64_t						noise_state;
+	
+	double							period_scale;					/*!< Actual conversion period / datasheet one, for the timebase error of the chip (1 if 0) */
+	uint64_t						next_conversion;			/*!< Virtual time (in us) of the next conversion */
+	uint32_t						conversions;
+	double							converted_us;					/*!< Virtual time of the end of the last conversion */
+	double							converted_shunt_mV;		/*!< Shunt voltage input of the last conversion, averaged over its conversion windows (without the noise) */
+	double							converted_bus_V;			/*!< Bus voltage input of the last conversion, averaged over its conversion windows (without the noise) */
+	
+} INA234_Sim;
+
+/*! 
+    @brief  Virtual time and I2C bus statistics of the simulation
+*/
+typedef struct ina234_sim_bus{
+	
+	double		time_us;								/*!< Virtual time */
+	uint32_t	frequency;							/*!< I2C clock (in Hz), 400kHz by default */
+	uint64_t	bits;										/*!< Number of bits clocked on the bus */
+	uint32_t	transactions;						/*!< Number of START ... STOP transactions */
+	uint32_t	frames;									/*!< Number of sequential transfers (HAL_I2C_Master_Seq_...) */
+	uint32_t	nacks;
+	uint64_t	cpu_ns;									/*!< Host CPU time spent in the simulation */
+	uint8_t		deferred;								/*!< 1 to call the completion callbacks of the _IT and _DMA transfers from the next INA234_Sim_advance (like an interrupt), 0 to call them before returning */
+	
+} INA234_SimBus;
+
+extern INA234_SimBus ina234_sim_bus;
+
+void		INA234_Sim_reset(void);
+void		INA234_Sim_attach(INA234_Sim* self, I2C_HandleTypeDef* hi2c, uint8_t address);
+void		INA234_Sim_advance(double time_us);
+void		INA234_Sim_idle(void);
+uint64_t INA234_Sim_hostTime(void);
+
+#endif
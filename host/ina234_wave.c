@@ -0,0 +1,351 @@
+/*!
+ * @file ina234_wave.c
+ *
+ * Synthetic load waveforms for the simulated INA234 (see ina234_wave.h).
+ *
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ina234_wave.h"
+
+/*!
+    @brief  Name, keys and required keys (bit i for key i) of each ::WaveKind
+*/
+static const struct{
+	const char*	name;
+	const char*	keys[INA234_WAVE_MAX_KEYS];
+	uint8_t			required;
+	double			defaults[INA234_WAVE_MAX_KEYS];
+} __INA234_Wave_kinds[WAVE_KINDS] = {
+	[WAVE_DC]				= {"dc",				{"level"},																		0x01, {0}},
+	[WAVE_STEP]			= {"step",			{"at", "level", "rise", "width"},							0x03, {0}},
+	[WAVE_PWM]			= {"pwm",				{"period", "duty", "level", "start", "pulses", "every"},	0x07, {0}},
+	[WAVE_RIPPLE]		= {"ripple",		{"freq", "amp", "phase"},											0x03, {0}},
+	[WAVE_RAMP]			= {"ramp",			{"start", "end", "level"},										0x07, {0}},
+	[WAVE_BROWNOUT]	= {"brownout",	{"at", "depth", "duration", "fall", "recover", "every"},	0x07, {0}},
+	[WAVE_STEPS]		= {"steps",			{"every", "min", "max", "start"},							0x07, {0}},
+	[WAVE_NOISE]		= {"noise",			{"rms", "hold"},															0x01, {0, 1}},
+};
+
+/*!
+    @brief  Built-in scenarios: a name followed by its text
+*/
+static const char* const __INA234_Wave_texts[] = {
+	"idle",
+		"shunt dc level=0.5\n"
+		"shunt noise rms=0.02\n"
+		"bus dc level=12\n",
+	"step",
+		"shunt dc level=1\n"
+		"shunt step at=20000 level=14 rise=50\n"
+		"shunt step at=60000 level=-14 rise=50\n"
+		"bus dc level=12\n"
+		"bus step at=20000 level=-0.3 rise=200\n"
+		"bus step at=60000 level=0.3 rise=200\n",
+	"pwm",
+		"shunt dc level=0.5\n"
+		"shunt pwm period=500 duty=0.3 level=16 pulses=20 every=40000\n"
+		"bus dc level=5\n"
+		"bus pwm period=500 duty=0.3 level=-0.1 pulses=20 every=40000\n",
+	"ripple",
+		"shunt dc level=10\n"
+		"shunt ripple freq=1000 amp=8\n"
+		"bus dc level=12\n"
+		"bus ripple freq=20 amp=0.5\n",
+	"ramp",
+		"shunt ramp start=0 end=1000000 level=18\n"
+		"bus dc level=3.3\n"
+		"bus ramp start=0 end=1000000 level=1.7\n",
+	"brownout",
+		"shunt dc level=6\n"
+		"shunt brownout at=30000 depth=5 duration=5000 fall=100 recover=2000 every=100000\n"
+		"bus dc level=12\n"
+		"bus brownout at=30000 depth=5 duration=5000 fall=100 recover=2000 every=100000\n",
+	"noise",
+		"shunt dc level=5\n"
+		"shunt noise rms=0.5\n"
+		"bus dc level=12\n"
+		"bus noise rms=0.05 hold=100\n",
+	"mixed",
+		"shunt dc level=2\n"
+		"shunt steps every=25000 min=0 max=12\n"
+		"shunt pwm period=1000 duty=0.25 level=6 pulses=10 every=50000\n"
+		"shunt ripple freq=2000 amp=0.3\n"
+		"shunt noise rms=0.05\n"
+		"bus dc level=12\n"
+		"bus brownout at=70000 depth=3 duration=4000 fall=300 recover=1500 every=200000\n"
+		"bus noise rms=0.01\n",
+	NULL
+};
+
+const char* const ina234_wave_scenarios[] = {"idle", "step", "pwm", "ripple", "ramp", "brownout", "noise", "mixed", NULL};
+
+/*!
+    @brief  Hash of the seed, a component and a time slot (splitmix64), so the random values do not depend on the order of evaluation
+*/
+static uint64_t __INA234_Wave_hash(uint64_t seed, uint32_t component, int64_t slot){
+	uint64_t x = seed ^ ((uint64_t)component << 56) ^ (uint64_t)slot;
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+static double __INA234_Wave_uniform(uint64_t hash){
+	return (hash >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double __INA234_Wave_gaussian(uint64_t seed, uint32_t component, int64_t slot){
+	// Box-Muller from two hashes of the same slot
+	double u0 = __INA234_Wave_uniform(__INA234_Wave_hash(seed, component, slot));
+	double u1 = __INA234_Wave_uniform(__INA234_Wave_hash(~seed, component, slot));
+	return sqrt(-2.0 * log(u0 + 1e-300)) * cos(2.0 * M_PI * u1);
+}
+
+/*!
+    @brief  Level of a pulse from at to at + duration with linear edges (the rise before at + rise, the fall after at + duration)
+*/
+static double __INA234_Wave_pulse(double t, double at, double duration, double rise, double fall){
+	if(t < at)
+		return 0;
+	if(rise > 0 && t < at + rise)
+		return (t - at) / rise;
+	if(duration <= 0 || t < at + duration)
+		return 1;
+	if(fall > 0 && t < at + duration + fall)
+		return 1 - (t - at - duration) / fall;
+	return 0;
+}
+
+static double __INA234_Wave_component(const INA234_Wave* self, uint32_t index, double t){
+	const INA234_WaveComponent* c = &self->components[index];
+	const double* p = c->p;
+
+	switch (c->kind) {
+		case WAVE_DC:
+			return p[0];
+		case WAVE_STEP:
+			return p[1] * __INA234_Wave_pulse(t, p[0], p[3], p[2], p[2]);
+		case WAVE_PWM:{
+			double tt = t - p[3];
+			if(tt < 0 || p[0] <= 0)
+				return 0;
+			if(p[5] > 0)
+				tt = fmod(tt, p[5]);
+			if(p[4] > 0 && tt >= p[4] * p[0])
+				return 0;
+			return fmod(tt, p[0]) < p[1] * p[0] ? p[2] : 0;
+		}
+		case WAVE_RIPPLE:
+			return p[1] * sin(2.0 * M_PI * p[0] * t * 1e-6 + p[2] * M_PI / 180.0);
+		case WAVE_RAMP:
+			if(t <= p[0])
+				return 0;
+			if(t >= p[1] || p[1] <= p[0])
+				return p[2];
+			return p[2] * (t - p[0]) / (p[1] - p[0]);
+		case WAVE_BROWNOUT:{
+			double tt = t;
+			if(p[5] > 0 && t >= p[0])
+				tt = p[0] + fmod(t - p[0], p[5]);
+			return -p[1] * __INA234_Wave_pulse(tt, p[0], p[2], p[3], p[4]);
+		}
+		case WAVE_STEPS:
+			if(t < p[3] || p[0] <= 0)
+				return 0;
+			return p[1] + (p[2] - p[1]) * __INA234_Wave_uniform(__INA234_Wave_hash(self->seed, index, (int64_t)floor((t - p[3]) / p[0])));
+		case WAVE_NOISE:
+			return p[0] * __INA234_Wave_gaussian(self->seed, index, (int64_t)floor(t / (p[1] > 0 ? p[1] : 1)));
+		default:
+			return 0;
+	}
+}
+
+/*!
+    @brief  Clear a waveform (both inputs at 0) with the default seed
+*/
+void INA234_Wave_init(INA234_Wave* self){
+	memset(self, 0, sizeof(*self));
+	self->seed = 1;
+}
+
+/*!
+    @brief  Parse the text of a waveform (see ina234_wave.h) and add its components
+    @param  self
+            A pointer to the waveform
+		@param  text
+						The text, one component or seed per line
+		@return	0 in case of success, or the line number of the first error (described in ina234_wave::error)
+*/
+int INA234_Wave_parse(INA234_Wave* self, const char* text){
+	int line_number = 0;
+
+	while(*text){
+		char line[256];
+		size_t length = strcspn(text, "\n");
+		line_number++;
+
+		if(length >= sizeof(line)){
+			snprintf(self->error, sizeof(self->error), "line too long");
+			return line_number;
+		}
+		memcpy(line, text, length);
+		line[length] = '\0';
+		text += length + (text[length] == '\n');
+
+		char* comment = strchr(line, '#');
+		if(comment)
+			*comment = '\0';
+
+		char* save;
+		char* word = strtok_r(line, " \t\r", &save);
+		if(!word)
+			continue;
+
+		if(!strcmp(word, "seed")){
+			char* value = strtok_r(NULL, " \t\r", &save);
+			char* end;
+			errno = 0;
+			if(!value || (self->seed = strtoull(value, &end, 0), errno || *end)){
+				snprintf(self->error, sizeof(self->error), "invalid seed");
+				return line_number;
+			}
+			continue;
+		}
+
+		INA234_WaveComponent component;
+		if(!strcmp(word, "shunt"))
+			component.input = WAVE_SHUNT;
+		else if(!strcmp(word, "bus"))
+			component.input = WAVE_BUS;
+		else{
+			snprintf(self->error, sizeof(self->error), "unknown input '%.40s' (shunt or bus)", word);
+			return line_number;
+		}
+
+		word = strtok_r(NULL, " \t\r", &save);
+		for(component.kind = 0; component.kind < WAVE_KINDS; component.kind++)
+			if(word && !strcmp(word, __INA234_Wave_kinds[component.kind].name))
+				break;
+		if(component.kind == WAVE_KINDS){
+			snprintf(self->error, sizeof(self->error), "unknown component '%.40s'", word ? word : "");
+			return line_number;
+		}
+		memcpy(component.p, __INA234_Wave_kinds[component.kind].defaults, sizeof(component.p));
+
+		uint8_t given = 0;
+		while((word = strtok_r(NULL, " \t\r", &save))){
+			char* value = strchr(word, '=');
+			char* end = NULL;
+			uint8_t key;
+
+			if(value)
+				*value++ = '\0';
+			for(key = 0; key < INA234_WAVE_MAX_KEYS && __INA234_Wave_kinds[component.kind].keys[key]; key++)
+				if(!strcmp(word, __INA234_Wave_kinds[component.kind].keys[key]))
+					break;
+			if(key == INA234_WAVE_MAX_KEYS || !__INA234_Wave_kinds[component.kind].keys[key]){
+				snprintf(self->error, sizeof(self->error), "unknown key '%.30s' of %s", word, __INA234_Wave_kinds[component.kind].name);
+				return line_number;
+			}
+			if(value)
+				component.p[key] = strtod(value, &end);
+			if(!value || end == value || *end){
+				snprintf(self->error, sizeof(self->error), "invalid value of '%.30s'", word);
+				return line_number;
+			}
+			given |= 1 << key;
+		}
+
+		uint8_t missing = __INA234_Wave_kinds[component.kind].required & ~given;
+		if(missing){
+			uint8_t key = 0;
+			while(!(missing & (1 << key)))
+				key++;
+			snprintf(self->error, sizeof(self->error), "missing key '%s' of %s", __INA234_Wave_kinds[component.kind].keys[key], __INA234_Wave_kinds[component.kind].name);
+			return line_number;
+		}
+
+		if(self->count == INA234_WAVE_MAX_COMPONENTS){
+			snprintf(self->error, sizeof(self->error), "more than %d components", INA234_WAVE_MAX_COMPONENTS);
+			return line_number;
+		}
+		self->components[self->count++] = component;
+	}
+	return 0;
+}
+
+/*!
+    @brief  Get the text of a built-in scenario
+    @param  name
+						One of ::ina234_wave_scenarios
+		@return	The text, or NULL if there is no such scenario
+*/
+const char* INA234_Wave_scenario(const char* name){
+	for(uint32_t i = 0; __INA234_Wave_texts[i]; i += 2)
+		if(!strcmp(name, __INA234_Wave_texts[i]))
+			return __INA234_Wave_texts[i + 1];
+	return NULL;
+}
+
+/*!
+    @brief  Parse a built-in scenario, or a file if there is no scenario with this name
+    @param  self
+            A pointer to the waveform
+		@param  name
+						A name of ::ina234_wave_scenarios or the path of a waveform file
+		@return	0 in case of success, -1 if the file can not be read, or the line number of the first error (described in ina234_wave::error)
+*/
+int INA234_Wave_load(INA234_Wave* self, const char* name){
+	const char* text = INA234_Wave_scenario(name);
+	if(text)
+		return INA234_Wave_parse(self, text);
+
+	FILE* file = fopen(name, "rb");
+	if(!file){
+		snprintf(self->error, sizeof(self->error), "no scenario or file '%.60s'", name);
+		return -1;
+	}
+
+	char* buffer = NULL;
+	size_t length = 0, capacity = 0, n;
+	do{
+		if(length + 4096 + 1 > capacity){
+			capacity = 2 * capacity + 4096 + 1;
+			buffer = realloc(buffer, capacity);
+		}
+		n = fread(buffer + length, 1, capacity - length - 1, file);
+		length += n;
+	}while(n > 0);
+	fclose(file);
+	buffer[length] = '\0';
+
+	int result = INA234_Wave_parse(self, buffer);
+	free(buffer);
+	return result;
+}
+
+/*!
+    @brief  Evaluate a waveform. It has the type of ::INA234_SimSource, with the waveform as the context.
+*/
+void INA234_Wave_sample(void* context, double time_us, double* shunt_mV, double* bus_V){
+	const INA234_Wave* self = context;
+	double sum[2] = {0, 0};
+
+	for(uint32_t i = 0; i < self->count; i++)
+		sum[self->components[i].input] += __INA234_Wave_component(self, i, time_us);
+	*shunt_mV = sum[WAVE_SHUNT];
+	*bus_V = sum[WAVE_BUS];
+}
+
+/*!
+    @brief  Feed a simulated chip with a waveform. The waveform must stay valid while the chip is simulated.
+*/
+void INA234_Wave_attach(INA234_Wave* self, INA234_Sim* sim){
+	sim->source = INA234_Wave_sample;
+	sim->source_context = self;
+}
@@ -0,0 +1,74 @@
+/*!
+ * @file ina234_wave.h
+ *
+ * Synthetic load waveforms for the simulated INA234 (see ina234_sim.h): step loads, PWM bursts, ripple, ramps, brown-outs,
+ * random load steps and noise, added together on the shunt and bus inputs. A waveform is described in a small text format:
+ *
+ *   # A comment. One component per line; the components of the same input are added.
+ *   seed 42
+ *   shunt dc       level=2
+ *   shunt pwm      period=1000 duty=0.25 level=15 pulses=5 every=20000
+ *   shunt noise    rms=0.05
+ *   bus   dc       level=12
+ *   bus   brownout at=50000 depth=4 duration=3000 fall=200 recover=1000
+ *
+ * The times are in micro seconds, the shunt levels in mV and the bus levels in V. The components and their keys are:
+ *   dc       level                                       constant level
+ *   step     at level [rise width]                       step to level at a time, with a linear rise, back to 0 after width (0: never)
+ *   pwm      period duty level [start pulses every]      pulses of level; bursts of pulses (0: endless) repeated every (0: once)
+ *   ripple   freq amp [phase]                            sine of freq (in Hz) and amp, phase in degrees
+ *   ramp     start end level                             linear from 0 at start to level at end, then held
+ *   brownout at depth duration [fall recover every]      drop by depth for duration, with linear fall and recovery, repeated every (0: once)
+ *   steps    every min max [start]                       random level between min and max, changed every period
+ *   noise    rms [hold]                                  gaussian noise, held for hold us (1 by default)
+ *
+ * The random components only depend on the seed, their line and the time, so a waveform gives the same values in any order of
+ * evaluation (for example at any conversion time or I2C clock).
+ *
+ */
+
+#ifndef __INA234_WAVE_H_
+#define __INA234_WAVE_H_
+
+#include <stdint.h>
+#include "ina234_sim.h"
+
+#define INA234_WAVE_MAX_COMPONENTS	32
+#define INA234_WAVE_MAX_KEYS				6
+
+typedef enum WaveInput		{WAVE_SHUNT, WAVE_BUS} WaveInput;
+typedef enum WaveKind			{WAVE_DC, WAVE_STEP, WAVE_PWM, WAVE_RIPPLE, WAVE_RAMP, WAVE_BROWNOUT, WAVE_STEPS, WAVE_NOISE, WAVE_KINDS} WaveKind;
+
+/*!
+    @brief  One component of a waveform. The parameters are in the order of the keys of its kind (see the file description).
+*/
+typedef struct ina234_wave_component{
+
+	WaveKind		kind;
+	WaveInput		input;
+	double			p[INA234_WAVE_MAX_KEYS];
+
+} INA234_WaveComponent;
+
+/*!
+    @brief  Class (struct) of a waveform
+*/
+typedef struct ina234_wave{
+
+	uint64_t							seed;
+	uint8_t								count;
+	INA234_WaveComponent	components[INA234_WAVE_MAX_COMPONENTS];
+	char									error[96];							/*!< Description of the last parse error */
+
+} INA234_Wave;
+
+extern const char* const ina234_wave_scenarios[];			/*!< Names of the built-in scenarios, NULL terminated */
+
+void				INA234_Wave_init(INA234_Wave* self);
+int					INA234_Wave_parse(INA234_Wave* self, const char* text);
+int					INA234_Wave_load(INA234_Wave* self, const char* name);
+const char*	INA234_Wave_scenario(const char* name);
+void				INA234_Wave_sample(void* context, double time_us, double* shunt_mV, double* bus_V);
+void				INA234_Wave_attach(INA234_Wave* self, INA234_Sim* sim);
+
+#endif
@@ -0,0 +1,83 @@
+/*!
+ * @file main.h
+ *
+ * Minimal host replacement of the STM32 HAL headers, so ina234.c can be compiled and run on a PC against the simulated INA234 (see ina234_sim.h).
+ * Only the parts used by the library are declared.
+ *
+ */
+
+#ifndef __HOST_MAIN_H_
+#define __HOST_MAIN_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {HAL_OK = 0x00, HAL_ERROR = 0x01, HAL_BUSY = 0x02, HAL_TIMEOUT = 0x03} HAL_StatusTypeDef;
+
+typedef enum {
+	HAL_I2C_STATE_RESET = 0x00,
+	HAL_I2C_STATE_READY = 0x20,
+	HAL_I2C_STATE_BUSY = 0x24,
+	HAL_I2C_STATE_BUSY_TX = 0x21,
+	HAL_I2C_STATE_BUSY_RX = 0x22
+} HAL_I2C_StateTypeDef;
+
+typedef struct __I2C_HandleTypeDef{
+	void*													Instance;
+	volatile HAL_I2C_StateTypeDef	State;
+	volatile uint32_t							ErrorCode;
+	volatile uint32_t							XferOptions;
+} I2C_HandleTypeDef;
+
+#define HAL_I2C_ERROR_NONE				0x00000000U
+#define HAL_I2C_ERROR_AF					0x00000004U
+#define HAL_I2C_ERROR_TIMEOUT			0x00000020U
+
+#define I2C_MEMADD_SIZE_8BIT			0x00000001U
+#define I2C_MEMADD_SIZE_16BIT			0x00000010U
+
+#define I2C_FIRST_FRAME						0x00000001U
+#define I2C_FIRST_AND_NEXT_FRAME	0x00000002U
+#define I2C_NEXT_FRAME						0x00000004U
+#define I2C_FIRST_AND_LAST_FRAME	0x00000008U
+#define I2C_LAST_FRAME_NO_STOP		0x00000010U
+#define I2C_LAST_FRAME						0x00000020U
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Master_Receive_IT(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_DMA(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Master_Receive_DMA(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Transmit_IT(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size, uint32_t XferOptions);
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_IT(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size, uint32_t XferOptions);
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Transmit_DMA(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size, uint32_t XferOptions);
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_DMA(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size, uint32_t XferOptions);
+HAL_StatusTypeDef HAL_I2C_Master_Abort_IT(I2C_HandleTypeDef* hi2c, uint16_t DevAddress);
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef* hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef* hi2c);
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint32_t Trials, uint32_t Timeout);
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef* hi2c);
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef* hi2c);
+
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef* hi2c);
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef* hi2c);
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef* hi2c);
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef* hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef* hi2c);
+
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+
+static inline void __DMB(void){ __sync_synchronize(); }
+static inline uint32_t __get_PRIMASK(void){ return 0; }
+static inline void __set_PRIMASK(uint32_t priMask){ (void)priMask; }
+static inline void __disable_irq(void){}
+static inline void __enable_irq(void){}
+
+#endif
@@ -0,0 +1,46 @@
+#!/bin/sh
+# Code and RAM footprint of ina234.c for each combination of the feature macros (INA234_USE_FLOAT, INA234_USE_ALERT,
+# INA234_USE_IDS, INA234_USE_CONFIG_GETTERS and INA234_USE_CACHE, see ina234.h).
+#
+# Usage:
+#   ./size_report.sh [extra compiler flags]
+#
+# By default it uses arm-none-eabi-gcc for a Cortex-M0+ with -Os. Set CROSS (toolchain prefix) or CFLAGS to change them:
+#   CFLAGS="-mcpu=cortex-m4 -mthumb -mfloat-abi=hard -mfpu=fpv4-sp-d16 -Os" ./size_report.sh
+#
+# The host HAL shim (main.h and i2c.h in this folder) stands in for the STM32 headers, so only the library itself is measured.
+# "text" is the flash taken by the code and constants, "data"+"bss" the static RAM, and "INA234" the RAM of each ina234 object (struct).
+# "softfp" is the number of the soft-float helpers (__aeabi_f*, __aeabi_d*) the library pulls from libgcc, which are not counted in "text".
+
+CROSS=${CROSS-arm-none-eabi-}
+CFLAGS=${CFLAGS:-"-mcpu=cortex-m0plus -mthumb -Os"}
+TMP=${TMPDIR:-/tmp}/ina234_size.$$
+
+cd "$(dirname "$0")" || exit 2
+command -v "${CROSS}gcc" > /dev/null || { echo "${CROSS}gcc not found"; exit 2; }
+mkdir -p "$TMP"
+trap 'rm -rf "$TMP"' EXIT
+
+printf '#include "ina234.h"\nINA234 ina234_size_probe;\n' > "$TMP/probe.c"
+
+printf "%-5s %-5s %-3s %-7s %-5s | %6s %5s %5s | %6s %6s\n" FLOAT ALERT IDS GETTERS CACHE text data bss INA234 softfp
+for FLOAT in 1 0; do
+	for ALERT in 1 0; do
+		for IDS in 1 0; do
+			for GETTERS in 1 0; do
+				for CACHE in 1 0; do
+					DEFINES="-DINA234_USE_FLOAT=$FLOAT -DINA234_USE_ALERT=$ALERT -DINA234_USE_IDS=$IDS -DINA234_USE_CONFIG_GETTERS=$GETTERS -DINA234_USE_CACHE=$CACHE"
+					"${CROSS}gcc" $CFLAGS "$@" -ffunction-sections -fdata-sections $DEFINES -I. -I.. -c ../ina234.c -o "$TMP/ina234.o" || exit 1
+					"${CROSS}gcc" $CFLAGS "$@" $DEFINES -I. -I.. -c "$TMP/probe.c" -o "$TMP/probe.o" || exit 1
+					
+					# Berkeley format: text data bss dec hex filename
+					SIZES=$("${CROSS}size" "$TMP/ina234.o" | awk 'NR == 2 {print $1, $2, $3}')
+					STRUCT=$(printf '%d' "0x$("${CROSS}nm" -S "$TMP/probe.o" | awk '/ina234_size_probe/ {print $2}')")
+					SOFTFP=$("${CROSS}nm" -u "$TMP/ina234.o" | grep -c '__aeabi_[fd]')
+					
+					printf "%-5s %-5s %-3s %-7s %-5s | %6s %5s %5s | %6s %6s\n" $FLOAT $ALERT $IDS $GETTERS $CACHE $SIZES $STRUCT $SOFTFP
+				done
+			done
+		done
+	done
+done
@@ -0,0 +1,70 @@
+/*!
+ * @file trace2json.c
+ *
+ * Convert serialized INA234 traces (see ::INA234_Trace_serialize in ina234_trace.h) to Chrome trace events (see ina234_chrome.h),
+ * to open in chrome://tracing or https://ui.perfetto.dev. Each file is one process named after the file, for example one per I2C bus;
+ * the traces recorded with the same clock are on the same timeline.
+ *
+ * Build:
+ *   gcc -O2 -I. -I.. -o trace2json trace2json.c ina234_chrome.c ina234_sim.c ../ina234_trace.c ../ina234.c -lm
+ *
+ * Usage:
+ *   trace2json [-o trace.json] trace.bin [trace2.bin ...]
+ *
+ * The JSON is written to stdout without -o.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ina234_chrome.h"
+
+#define MAX_RECORDS				(1 << 20)
+
+int main(int argc, char** argv){
+	static INA234_TraceRecord records[MAX_RECORDS];
+	static uint8_t buffer[MAX_RECORDS * INA234_TRACE_RECORD_SIZE];
+	FILE* output = stdout;
+	INA234_Chrome chrome;
+	INA234_Trace trace;
+	uint32_t pid = 1;
+
+	for(int i = 1; i + 1 < argc; i++){
+		if(!strcmp(argv[i], "-o")){
+			output = fopen(argv[i + 1], "w");
+			if(!output){
+				perror(argv[i + 1]);
+				return 1;
+			}
+			memmove(&argv[i], &argv[i + 2], (argc - i - 1) * sizeof(*argv));
+			argc -= 2;
+			break;
+		}
+	}
+	if(argc < 2){
+		fprintf(stderr, "usage: %s [-o trace.json] trace.bin [trace2.bin ...]\n", argv[0]);
+		return 1;
+	}
+
+	INA234_Chrome_begin(&chrome, output);
+	for(int i = 1; i < argc; i++){
+		FILE* input = fopen(argv[i], "rb");
+		if(!input){
+			perror(argv[i]);
+			return 1;
+		}
+		uint32_t length = (uint32_t)fread(buffer, 1, sizeof(buffer), input);
+		fclose(input);
+
+		INA234_Trace_init(&trace, records, MAX_RECORDS, NULL);
+		uint32_t count = INA234_Trace_load(&trace, buffer, length);
+		uint32_t events = INA234_Chrome_addTrace(&chrome, &trace, pid++, argv[i]);
+		fprintf(stderr, "%s: %u records, %u trace events\n", argv[i], (unsigned)count, (unsigned)events);
+	}
+	INA234_Chrome_end(&chrome);
+
+	if(output != stdout)
+		fclose(output);
+	return 0;
+}
@@ -40,6 +40,18 @@
 
 #include "ina234.h"
 
+static const uint16_t __INA234_conversionTimes[8] = {140, 204, 332, 588, 1100, 2116, 4156, 8244};	// in us, indexed by ::ConvTime
+static const uint16_t __INA234_numberOfSamples[8] = {1, 4, 16, 64, 128, 256, 512, 1024};				// indexed by ::NumSamples
+static const int32_t __INA234_fixedScales[2][INA234_CHANNELS] = {																		// indexed by ::ADCRange and ::Channel
+	{__INA234_Q8(SHUNT_VOLTAGE_81_92mv_LSB), __INA234_Q8(BUS_VOLTAGE_LSB), __INA234_Q8(POWER_LSB), __INA234_Q8(CURRENT_LSB)},
+	{__INA234_Q8(SHUNT_VOLTAGE_20_48mv_LSB), __INA234_Q8(BUS_VOLTAGE_LSB), __INA234_Q8(POWER_LSB), __INA234_Q8(CURRENT_LSB)},
+};
+#if INA234_USE_FLOAT
+static const float __INA234_floatScales[2][INA234_CHANNELS] = {																			// indexed by ::ADCRange and ::Channel
+	{SHUNT_VOLTAGE_81_92mv_LSB, BUS_VOLTAGE_LSB, POWER_LSB, CURRENT_LSB},
+	{SHUNT_VOLTAGE_20_48mv_LSB, BUS_VOLTAGE_LSB, POWER_LSB, CURRENT_LSB},
+};
+#endif
 
 /*!
     @brief  Initialize the INA234 with the given config
@@ -50,7 +62,7 @@
 		@param  hi2c
 		        A pointer to the I2C handler that is connected to INA234
 		@param  ShuntResistor
-						The resistance of your shunt resistor (in mOhm) connected to IN+ and IN- of the INA234
+						The resistance of your shunt resistor (in mOhm, or in micro Ohm if ::INA234_USE_FLOAT is 0) connected to IN+ and IN- of the INA234
 		@param  adc_range
 						The full scale range of ADC. It can be one of these values:
 						- ::RANGE_81_92mV for 81.92 mV
@@ -98,7 +110,7 @@
 		@retval ::STATUS_OK in case of success
 		@retval ::STATUS_TimeOut in case of failure
 */
-Status INA234_init(INA234* self, uint8_t I2C_ADDR, I2C_HandleTypeDef* hi2c, float ShuntResistor, ADCRange adc_range, NumSamples numer_of_adc_samples, ConvTime vbus_conversion_time, ConvTime vshunt_conversion_time, Mode mode){
+Status INA234_init(INA234* self, uint8_t I2C_ADDR, I2C_HandleTypeDef* hi2c, INA234_Resistance ShuntResistor, ADCRange adc_range, NumSamples numer_of_adc_samples, ConvTime vbus_conversion_time, ConvTime vshunt_conversion_time, Mode mode){
 
 	// Init Variables -----------------------
 	self->hi2c = hi2c;
@@ -109,28 +121,32 @@ Status INA234_init(INA234* self, uint8_t I2C_ADDR, I2C_HandleTypeDef* hi2c, floa
 	self->vbus_conversion_time = vbus_conversion_time;
 	self->vshunt_conversion_time = vshunt_conversion_time;
 	self->mode = mode;
+#if INA234_USE_ALERT
+	// No alert until ::INA234_alert_init(), so the plan (and the later setters) never write a limit from uninitialized settings
+	self->alert_on = ALERT_NONE;
+	self->alert_polarity = ALERT_ACTIVE_LOW;
+	self->alert_latch = ALERT_TRANSPARENT;
+	self->alert_conv_ready = ALERT_CONV_DISABLE;
+	self->alert_limit = 0;
+#endif
+	__INA234_updatePlan(self);
+	
+	__INA234_resetCounters(self);
 	
 	// Write Configurations -----------------
-	self->reg.config_register.RST = 0;
-	self->reg.config_register.ACDRANGE = adc_range;
-	self->reg.config_register.AVG = numer_of_adc_samples;
-	self->reg.config_register.VBUSCT = vbus_conversion_time;
-	self->reg.config_register.VSHCT = vshunt_conversion_time;
-	self->reg.config_register.MODE = mode;
-
+	__INA234_buildRegister(self, CONFIGURATION_REGISTER);
 	if(STATUS_OK != __INA234_writeTwoBytes(self, CONFIGURATION_REGISTER))
 		return STATUS_TimeOut;
 	
 	// Write Calibration Value --------------
-	uint16_t shunt_cal = (uint16_t)((self->adc_range == RANGE_81_92mV ? 81.92 : 20.48) / (CURRENT_LSB * self->ShuntResistor));
-	self->reg.calibration_register.SHUNT_CAL = shunt_cal;
-	
+	__INA234_buildRegister(self, CALIBRATION_REGISTER);
 	if(STATUS_OK != __INA234_writeTwoBytes(self, CALIBRATION_REGISTER))
 		return STATUS_TimeOut;
 	
 	return STATUS_OK;
 }
 
+#if INA234_USE_ALERT
 /*!
     @brief  Initialize the alert functionality of INA234 with the given configurations
     @param  self
@@ -166,6 +182,7 @@ Status INA234_init(INA234* self, uint8_t I2C_ADDR, I2C_HandleTypeDef* hi2c, floa
 						- for ::ALERT_SHUNT_OVER_LIMIT or ::ALERT_SHUNT_UNDER_LIMIT : mili Volts
 						- for ::ALERT_BUS_OVER_LIMIT or ::ALERT_BUS_UNDER_LIMIT : Volts
 						- for ::ALERT_POWER_OVER_LIMIT : Watt
+						- raw LSBs of the alert limit register for all of them, if ::INA234_USE_FLOAT is 0
 						
 						For example if the alert_limit was 10.4 and you give ::ALERT_SHUNT_OVER_LIMIT for the alert_on argument, it means you will get alert if the shunt voltage reaches over the 10.4mV.
 						If you give ::ALERT_BUS_OVER_LIMIT to alert_on, it means you will get alert if the bus voltage reaches the 10.4V
@@ -173,7 +190,7 @@ Status INA234_init(INA234* self, uint8_t I2C_ADDR, I2C_HandleTypeDef* hi2c, floa
 		@retval ::STATUS_OK in case of success
 		@retval ::STATUS_TimeOut in case of failure
 */
-Status INA234_alert_init(INA234* self, AlertOn alert_on, AlertPolarity alert_polarity, AlertLatch alert_latch, AlertConvReady alert_conv_ready, float alert_limit){
+Status INA234_alert_init(INA234* self, AlertOn alert_on, AlertPolarity alert_polarity, AlertLatch alert_latch, AlertConvReady alert_conv_ready, INA234_Limit alert_limit){
 	
 	self->alert_on = alert_on;
 	self->alert_polarity = alert_polarity;
@@ -182,47 +199,639 @@ Status INA234_alert_init(INA234* self, AlertOn alert_on, AlertPolarity alert_pol
 	self->alert_limit = alert_limit;
 	
 	// Calculate Alert Limit
-	switch (alert_on) {
+	__INA234_updatePlan(self);
+	
+	// Write Alert Limit
+	__INA234_buildRegister(self, ALERT_LIMIT_REGISTER);
+	if(STATUS_OK != __INA234_writeTwoBytes(self, ALERT_LIMIT_REGISTER))
+		return STATUS_TimeOut;
+	
+	// Write Alert Setting
+	__INA234_buildRegister(self, MASK_ENABLE_REGISTER);
+	return __INA234_writeTwoBytes(self, MASK_ENABLE_REGISTER);
+	
+}
+#endif
+
+/*!
+    @brief  Scan the I2C bus for INA234 chips and fill a table of instances with the found addresses
+    @param  hi2c
+            A pointer to the I2C handler that should be scanned
+		@param  devices
+						A pointer to an array of ina234 objects (structs). For each found chip, ina234::hi2c and ina234::I2C_ADDR of the next entry are filled,
+						and its transport, clock, hooks and counters are reset (see ::INA234_setTransfer()).
+						Then you can pass each entry to ::INA234_init() using `devices[i].I2C_ADDR >> 1` as the address.
+		@param  max_devices
+						Size of the devices array. Scanning stops when the array is full.
+		@return	Number of INA234 chips found on the bus
+
+		Every address from ::INA234_PROBE_FIRST_ADDR to ::INA234_PROBE_LAST_ADDR is checked with a single trial and a timeout of ::INA234_PROBE_TIMEOUT ms,
+		so empty addresses which NACK cost only one address frame. Then the manufacturer and device ID registers of the acknowledging chips are checked
+		against ::INA234_MANUFACTURER_ID and ::INA234_DEVICE_ID to reject other chips sharing the bus (only if ::INA234_USE_IDS is 1).
+*/
+uint8_t INA234_probe(I2C_HandleTypeDef* hi2c, INA234* devices, uint8_t max_devices){
+	uint8_t found = 0;
+	
+	for(uint8_t addr = INA234_PROBE_FIRST_ADDR; addr <= INA234_PROBE_LAST_ADDR && found < max_devices; addr++){
+		
+		if(HAL_OK != HAL_I2C_IsDeviceReady(hi2c, addr << 1, 1, INA234_PROBE_TIMEOUT))
+			continue;
+		
+		INA234* dev = &devices[found];
+		dev->hi2c = hi2c;
+		dev->I2C_ADDR = addr << 1;
+		__INA234_resetCounters(dev);		// The entry may be uninitialized or reused: the ID reads must not use its transport, clock or cache
+		
+#if INA234_USE_IDS
+		if(STATUS_OK != __INA234_readTwoBytes(dev, MANUFACTURERID_REGISTER) || dev->reg.manufacture_id_register.MANUFACTURE_ID != INA234_MANUFACTURER_ID)
+			continue;
+		if(STATUS_OK != __INA234_readTwoBytes(dev, DEVICEID_REGISTER) || dev->reg.devide_id_register.DIEID != INA234_DEVICE_ID)
+			continue;
+#endif
+		
+		found++;
+	}
+	
+	return found;
+}
+
+/*!
+    @brief  Initialize a table of INA234 chips at once. The register writes are issued non-blocking (interrupt mode) and interleaved between the devices,
+						so the devices on different I2C buses are configured in parallel and the total time approaches the time of the most populated bus.
+						A write that is not done in ::INA234_I2C_TIMEOUT fails its device, and the I2C peripheral is reset (HAL_I2C_DeInit() and HAL_I2C_Init()) so the other devices of the bus can go on.
+						**NOTE: The I2C event and error interrupts of the used buses must be enabled.**
+    @param  devices
+            A pointer to an array of ina234 objects (structs) to be initialized
+		@param  configs
+						A pointer to an array of ::INA234_Config, one for each device. See ::INA234_init() and ::INA234_alert_init() for the meaning of the fields.
+						If ina234_config::alert_enable is zero, the alert registers are left untouched.
+		@param  status
+						A pointer to an array that receives the initialization status of each device (::STATUS_OK or ::STATUS_TimeOut)
+		@param  count
+						Number of the devices
+		@return	The overall status of initialization
+		@retval ::STATUS_OK if all of the devices are initialized successfully
+		@retval ::STATUS_TimeOut if at least one of the devices failed
+*/
+Status INA234_initMany(INA234* devices, const INA234_Config* configs, Status* status, uint8_t count){
+	static const uint8_t sequence[4] = {CONFIGURATION_REGISTER, CALIBRATION_REGISTER, ALERT_LIMIT_REGISTER, MASK_ENABLE_REGISTER};
+	uint8_t remaining = count;
+	uint32_t start = HAL_GetTick();
+	Status result = STATUS_OK;
+	
+	// Init Variables -----------------------
+	for(uint8_t i=0; i<count; i++){
+		INA234* dev = &devices[i];
+		const INA234_Config* cfg = &configs[i];
+		
+		dev->hi2c = cfg->hi2c;
+		dev->I2C_ADDR = cfg->I2C_ADDR << 1;
+		dev->ShuntResistor = cfg->ShuntResistor;
+		dev->adc_range = cfg->adc_range;
+		dev->number_of_adc_samples = cfg->number_of_adc_samples;
+		dev->vbus_conversion_time = cfg->vbus_conversion_time;
+		dev->vshunt_conversion_time = cfg->vshunt_conversion_time;
+		dev->mode = cfg->mode;
+		
+#if INA234_USE_ALERT
+		dev->alert_on = cfg->alert_on;
+		dev->alert_polarity = cfg->alert_polarity;
+		dev->alert_latch = cfg->alert_latch;
+		dev->alert_conv_ready = cfg->alert_conv_ready;
+		dev->alert_limit = cfg->alert_limit;
+		dev->init_steps = cfg->alert_enable ? 4 : 2;
+#else
+		dev->init_steps = 2;
+#endif
+		__INA234_updatePlan(dev);
+		
+		__INA234_resetCounters(dev);
+		
+		dev->init_step = 0;
+		dev->init_busy = 0;
+		status[i] = STATUS_OK;
+	}
+	
+	// Interleave Writes --------------------
+	while(remaining){
+		
+		// Collect the finished transactions
+		for(uint8_t i=0; i<count; i++){
+			INA234* dev = &devices[i];
+			if(!dev->init_busy)
+				continue;
+			
+			if(HAL_I2C_GetState(dev->hi2c) != HAL_I2C_STATE_READY){
+				if(HAL_GetTick() - dev->init_tick > INA234_I2C_TIMEOUT){
+					// The HAL can not abort a memory transfer, so reset the peripheral: it stops writing into dev->reg and the other devices of the bus can go on
+					HAL_I2C_DeInit(dev->hi2c);
+					HAL_I2C_Init(dev->hi2c);
+					dev->init_busy = 0;
+					dev->init_step = dev->init_steps;
+					status[i] = STATUS_TimeOut;
+					remaining--;
+				}
+				continue;
+			}
+			
+			dev->init_busy = 0;
+			if(HAL_I2C_GetError(dev->hi2c) != HAL_I2C_ERROR_NONE){
+				dev->init_step = dev->init_steps;
+				status[i] = STATUS_TimeOut;
+			}
+			else{
+				dev->init_step++;
+			}
+			if(dev->init_step == dev->init_steps)
+				remaining--;
+		}
+		
+		// Start the next write on every idle bus
+		for(uint8_t i=0; i<count; i++){
+			INA234* dev = &devices[i];
+			if(dev->init_busy || dev->init_step == dev->init_steps || HAL_I2C_GetState(dev->hi2c) != HAL_I2C_STATE_READY)
+				continue;
+			
+			uint8_t bus_taken = 0;
+			for(uint8_t j=0; j<count; j++)
+				if(devices[j].init_busy && devices[j].hi2c == dev->hi2c)
+					bus_taken = 1;
+			if(bus_taken)
+				continue;
+			
+			uint8_t MemAddress = sequence[dev->init_step];
+			__INA234_buildRegister(dev, MemAddress);
+			__INA234_swapBytes(dev);
+			
+			if(HAL_OK == HAL_I2C_Mem_Write_IT(dev->hi2c, dev->I2C_ADDR, MemAddress, I2C_MEMADD_SIZE_8BIT, dev->reg.raw_data, 2)){
+				dev->init_busy = 1;
+				dev->init_tick = HAL_GetTick();
+			}
+			else{
+				dev->init_step = dev->init_steps;
+				status[i] = STATUS_TimeOut;
+				remaining--;
+			}
+		}
+		
+		// Give up on the devices stuck behind a hung bus
+		if(HAL_GetTick() - start > (uint32_t)INA234_I2C_TIMEOUT * 4 * count){
+			for(uint8_t i=0; i<count; i++){
+				if(devices[i].init_step != devices[i].init_steps){
+					if(devices[i].init_busy){
+						HAL_I2C_DeInit(devices[i].hi2c);
+						HAL_I2C_Init(devices[i].hi2c);
+					}
+					devices[i].init_busy = 0;
+					devices[i].init_step = devices[i].init_steps;
+					status[i] = STATUS_TimeOut;
+				}
+			}
+			remaining = 0;
+		}
+	}
+	
+	for(uint8_t i=0; i<count; i++)
+		if(status[i] != STATUS_OK)
+			result = STATUS_TimeOut;
+	
+	return result;
+}
+
+// Privates
+/*!
+    @brief  Fill the ina234::_reg with the value of a register, calculated from the configurations stored in the ina234 object (struct)
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  MemAddress
+		        Address of the register. It can be ::CONFIGURATION_REGISTER, ::CALIBRATION_REGISTER, ::ALERT_LIMIT_REGISTER or ::MASK_ENABLE_REGISTER
+*/
+void __INA234_buildRegister(INA234* self, uint8_t MemAddress){
+	self->reg.raw_data[0] = 0;
+	self->reg.raw_data[1] = 0;
+	
+	switch (MemAddress) {
+		case CONFIGURATION_REGISTER:
+			self->reg.config_register.RST = 0;
+			self->reg.config_register.ACDRANGE = self->adc_range;
+			self->reg.config_register.AVG = self->number_of_adc_samples;
+			self->reg.config_register.VBUSCT = self->vbus_conversion_time;
+			self->reg.config_register.VSHCT = self->vshunt_conversion_time;
+			self->reg.config_register.MODE = self->mode;
+			break;
+		case CALIBRATION_REGISTER:
+			self->reg.calibration_register.SHUNT_CAL = self->plan.shunt_cal;
+			break;
+#if INA234_USE_ALERT
+		case ALERT_LIMIT_REGISTER:
+			self->reg.alert_limit_register.LIMIT = self->alert_limit_int & 0x0000FFFF;
+			break;
+		case MASK_ENABLE_REGISTER:
+			self->reg.mask_enable_register.SOL  = self->alert_on == ALERT_SHUNT_OVER_LIMIT  ? 1 : 0;
+			self->reg.mask_enable_register.SUL  = self->alert_on == ALERT_SHUNT_UNDER_LIMIT ? 1 : 0;
+			self->reg.mask_enable_register.BOL  = self->alert_on == ALERT_BUS_OVER_LIMIT    ? 1 : 0;
+			self->reg.mask_enable_register.BUL  = self->alert_on == ALERT_BUS_UNDER_LIMIT   ? 1 : 0;
+			self->reg.mask_enable_register.POL  = self->alert_on == ALERT_POWER_OVER_LIMIT  ? 1 : 0;
+			self->reg.mask_enable_register.CNVR = self->alert_conv_ready;
+			self->reg.mask_enable_register.APOL = self->alert_polarity;
+			self->reg.mask_enable_register.LEN  = self->alert_latch;
+			break;
+#endif
+	}
+}
+
+/*!
+    @brief  Recalculate the conversion plan (ina234::_plan and ina234#alert_limit_int) from ina234#adc_range, ina234#ShuntResistor and the alert configs.
+						Call it only when one of these inputs changes, so the getters never have to evaluate the range themselves.
+    @param  self
+            A pointer to the ina234 object (struct)
+		@return	A mask of the registers whose value has been changed by the new plan (::__INA234_PLAN_CALIBRATION and ::__INA234_PLAN_ALERT_LIMIT)
+*/
+uint8_t __INA234_updatePlan(INA234* self){
+	uint8_t changed = 0;
+	
+#if INA234_USE_FLOAT
+	// Scales
+	float shunt_voltage_lsb = (self->adc_range == RANGE_20_48mV) ? SHUNT_VOLTAGE_20_48mv_LSB : SHUNT_VOLTAGE_81_92mv_LSB;
+	self->plan.shunt_voltage_lsb = shunt_voltage_lsb;
+	self->plan.bus_voltage_lsb = BUS_VOLTAGE_LSB;
+	self->plan.current_lsb = CURRENT_LSB;
+	self->plan.power_lsb = POWER_LSB;
+	
+	// Calibration Value
+	uint16_t shunt_cal = (uint16_t)((self->adc_range == RANGE_81_92mV ? 81.92 : 20.48) / (CURRENT_LSB * self->ShuntResistor));
+#else
+	// Calibration Value (the shunt resistance is in micro Ohms)
+	uint16_t shunt_cal = self->ShuntResistor ? (uint16_t)((self->adc_range == RANGE_81_92mV ? __INA234_CAL_81_92mV : __INA234_CAL_20_48mV) / self->ShuntResistor) : 0;
+#endif
+	if(shunt_cal != self->plan.shunt_cal){
+		self->plan.shunt_cal = shunt_cal;
+		changed |= __INA234_PLAN_CALIBRATION;
+	}
+	
+#if INA234_USE_ALERT
+	// Alert Limit
+	int32_t alert_limit_int = 0x7FFF;
+#if INA234_USE_FLOAT
+	switch (self->alert_on) {
 		case ALERT_NONE:
-			self->alert_limit_int = 0x7FFF;
+			alert_limit_int = 0x7FFF;
 			break;
 		case ALERT_BUS_OVER_LIMIT:
-			self->alert_limit_int = (int32_t)(alert_limit / BUS_VOLTAGE_LSB);
-			break;
 		case ALERT_BUS_UNDER_LIMIT:
-			self->alert_limit_int = (int32_t)(alert_limit / BUS_VOLTAGE_LSB);
+			alert_limit_int = (int32_t)(self->alert_limit / BUS_VOLTAGE_LSB);
 			break;
 		case ALERT_SHUNT_OVER_LIMIT:
-			self->alert_limit_int = (int32_t)(alert_limit / ((self->adc_range==RANGE_20_48mV) ? SHUNT_VOLTAGE_20_48mv_LSB : SHUNT_VOLTAGE_81_92mv_LSB));
-			break;
 		case ALERT_SHUNT_UNDER_LIMIT:
-			self->alert_limit_int = (int32_t)(alert_limit / ((self->adc_range==RANGE_20_48mV) ? SHUNT_VOLTAGE_20_48mv_LSB : SHUNT_VOLTAGE_81_92mv_LSB));
+			alert_limit_int = (int32_t)(self->alert_limit / shunt_voltage_lsb);
 			break;
 		case ALERT_POWER_OVER_LIMIT:
-			self->alert_limit_int = (int32_t)(alert_limit / POWER_LSB);
+			alert_limit_int = (int32_t)(self->alert_limit / POWER_LSB);
 			break;
 	}
+#else
+	if(self->alert_on != ALERT_NONE)
+		alert_limit_int = self->alert_limit;
+#endif
+	if(alert_limit_int != self->alert_limit_int){
+		self->alert_limit_int = alert_limit_int;
+		changed |= __INA234_PLAN_ALERT_LIMIT;
+	}
+#endif
 	
-	// Write Alert Limit
-	self->reg.alert_limit_register.LIMIT = self->alert_limit_int & 0x0000FFFF;
-	if(STATUS_OK != __INA234_writeTwoBytes(self, ALERT_LIMIT_REGISTER))
+	return changed;
+}
+
+/*!
+    @brief  Write the registers changed by ::__INA234_updatePlan() to INA234
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  changed
+						The mask returned by ::__INA234_updatePlan()
+		@return	Ths status of writing
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut in case of failure
+*/
+Status __INA234_writePlan(INA234* self, uint8_t changed){
+	if(changed & __INA234_PLAN_CALIBRATION){
+		__INA234_buildRegister(self, CALIBRATION_REGISTER);
+		if(STATUS_OK != __INA234_writeTwoBytes(self, CALIBRATION_REGISTER))
+			return STATUS_TimeOut;
+	}
+#if INA234_USE_ALERT
+	if(changed & __INA234_PLAN_ALERT_LIMIT){
+		__INA234_buildRegister(self, ALERT_LIMIT_REGISTER);
+		if(STATUS_OK != __INA234_writeTwoBytes(self, ALERT_LIMIT_REGISTER))
+			return STATUS_TimeOut;
+	}
+#endif
+	return STATUS_OK;
+}
+
+/*!
+    @brief  Swap the two bytes of ina234::_reg::raw_data to convert between the MCU (little endian) and INA234 (big endian) byte orders
+    @param  self
+            A pointer to the ina234 object (struct)
+*/
+void __INA234_swapBytes(INA234* self){
+	self->reg.raw_data[0] ^= self->reg.raw_data[1];
+	self->reg.raw_data[1] ^= self->reg.raw_data[0];
+	self->reg.raw_data[0] ^= self->reg.raw_data[1];
+}
+
+/*!
+    @brief  Reset the clock, the sleep and transfer functions, the sequence estimation, and the statistic counters of the ina234 object (struct)
+    @param  self
+            A pointer to the ina234 object (struct)
+*/
+void __INA234_resetCounters(INA234* self){
+	self->clock = NULL;
+	self->sequence = 0;
+	self->last_fresh_time = 0;
+	self->duplicates = 0;
+	self->gaps = 0;
+	self->snapshots = 0;
+	self->tears = 0;
+	self->torn_snapshots = 0;
+	self->sleep = NULL;
+	self->next_ready_valid = 0;
+	self->ready_pending = 0;
+	self->waits = 0;
+	self->wait_polls = 0;
+#if INA234_USE_CACHE
+	self->cache_enable = 0;
+	self->cache_valid = 0;
+	self->cache_grid_valid = 0;
+	self->cache_flag_valid = 0;
+	self->cache_miss_valid = 0;
+	self->cache_syncs = 0;
+	self->cache_hits = 0;
+	self->cache_misses = 0;
+#endif
+#if INA234_USE_ALERT
+	self->alert_pending = 0;
+	self->wakeups = 0;
+	self->spurious_wakeups = 0;
+	self->awake_last = 0;
+	self->awake_total = 0;
+	self->asleep_total = 0;
+#endif
+	self->transfer = NULL;
+	self->transfer_context = NULL;
+	self->event_hook = NULL;
+	self->event_context = NULL;
+	self->published_seq = 0;
+#if INA234_USE_FLOAT
+	self->converted = 0;
+#endif
+}
+
+/*!
+    @brief  Get the current time from the clock of the ina234 object (struct)
+    @param  self
+            A pointer to the ina234 object (struct)
+		@return	The time in micro seconds
+*/
+uint32_t __INA234_now(INA234* self){
+	return self->clock ? self->clock() : HAL_GetTick() * 1000;
+}
+
+/*!
+    @brief  Sleep with the function given to ::INA234_setSleep(). Without it, wait on the clock, or on HAL_Delay() (rounded up to ms) if there is no clock either.
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  time
+						The time in micro seconds
+*/
+void __INA234_sleep(INA234* self, uint32_t time){
+	__INA234_event(self, EVENT_SLEEP, PHASE_BEGIN, time > 0xFFFF ? 0xFFFF : (uint16_t)time);
+	if(self->sleep){
+		self->sleep(time);
+	}
+	else if(self->clock){
+		uint32_t start = self->clock();
+		while(self->clock() - start < time);
+	}
+	else{
+		HAL_Delay((time + 999) / 1000);
+	}
+	__INA234_event(self, EVENT_SLEEP, PHASE_END, 0);
+}
+
+/*!
+    @brief  Report an event of the driver to the hook given to ::INA234_setEventHook(), if any
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  event
+						The event
+		@param  phase
+						Begin or end of a span, or an instant
+		@param  argument
+						Depends on the event (see ::INA234_EventHook)
+*/
+void __INA234_event(INA234* self, EventType event, EventPhase phase, uint16_t argument){
+	if(self->event_hook)
+		self->event_hook(self->event_context, self->I2C_ADDR, event, phase, argument);
+}
+
+/*!
+    @brief  Read the shunt voltage, bus voltage, power and current registers into a sample and timestamp it
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  sample
+						A pointer to the ::INA234_Sample to be filled
+		@return	Ths status of reading
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut in case of failure
+*/
+Status __INA234_readMeasurements(INA234* self, INA234_Sample* sample){
+	sample->timestamp = __INA234_now(self);
+	sample->adc_range = self->adc_range;
+	
+	if(STATUS_OK != __INA234_readTwoBytes(self, SHUNT_VOLTAGE_REGISTER))
 		return STATUS_TimeOut;
+	sample->shunt_voltage = self->reg.shunt_voltage_register.VSHUNT;
 	
-	// Write Alert Setting
-	self->reg.mask_enable_register.SOL  = alert_on == ALERT_SHUNT_OVER_LIMIT  ? 1 : 0;
-	self->reg.mask_enable_register.SUL  = alert_on == ALERT_SHUNT_UNDER_LIMIT ? 1 : 0;
-	self->reg.mask_enable_register.BOL  = alert_on == ALERT_BUS_OVER_LIMIT    ? 1 : 0;
-	self->reg.mask_enable_register.BUL  = alert_on == ALERT_BUS_UNDER_LIMIT   ? 1 : 0;
-	self->reg.mask_enable_register.POL  = alert_on == ALERT_POWER_OVER_LIMIT  ? 1 : 0;
-	self->reg.mask_enable_register.CNVR = alert_conv_ready;
-	self->reg.mask_enable_register.APOL = alert_polarity;
-	self->reg.mask_enable_register.LEN  = alert_latch;
+	if(STATUS_OK != __INA234_readTwoBytes(self, BUS_VOLTAGE_REGISTER))
+		return STATUS_TimeOut;
+	sample->bus_voltage = self->reg.bus_voltage_register.VBUS;
 	
-	return __INA234_writeTwoBytes(self, MASK_ENABLE_REGISTER);
+	if(STATUS_OK != __INA234_readTwoBytes(self, POWER_REGISTER))
+		return STATUS_TimeOut;
+	sample->power = self->reg.power_register.POWER;
+	
+	if(STATUS_OK != __INA234_readTwoBytes(self, CURRENT_REGISTER))
+		return STATUS_TimeOut;
+	sample->current = self->reg.current_register.CURRENT;
 	
+	return STATUS_OK;
 }
 
-// Privates
+/*!
+    @brief  Estimate the conversion sequence number of a sample from sample::fresh and the time passed since the previous fresh sample, and update the duplicate and gap counters
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  sample
+						A pointer to the ::INA234_Sample
+*/
+void __INA234_updateSequence(INA234* self, INA234_Sample* sample){
+	if(sample->fresh){
+		uint32_t period = INA234_getConversionPeriod(self);
+		uint32_t conversions = 1;
+		
+		if(self->sequence != 0 && period != 0){
+			conversions = (sample->timestamp - self->last_fresh_time + period / 2) / period;
+			if(conversions < 1)
+				conversions = 1;
+		}
+		
+		self->gaps += conversions - 1;
+		self->sequence += conversions;
+		self->last_fresh_time = sample->timestamp;
+	}
+	else{
+		self->duplicates++;
+	}
+	sample->sequence = self->sequence;
+}
+
+/*!
+    @brief  Decode the error flags of the mask/enable register already read into ina234::_reg
+    @param  self
+            A pointer to the ina234 object (struct)
+		@return	Error type (see ::INA234_getErrors())
+*/
+ErrorType __INA234_decodeErrors(INA234* self){
+	if(self->reg.mask_enable_register.MemError && self->reg.mask_enable_register.OVF)
+		return ERROR_BOTH_MEMORY_OVF;
+	else if(self->reg.mask_enable_register.MemError)
+		return ERROR_MEMORY;
+	else if(self->reg.mask_enable_register.OVF)
+		return ERROR_OVF;
+	else
+		return ERROR_NONE;
+}
+
+#if INA234_USE_CACHE
+/*!
+    @brief  Get the time a register read stays valid, from the measured conversion timing (ina234#cache_grid)
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  start
+						Time (in us) the read was started
+		@param  now
+						The time in micro seconds
+		@return	The earliest time the next conversion can complete with the period off by ::INA234_CACHE_TOLERANCE,
+						or now if the conversion timing is unknown or too old, a conversion may have completed during the read,
+						or there are no continuous conversions
+*/
+uint32_t __INA234_cacheExpiry(INA234* self, uint32_t start, uint32_t now){
+	uint32_t period = INA234_getConversionPeriod(self);
+	
+	if(!self->clock || !self->cache_grid_valid || period == 0 || !(self->mode & 0x04))
+		return now;
+	
+	// Conversion k (0 at the measurement) completes between cache_grid + k * the shortest period and cache_grid + cache_window + k * the longest one.
+	// The last conversion certainly completed before the read must also be the last one that may have completed by its end. The uncertainty
+	// grows with k, so the timing is only trusted for about 100 / (2 * INA234_CACHE_TOLERANCE) periods, then the misses measure it again.
+	uint32_t tolerance = period * INA234_CACHE_TOLERANCE / 100;
+	uint32_t elapsed = start - self->cache_grid;
+	if((int32_t)elapsed < 0 || elapsed < self->cache_window)
+		return now;
+	
+	uint32_t last = (elapsed - self->cache_window) / (period + tolerance);
+	uint32_t expires = self->cache_grid + (last + 1) * (period - tolerance);
+	return (int32_t)(expires - now) > 0 ? expires : now;
+}
+
+/*!
+    @brief  Get a measured register from the cache into ina234::_reg if no conversion is expected since it was read.
+						On frequent misses without a recent conversion timing, the conversion ready flag is read to measure it (the flag is kept in ina234#ready_pending).
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  MemAddress
+		        Address of the register
+		@retval True if the value was taken from the cache
+		@retval False if the register must be read from the bus
+*/
+uint8_t __INA234_cacheLookup(INA234* self, uint8_t MemAddress){
+	uint8_t index = MemAddress - SHUNT_VOLTAGE_REGISTER;
+	
+	if(!self->cache_enable || MemAddress < SHUNT_VOLTAGE_REGISTER || MemAddress > CURRENT_REGISTER)
+		return 0;
+	
+	uint32_t now = __INA234_now(self);
+	if((self->cache_valid & (1 << index)) && (int32_t)(self->cache_expires[index] - now) > 0){
+		self->reg.raw_data[0] = self->cache_value[index] & 0xFF;
+		self->reg.raw_data[1] = self->cache_value[index] >> 8;
+		self->cache_hits++;
+		return 1;
+	}
+	self->cache_misses++;
+	
+	// The resync reads the conversion ready flag, which also clears a latched alert and the limit flag, so it is skipped when they are in use
+	uint8_t resync = 1;
+#if INA234_USE_ALERT
+	resync = self->alert_latch != ALERT_LATCHED && self->alert_on == ALERT_NONE;
+#endif
+	uint32_t period = INA234_getConversionPeriod(self);
+	if(resync && self->clock && period && (self->mode & 0x04) && __INA234_cacheExpiry(self, now, now) == now){
+		if(self->cache_miss_valid && now - self->cache_miss_time <= period >> 1)
+			if(STATUS_OK == __INA234_readTwoBytes(self, MASK_ENABLE_REGISTER))
+				self->ready_pending |= self->reg.mask_enable_register.CVRF;
+		self->cache_miss_time = now;
+		self->cache_miss_valid = 1;
+	}
+	return 0;
+}
+
+/*!
+    @brief  Store a measured register just read into ina234::_reg in the cache until the next expected conversion.
+						A conversion ready flag read as set clears the cache, and if the previous flag read was recent, it measures the conversion timing.
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  MemAddress
+		        Address of the register
+		@param  start
+						Time (in us) the read was started
+*/
+void __INA234_cacheStore(INA234* self, uint8_t MemAddress, uint32_t start){
+	uint8_t index = MemAddress - SHUNT_VOLTAGE_REGISTER;
+	
+	if(MemAddress == MASK_ENABLE_REGISTER){
+		if(self->reg.mask_enable_register.CVRF)
+			self->cache_valid = 0;
+		if(!self->cache_enable || !self->clock)
+			return;
+		
+		// The conversion completed between the start of the previous flag read and the end of this one.
+		// A wider window only shortens the time the reads are cached.
+		uint32_t now = __INA234_now(self);
+		if(self->reg.mask_enable_register.CVRF && self->cache_flag_valid && now - self->cache_flag_time <= INA234_getConversionPeriod(self) >> 1){
+			self->cache_grid = self->cache_flag_time;
+			self->cache_window = now - self->cache_flag_time;
+			self->cache_grid_valid = 1;
+			self->cache_syncs++;
+		}
+		self->cache_flag_time = start;
+		self->cache_flag_valid = 1;
+		return;
+	}
+	
+	if(!self->cache_enable || MemAddress < SHUNT_VOLTAGE_REGISTER || MemAddress > CURRENT_REGISTER)
+		return;
+	
+	uint32_t now = __INA234_now(self);
+	uint32_t expires = __INA234_cacheExpiry(self, start, now);
+	if(expires == now)
+		return;
+	
+	self->cache_value[index] = (uint16_t)(self->reg.raw_data[0] | (self->reg.raw_data[1] << 8));
+	self->cache_expires[index] = expires;
+	self->cache_valid |= 1 << index;
+}
+#endif
+
 /*!
     @brief  Read two bytes (a 16bit register) from INA234 and stores in the ina234::_reg::raw_data
     @param  self
@@ -234,11 +843,25 @@ Status INA234_alert_init(INA234* self, AlertOn alert_on, AlertPolarity alert_pol
 		@retval ::STATUS_TimeOut in case of failure
 */
 Status __INA234_readTwoBytes(INA234* self, uint8_t MemAddress){
-	if(HAL_OK == HAL_I2C_Mem_Read(self->hi2c, self->I2C_ADDR, MemAddress, I2C_MEMADD_SIZE_8BIT, self->reg.raw_data, 2, 100)){
+	Status status;
+	
+#if INA234_USE_CACHE
+	if(__INA234_cacheLookup(self, MemAddress))
+		return STATUS_OK;
+	uint32_t start = self->cache_enable ? __INA234_now(self) : 0;
+#endif
+	
+	if(self->transfer)
+		status = self->transfer(self->transfer_context, self->I2C_ADDR, MemAddress, self->reg.raw_data, 2, 0);
+	else
+		status = HAL_OK == HAL_I2C_Mem_Read(self->hi2c, self->I2C_ADDR, MemAddress, I2C_MEMADD_SIZE_8BIT, self->reg.raw_data, 2, INA234_I2C_TIMEOUT) ? STATUS_OK : STATUS_TimeOut;
+	
+	if(status == STATUS_OK){
 		
-		self->reg.raw_data[0] ^= self->reg.raw_data[1];
-		self->reg.raw_data[1] ^= self->reg.raw_data[0];
-		self->reg.raw_data[0] ^= self->reg.raw_data[1];
+		__INA234_swapBytes(self);
+#if INA234_USE_CACHE
+		__INA234_cacheStore(self, MemAddress, start);
+#endif
 
 		return STATUS_OK;
 	}
@@ -259,14 +882,32 @@ Status __INA234_readTwoBytes(INA234* self, uint8_t MemAddress){
 */
 Status __INA234_writeTwoBytes(INA234* self, uint8_t MemAddress){
 
-	self->reg.raw_data[0] ^= self->reg.raw_data[1];
-	self->reg.raw_data[1] ^= self->reg.raw_data[0];
-	self->reg.raw_data[0] ^= self->reg.raw_data[1];
+	Status status;
 	
-	if(HAL_OK == HAL_I2C_Mem_Write(self->hi2c, self->I2C_ADDR, MemAddress, I2C_MEMADD_SIZE_8BIT, self->reg.raw_data, 2, 100))
-		return STATUS_OK;
+	// Writing the configuration restarts the conversions
+	if(MemAddress == CONFIGURATION_REGISTER)
+		self->next_ready_valid = 0;
+#if INA234_USE_CACHE
+	self->cache_valid = 0;
+#endif
+	
+	__INA234_swapBytes(self);
+	
+	if(self->transfer)
+		status = self->transfer(self->transfer_context, self->I2C_ADDR, MemAddress, self->reg.raw_data, 2, 1) == STATUS_OK ? STATUS_OK : STATUS_TimeOut;
 	else
-		return STATUS_TimeOut;
+		status = HAL_OK == HAL_I2C_Mem_Write(self->hi2c, self->I2C_ADDR, MemAddress, I2C_MEMADD_SIZE_8BIT, self->reg.raw_data, 2, INA234_I2C_TIMEOUT) ? STATUS_OK : STATUS_TimeOut;
+	
+#if INA234_USE_CACHE
+	// The conversions restart at the configuration write
+	if(status == STATUS_OK && MemAddress == CONFIGURATION_REGISTER && self->clock){
+		self->cache_grid = __INA234_now(self);
+		self->cache_window = 0;
+		self->cache_grid_valid = 1;
+		self->cache_syncs++;
+	}
+#endif
+	return status;
 }
 
 // Configurations
@@ -283,15 +924,13 @@ Status __INA234_writeTwoBytes(INA234* self, uint8_t MemAddress){
 		@retval ::STATUS_TimeOut in case of failure
 */
 Status INA234_setADCRange(INA234* self, ADCRange adc_range){
-	if(STATUS_OK == __INA234_readTwoBytes(self, CONFIGURATION_REGISTER)){
-		
-		self->reg.config_register.ACDRANGE = adc_range;
-		return __INA234_writeTwoBytes(self, CONFIGURATION_REGISTER);
-		
-	}
-	else{
+	self->adc_range = adc_range;
+	__INA234_buildRegister(self, CONFIGURATION_REGISTER);
+	if(STATUS_OK != __INA234_writeTwoBytes(self, CONFIGURATION_REGISTER))
 		return STATUS_TimeOut;
-	}
+	
+	// Keep the calibration and alert limit consistent with the new range
+	return __INA234_writePlan(self, __INA234_updatePlan(self));
 }
 
 /*!
@@ -313,15 +952,9 @@ Status INA234_setADCRange(INA234* self, ADCRange adc_range){
 		@retval ::STATUS_TimeOut in case of failure
 */
 Status INA234_setNumberOfADCSamples(INA234* self, NumSamples numer_of_adc_samples){
-	if(STATUS_OK == __INA234_readTwoBytes(self, CONFIGURATION_REGISTER)){
-		
-		self->reg.config_register.AVG = numer_of_adc_samples;
-		return __INA234_writeTwoBytes(self, CONFIGURATION_REGISTER);
-		
-	}
-	else{
-		return STATUS_TimeOut;
-	}
+	self->number_of_adc_samples = numer_of_adc_samples;
+	__INA234_buildRegister(self, CONFIGURATION_REGISTER);
+	return __INA234_writeTwoBytes(self, CONFIGURATION_REGISTER);
 }
 
 /*!
@@ -343,15 +976,9 @@ Status INA234_setNumberOfADCSamples(INA234* self, NumSamples numer_of_adc_sample
 		@retval ::STATUS_TimeOut in case of failure
 */
 Status INA234_setVBusConversionTime(INA234* self, ConvTime vbus_conversion_time){
-	if(STATUS_OK == __INA234_readTwoBytes(self, CONFIGURATION_REGISTER)){
-		
-		self->reg.config_register.VBUSCT = vbus_conversion_time;
-		return __INA234_writeTwoBytes(self, CONFIGURATION_REGISTER);
-		
-	}
-	else{
-		return STATUS_TimeOut;
-	}
+	self->vbus_conversion_time = vbus_conversion_time;
+	__INA234_buildRegister(self, CONFIGURATION_REGISTER);
+	return __INA234_writeTwoBytes(self, CONFIGURATION_REGISTER);
 }
 
 /*!
@@ -373,15 +1000,9 @@ Status INA234_setVBusConversionTime(INA234* self, ConvTime vbus_conversion_time)
 		@retval ::STATUS_TimeOut in case of failure
 */
 Status INA234_setVShuntConversionTime(INA234* self, ConvTime vshunt_conversion_time){
-	if(STATUS_OK == __INA234_readTwoBytes(self, CONFIGURATION_REGISTER)){
-		
-		self->reg.config_register.VSHCT = vshunt_conversion_time;
-		return __INA234_writeTwoBytes(self, CONFIGURATION_REGISTER);
-		
-	}
-	else{
-		return STATUS_TimeOut;
-	}
+	self->vshunt_conversion_time = vshunt_conversion_time;
+	__INA234_buildRegister(self, CONFIGURATION_REGISTER);
+	return __INA234_writeTwoBytes(self, CONFIGURATION_REGISTER);
 }
 
 /*!
@@ -402,26 +1023,53 @@ Status INA234_setVShuntConversionTime(INA234* self, ConvTime vshunt_conversion_t
 		@retval ::STATUS_TimeOut in case of failure
 */
 Status INA234_setMode(INA234* self, Mode mode){
-	if(STATUS_OK == __INA234_readTwoBytes(self, CONFIGURATION_REGISTER)){
-		
-		self->reg.config_register.MODE = mode;
-		return __INA234_writeTwoBytes(self, CONFIGURATION_REGISTER);
-		
-	}
-	else{
-		return STATUS_TimeOut;
-	}
+	self->mode = mode;
+	__INA234_buildRegister(self, CONFIGURATION_REGISTER);
+	return __INA234_writeTwoBytes(self, CONFIGURATION_REGISTER);
 }
 
 /*!
-    @brief  Get the ADC full scale range of INA234
+    @brief  Set the shunt resistance. The calibration value is updated only if it changes.
     @param  self
             A pointer to the ina234 object (struct)
-		@return The full scale range of ADC.
-		@retval ::RANGE_81_92mV for 81.92 mV
-		@retval ::RANGE_20_48mV for 20.48 mV
-*/
-ADCRange INA234_getADCRange(INA234* self){
+		@param  ShuntResistor
+						The resistance of your shunt resistor (in mOhm, or in micro Ohm if ::INA234_USE_FLOAT is 0) connected to IN+ and IN- of the INA234
+		@return	Ths status of config
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut in case of failure
+*/
+Status INA234_setShuntResistor(INA234* self, INA234_Resistance ShuntResistor){
+	self->ShuntResistor = ShuntResistor;
+	return __INA234_writePlan(self, __INA234_updatePlan(self));
+}
+
+#if INA234_USE_ALERT
+/*!
+    @brief  Set the alert limit. The unit is related to the alert_on argument of ::INA234_alert_init(). The alert limit register is written only if its raw value changes.
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  alert_limit
+						The new limit value
+		@return	Ths status of config
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut in case of failure
+*/
+Status INA234_setAlertLimit(INA234* self, INA234_Limit alert_limit){
+	self->alert_limit = alert_limit;
+	return __INA234_writePlan(self, __INA234_updatePlan(self));
+}
+#endif
+
+#if INA234_USE_CONFIG_GETTERS
+/*!
+    @brief  Get the ADC full scale range of INA234
+    @param  self
+            A pointer to the ina234 object (struct)
+		@return The full scale range of ADC.
+		@retval ::RANGE_81_92mV for 81.92 mV
+		@retval ::RANGE_20_48mV for 20.48 mV
+*/
+ADCRange INA234_getADCRange(INA234* self){
 	return self->adc_range;
 }
 
@@ -495,6 +1143,7 @@ ConvTime INA234_getVShuntConversionTime(INA234* self){
 Mode INA234_getMode(INA234* self){
 	return self->mode;
 }
+#endif
 
 /*!
     @brief  Send a reset command to all of the INA234s on the bus
@@ -503,10 +1152,119 @@ Mode INA234_getMode(INA234* self){
 */
 void INA234_SoftResetAll(INA234* self){
 	uint8_t data = 0x06;
-	HAL_I2C_Master_Transmit(self->hi2c, 0x00, &data, 1, 100);
+	
+	if(self->transfer)
+		self->transfer(self->transfer_context, 0x00, data, NULL, 0, 1);
+	else
+		HAL_I2C_Master_Transmit(self->hi2c, 0x00, &data, 1, INA234_I2C_TIMEOUT);
+}
+
+/*!
+    @brief  Set the monotonic clock used to timestamp the samples. Call it after ::INA234_init().
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  clock
+						A function returning the time in microseconds (for example a free running timer or the DWT cycle counter divided by the core clock in MHz).
+						If it is NULL, HAL_GetTick() is used which has only 1ms resolution.
+*/
+void INA234_setClock(INA234* self, INA234_Clock clock){
+	self->clock = clock;
+}
+
+/*!
+    @brief  Set the function used by ::INA234_waitForData() to sleep through the conversions. Call it after ::INA234_init().
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  sleep
+						A function that blocks for the given time in microseconds, for example with osDelay() of an RTOS or a low power timer, so the other tasks can run meanwhile.
+						If it is NULL, the clock given to ::INA234_setClock() is polled, or HAL_Delay() is used if there is no clock.
+*/
+void INA234_setSleep(INA234* self, INA234_Sleep sleep){
+	self->sleep = sleep;
+}
+
+/*!
+    @brief  Set the function used for all of the blocking register reads and writes instead of HAL_I2C_Mem_Read / HAL_I2C_Mem_Write. Call it after ::INA234_init().
+						The general call reset of ::INA234_SoftResetAll() goes through it too (a write of Size 0 to DevAddress 0). ::INA234_initMany() and the sweeps still use the HAL directly,
+						and so does ::INA234_probe(), which resets the transport of the entries it fills.
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  transfer
+						The function, or NULL to use the HAL again
+		@param  context
+						Passed to the function as its first argument
+*/
+void INA234_setTransfer(INA234* self, INA234_Transfer transfer, void* context){
+	self->transfer = transfer;
+	self->transfer_context = context;
+}
+
+/*!
+    @brief  Set a function called at the steps of the driver (acquisitions, waits, sleeps, flag polls, published samples, alert interrupts), for example
+						::INA234_Trace_event() to put them on the timeline of a trace. It is called from the interrupts too (::INA234_alertISR(), ::INA234_Sweep_onTransferComplete()),
+						so it must be short. Without it (by default), an event costs one comparison.
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  event_hook
+						The function, or NULL to stop reporting
+		@param  context
+						Passed to the function as its first argument
+*/
+void INA234_setEventHook(INA234* self, INA234_EventHook event_hook, void* context){
+	self->event_hook = event_hook;
+	self->event_context = context;
+}
+
+#if INA234_USE_CACHE
+/*!
+    @brief  Enable the cache of the measured registers (shunt voltage, bus voltage, power and current). Call it after ::INA234_init() and ::INA234_setClock().
+						In the continuous modes a register read again before the next conversion is expected returns the cached value without a bus transaction.
+						The conversion timing is measured at the configuration write and from the edges of the conversion ready flag, and the period is assumed to be off by up to
+						::INA234_CACHE_TOLERANCE, so the timing is only trusted for a few periods after each measurement.
+						Any register write and any conversion ready flag read as set clear the cache. The reads are counted in ina234#cache_hits and ina234#cache_misses.
+						It needs a microsecond clock (see ::INA234_setClock()); without it nothing is cached.
+						When the timing is too old, a cache miss may also read the conversion ready flag to measure it again. **NOTE: That read would reset the alert pin in the latch mode
+						and clear the limit flag, so it is not done when the latch mode or a limit alert is configured by ::INA234_alert_init(). The cache then only uses the timing
+						of the configuration writes and of your own flag reads.**
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  enable
+						1 to enable, 0 to disable
+*/
+void INA234_setCache(INA234* self, uint8_t enable){
+	self->cache_enable = enable;
+	self->cache_valid = 0;
+}
+
+/*!
+    @brief  Clear the cache, so the next reads of the measured registers go to the bus even if no new conversion is expected yet
+    @param  self
+            A pointer to the ina234 object (struct)
+*/
+void INA234_forceRefresh(INA234* self){
+	self->cache_valid = 0;
+}
+#endif
+
+/*!
+    @brief  Get the time between two consecutive conversions, calculated from the conversion times, the number of ADC samples and the mode
+    @param  self
+            A pointer to the ina234 object (struct)
+		@return	The conversion period in **micro seconds**. It is zero in the shutdown mode.
+*/
+uint32_t INA234_getConversionPeriod(INA234* self){
+	uint32_t period = 0;
+	
+	if(self->mode & 0x01)
+		period += __INA234_conversionTimes[self->vshunt_conversion_time];
+	if(self->mode & 0x02)
+		period += __INA234_conversionTimes[self->vbus_conversion_time];
+	
+	return period * __INA234_numberOfSamples[self->number_of_adc_samples];
 }
 
 // Getting Data
+#if INA234_USE_IDS
 /*!
     @brief  Get the manufacturer ID
     @param  self
@@ -528,18 +1286,370 @@ uint16_t INA234_getDevID(INA234* self){
 	__INA234_readTwoBytes(self, DEVICEID_REGISTER);
 	return self->reg.devide_id_register.DIEID;	
 }
+#endif
 
 /*!
-    @brief  Read all of the measured values: Shunt voltage, bus voltage, power, and current. Then store the values to the ina234 object (struct) variables.
-						Then you can read variables: ina234#ShuntVoltage, ina234#BusVoltage, ina234#Power, and ina234#Current
+    @brief  Read all of the measured values: Shunt voltage, bus voltage, power, and current. Then publish them as a raw sample (see ::INA234_publish()).
+						Then you can get the values with ::INA234_getValue(), which converts them only when they are used
     @param  self
             A pointer to the ina234 object (struct)
 */
 void INA234_readAll(INA234* self){
-	INA234_getShuntVoltage(self);
-	INA234_getBusVoltage(self);
-	INA234_getPower(self);
-	INA234_getCurrent(self);
+	INA234_Sample sample;
+	
+	// The conversion ready flag is not checked here
+	sample.fresh = 1;
+	sample.sequence = self->sequence;
+	if(STATUS_OK != __INA234_readMeasurements(self, &sample))
+		return;
+	
+	// Only the raw values are kept; they are converted by INA234_getValue when they are used
+	INA234_publish(self, &sample);
+}
+
+/*!
+    @brief  Body of ::INA234_acquire()
+*/
+Status __INA234_acquire(INA234* self, INA234_Sample* sample){
+	
+	// Conversion Ready Flag ----------------
+	if(STATUS_OK != __INA234_readTwoBytes(self, MASK_ENABLE_REGISTER))
+		return STATUS_TimeOut;
+	sample->fresh = self->reg.mask_enable_register.CVRF | self->ready_pending;
+	self->ready_pending = 0;
+	
+	// Measured Values ----------------------
+	if(STATUS_OK != __INA234_readMeasurements(self, sample))
+		return STATUS_TimeOut;
+	
+	__INA234_updateSequence(self, sample);
+	INA234_publish(self, sample);
+	return STATUS_OK;
+}
+
+/*!
+    @brief  Acquire a timestamped sample: check the conversion ready flag, read all of the measured values, and estimate the conversion sequence number.
+						If no conversion was done since the previous sample, the sample is counted in ina234#duplicates.
+						If more than one conversion period passed since the previous fresh sample, the skipped conversions are counted in ina234#gaps.
+						**NOTE: This function will reset the alert pin if it was in the latch mode. Exactly like calling the ::INA234_resetAlert() function.**
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  sample
+						A pointer to the ::INA234_Sample to be filled
+		@return	Ths status of reading
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut in case of failure
+*/
+Status INA234_acquire(INA234* self, INA234_Sample* sample){
+	__INA234_event(self, EVENT_ACQUIRE, PHASE_BEGIN, 0);
+	Status status = __INA234_acquire(self, sample);
+	__INA234_event(self, EVENT_ACQUIRE, PHASE_END, status);
+	return status;
+}
+
+/*!
+    @brief  Body of ::INA234_readSnapshot()
+*/
+Status __INA234_readSnapshot(INA234* self, INA234_Sample* sample){
+	
+	if(STATUS_OK != __INA234_readTwoBytes(self, MASK_ENABLE_REGISTER))
+		return STATUS_TimeOut;
+	sample->fresh = self->reg.mask_enable_register.CVRF | self->ready_pending;
+	self->ready_pending = 0;
+	
+	for(uint8_t attempt = 0; attempt <= INA234_SNAPSHOT_RETRIES; attempt++){
+		
+		if(STATUS_OK != __INA234_readMeasurements(self, sample))
+			return STATUS_TimeOut;
+		
+		if(STATUS_OK != __INA234_readTwoBytes(self, MASK_ENABLE_REGISTER))
+			return STATUS_TimeOut;
+		
+		if(!self->reg.mask_enable_register.CVRF){
+			self->snapshots++;
+			__INA234_updateSequence(self, sample);
+			INA234_publish(self, sample);
+			return STATUS_OK;
+		}
+		
+		// A conversion completed in between, so the new values are ready to be read again
+		self->tears++;
+		sample->fresh = 1;
+		__INA234_event(self, EVENT_SNAPSHOT_RETRY, PHASE_INSTANT, attempt + 1);
+	}
+	
+	self->snapshots++;
+	self->torn_snapshots++;
+	__INA234_updateSequence(self, sample);
+	return STATUS_Torn;
+}
+
+/*!
+    @brief  Acquire a coherent sample, in which all of the measured values belong to the same conversion.
+						The reads are bracketed by two checks of the conversion ready flag. If a conversion completes while reading (tearing), the read is retried
+						up to ::INA234_SNAPSHOT_RETRIES times. Each torn read is counted in ina234#tears and each snapshot that stayed torn after all retries in ina234#torn_snapshots.
+						Calling it right after a conversion ready alert gives the whole conversion period to the reads, so the tearing is very unlikely.
+						**NOTE: This function will reset the alert pin if it was in the latch mode. Exactly like calling the ::INA234_resetAlert() function.**
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  sample
+						A pointer to the ::INA234_Sample to be filled
+		@return	Ths status of reading
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut in case of failure
+		@retval ::STATUS_Torn if the values were still torn after all of the retries (the sample is filled with the last read)
+*/
+Status INA234_readSnapshot(INA234* self, INA234_Sample* sample){
+	__INA234_event(self, EVENT_SNAPSHOT, PHASE_BEGIN, 0);
+	Status status = __INA234_readSnapshot(self, sample);
+	__INA234_event(self, EVENT_SNAPSHOT, PHASE_END, status);
+	return status;
+}
+
+/*!
+    @brief  Body of ::INA234_waitForData()
+*/
+Status __INA234_waitForData(INA234* self, uint32_t timeout){
+	uint32_t period = INA234_getConversionPeriod(self);
+	uint32_t start = __INA234_now(self);
+	uint32_t expected = self->next_ready_valid ? self->next_ready : start;
+	uint32_t guard = period >> 4;
+	uint32_t step = period >> 5;
+	uint32_t max_step = period >> 2;
+	uint8_t polls = 0;
+	
+	if(period == 0)
+		return STATUS_TimeOut;
+	if(step < INA234_WAIT_MIN_STEP)
+		step = INA234_WAIT_MIN_STEP;
+	if(max_step < step)
+		max_step = step;
+	self->waits++;
+	
+	// Sleep through the conversion, waking up a little early to catch the flag on time
+	int32_t remaining = (int32_t)(expected - guard - start);
+	if(remaining > 0)
+		__INA234_sleep(self, (uint32_t)remaining < timeout ? (uint32_t)remaining : timeout);
+	
+	// Poll the flag with backoff
+	while(1){
+		if(STATUS_OK != __INA234_readTwoBytes(self, MASK_ENABLE_REGISTER))
+			return STATUS_TimeOut;
+		polls++;
+		self->wait_polls++;
+		uint32_t now = __INA234_now(self);
+		__INA234_event(self, EVENT_POLL, PHASE_INSTANT, self->reg.mask_enable_register.CVRF);
+		
+		if(self->reg.mask_enable_register.CVRF){
+			// Ready at the first read: the flag may have been set long before, so keep the estimated timing unless it is too far behind
+			uint32_t ready = (polls == 1 && self->next_ready_valid && now - expected < period) ? expected : now;
+			self->next_ready = ready + period;
+			self->next_ready_valid = 1;
+			self->ready_pending = 1;
+			return STATUS_OK;
+		}
+		
+		uint32_t elapsed = now - start;
+		if(elapsed >= timeout)
+			return STATUS_TimeOut;
+		__INA234_sleep(self, step < timeout - elapsed ? step : timeout - elapsed);
+		if(step < max_step)
+			step = (step << 1) < max_step ? step << 1 : max_step;
+	}
+}
+
+/*!
+    @brief  Wait until a new conversion is done. It first sleeps (see ::INA234_setSleep()) for the expected remaining conversion time, calculated from
+						the conversion times, the number of ADC samples and the time of the previous conversion ready flag, and only then polls the conversion ready flag
+						with a delay starting from 1/32 of the conversion period (at least ::INA234_WAIT_MIN_STEP) and doubling up to 1/4 of it.
+						So in the continuous modes it usually takes one or two register reads per conversion. The reads are counted in ina234#wait_polls.
+						The flag is remembered for the next ::INA234_acquire() or ::INA234_readSnapshot(), so their samples are still marked as fresh.
+						**NOTE: This function will reset the alert pin if it was in the latch mode. Exactly like calling the ::INA234_resetAlert() function.**
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  timeout
+						The maximum waiting time in micro seconds (for example twice ::INA234_getConversionPeriod())
+		@return	Ths status of waiting
+		@retval ::STATUS_OK when a new conversion is ready
+		@retval ::STATUS_TimeOut in case of timeout, I2C failure, or the shutdown mode
+*/
+Status INA234_waitForData(INA234* self, uint32_t timeout){
+	__INA234_event(self, EVENT_WAIT, PHASE_BEGIN, 0);
+	Status status = __INA234_waitForData(self, timeout);
+	__INA234_event(self, EVENT_WAIT, PHASE_END, status);
+	return status;
+}
+
+/*!
+    @brief  Body of ::INA234_acquireNext()
+*/
+Status __INA234_acquireNext(INA234* self, INA234_Sample* sample, uint32_t timeout){
+	
+	if(STATUS_OK != INA234_waitForData(self, timeout))
+		return STATUS_TimeOut;
+	sample->fresh = 1;
+	self->ready_pending = 0;
+	
+	if(STATUS_OK != __INA234_readMeasurements(self, sample))
+		return STATUS_TimeOut;
+	
+	__INA234_updateSequence(self, sample);
+	INA234_publish(self, sample);
+	return STATUS_OK;
+}
+
+/*!
+    @brief  Wait for a new conversion with ::INA234_waitForData() and acquire it. Like ::INA234_acquire(), but the conversion ready flag is not read again.
+						**NOTE: This function will reset the alert pin if it was in the latch mode. Exactly like calling the ::INA234_resetAlert() function.**
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  sample
+						A pointer to the ::INA234_Sample to be filled
+		@param  timeout
+						The maximum waiting time in micro seconds
+		@return	Ths status of reading
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut in case of timeout or failure
+*/
+Status INA234_acquireNext(INA234* self, INA234_Sample* sample, uint32_t timeout){
+	__INA234_event(self, EVENT_ACQUIRE_NEXT, PHASE_BEGIN, 0);
+	Status status = __INA234_acquireNext(self, sample, timeout);
+	__INA234_event(self, EVENT_ACQUIRE_NEXT, PHASE_END, status);
+	return status;
+}
+
+/*!
+    @brief  Publish a sample for the other tasks and ISRs. It is called automatically by ::INA234_readAll(), ::INA234_acquire() and ::INA234_readSnapshot().
+						The sample is written with a sequence-lock protocol into two slots, so the readers (::INA234_getPublished()) never block the writer
+						and always get a complete sample. There must be only one writer for each ina234 object (struct).
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  sample
+						A pointer to the ::INA234_Sample to be published
+*/
+void INA234_publish(INA234* self, const INA234_Sample* sample){
+	// Odd sequence: the readers use slot 1 while slot 0 is being written
+	self->published_seq++;
+	__DMB();
+	self->published[0] = *sample;
+	__DMB();
+	
+	// Even sequence: the readers use slot 0 while slot 1 is being written
+	self->published_seq++;
+	__DMB();
+	self->published[1] = *sample;
+	__DMB();
+	
+#if INA234_USE_FLOAT
+	self->converted = 0;
+#endif
+	__INA234_event(self, EVENT_SAMPLE, PHASE_INSTANT, sample->fresh);
+}
+
+/*!
+    @brief  Get the last published sample. It can be called from any task or ISR, even while the sample is being published.
+						It never waits for the writer; it only retries if a new sample was published while copying.
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  sample
+						A pointer to the ::INA234_Sample to be filled
+		@retval True if a sample has been published
+		@retval False if nothing has been published yet
+*/
+uint8_t INA234_getPublished(INA234* self, INA234_Sample* sample){
+	uint32_t seq;
+	
+	do{
+		seq = self->published_seq;
+		__DMB();
+		*sample = self->published[seq & 1];
+		__DMB();
+	}while(seq != self->published_seq);
+	
+	return seq != 0;
+}
+
+/*!
+    @brief  Convert one channel of a sample to fixed-point without any float operation
+    @param  sample
+            A pointer to the ::INA234_Sample
+		@param  channel
+						One of the ::Channel values
+		@return	The value in **thousandths** of the units of the float getters (uV, mV, mW or mA) with 8 fractional bits
+*/
+int32_t INA234_Sample_getFixedQ8(const INA234_Sample* sample, Channel channel){
+	const int32_t* scales = __INA234_fixedScales[sample->adc_range];
+	
+	switch (channel) {
+		case CHANNEL_SHUNT_VOLTAGE:
+			return sample->shunt_voltage * scales[CHANNEL_SHUNT_VOLTAGE];
+		case CHANNEL_BUS_VOLTAGE:
+			return sample->bus_voltage * scales[CHANNEL_BUS_VOLTAGE];
+		case CHANNEL_POWER:
+			return sample->power * scales[CHANNEL_POWER];
+		case CHANNEL_CURRENT:
+			return sample->current * scales[CHANNEL_CURRENT];
+	}
+	return 0;
+}
+
+/*!
+    @brief  Convert one channel of a sample to an integer without any float operation
+    @param  sample
+            A pointer to the ::INA234_Sample
+		@param  channel
+						One of the ::Channel values
+		@return	The value (rounded) in **micro Volts** for the shunt voltage, **mili Volts** for the bus voltage, **mili Watts** for the power, or **mili Amps** for the current
+*/
+int32_t INA234_Sample_getFixed(const INA234_Sample* sample, Channel channel){
+	int32_t value = INA234_Sample_getFixedQ8(sample, channel);
+	return value >= 0 ? (value + 128) >> 8 : -((-value + 128) >> 8);
+}
+
+#if INA234_USE_FLOAT
+/*!
+    @brief  Convert one channel of a sample to float, with the LSB of the range the sample was acquired in
+    @param  sample
+            A pointer to the ::INA234_Sample
+		@param  channel
+						One of the ::Channel values
+		@return	The value in **miliVolts** for the shunt voltage, **Volts** for the bus voltage, **Watts** for the power, or **Amps** for the current
+*/
+float INA234_Sample_getFloat(const INA234_Sample* sample, Channel channel){
+	const float* scales = __INA234_floatScales[sample->adc_range];
+	
+	switch (channel) {
+		case CHANNEL_SHUNT_VOLTAGE:
+			return sample->shunt_voltage * scales[CHANNEL_SHUNT_VOLTAGE];
+		case CHANNEL_BUS_VOLTAGE:
+			return sample->bus_voltage * scales[CHANNEL_BUS_VOLTAGE];
+		case CHANNEL_POWER:
+			return sample->power * scales[CHANNEL_POWER];
+		case CHANNEL_CURRENT:
+			return sample->current * scales[CHANNEL_CURRENT];
+	}
+	return 0;
+}
+
+/*!
+    @brief  Get one value of the last published sample (see ::INA234_readAll(), ::INA234_acquire() and ::INA234_readSnapshot()) without any bus transaction.
+						The raw value is converted to float on the first call after each sample and kept in ina234#value for the next calls.
+						Call it from the same task as the reads; the other tasks and ISRs should use ::INA234_getPublished() and ::INA234_Sample_getFloat().
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  channel
+						One of the ::Channel values
+		@return	The value in **miliVolts** for the shunt voltage, **Volts** for the bus voltage, **Watts** for the power, or **Amps** for the current.
+						It is zero if nothing has been published yet.
+*/
+float INA234_getValue(INA234* self, Channel channel){
+	if(self->published_seq == 0)
+		return 0;
+	if(!(self->converted & (1 << channel))){
+		self->value[channel] = INA234_Sample_getFloat(&self->published[1], channel);
+		self->converted |= 1 << channel;
+	}
+	return self->value[channel];
 }
 
 /*!
@@ -550,8 +1660,7 @@ void INA234_readAll(INA234* self){
 */
 float INA234_getCurrent(INA234* self){ // In A
 	__INA234_readTwoBytes(self, CURRENT_REGISTER);
-	self->Current = self->reg.current_register.CURRENT * CURRENT_LSB;
-	return self->Current;
+	return self->reg.current_register.CURRENT * self->plan.current_lsb;
 }
 
 /*!
@@ -562,8 +1671,7 @@ float INA234_getCurrent(INA234* self){ // In A
 */
 float INA234_getBusVoltage(INA234* self){ // In V
 	__INA234_readTwoBytes(self, BUS_VOLTAGE_REGISTER);
-	self->BusVoltage = self->reg.bus_voltage_register.VBUS * BUS_VOLTAGE_LSB;
-	return self->BusVoltage;
+	return self->reg.bus_voltage_register.VBUS * self->plan.bus_voltage_lsb;
 }
 
 /*!
@@ -574,8 +1682,7 @@ float INA234_getBusVoltage(INA234* self){ // In V
 */
 float INA234_getShuntVoltage(INA234* self){ // In mV
 	__INA234_readTwoBytes(self, SHUNT_VOLTAGE_REGISTER);
-	self->ShuntVoltage = self->reg.shunt_voltage_register.VSHUNT * (self->adc_range == RANGE_20_48mV ? SHUNT_VOLTAGE_20_48mv_LSB : SHUNT_VOLTAGE_81_92mv_LSB);
-	return self->ShuntVoltage;
+	return self->reg.shunt_voltage_register.VSHUNT * self->plan.shunt_voltage_lsb;
 }
 
 /*!
@@ -586,9 +1693,9 @@ float INA234_getShuntVoltage(INA234* self){ // In mV
 */
 float INA234_getPower(INA234* self){ // In Watt
 	__INA234_readTwoBytes(self, POWER_REGISTER);
-	self->Power = self->reg.power_register.POWER * POWER_LSB;
-	return self->Power;
+	return self->reg.power_register.POWER * self->plan.power_lsb;
 }
+#endif
 
 /*!
     @brief  Check if the conversion is done or not. **NOTE: This function will reset the alert pin if it was in the latch mode. Exactly like calling the ::INA234_resetAlert() function.**
@@ -598,10 +1705,14 @@ float INA234_getPower(INA234* self){ // In Watt
 		@retval False
 */
 uint8_t INA234_isDataReady(INA234* self){
+	uint8_t ready = self->ready_pending;
+	
+	self->ready_pending = 0;
 	__INA234_readTwoBytes(self, MASK_ENABLE_REGISTER);
-	return self->reg.mask_enable_register.CVRF == 1;
+	return ready || self->reg.mask_enable_register.CVRF == 1;
 }
 
+#if INA234_USE_ALERT
 /*!
     @brief  Get the alert source. This function is usefull when you enabled both of the alert functions and data ready alert simultaneously. **NOTE: This function will reset the alert pin if it was in the latch mode. Exactly like calling the ::INA234_resetAlert() function.**
     @param  self
@@ -614,6 +1725,7 @@ AlertSource INA234_getAlertSource(INA234* self){
 	__INA234_readTwoBytes(self, MASK_ENABLE_REGISTER);
 	return self->reg.mask_enable_register.AFF ? ALERT_LIMIT_REACHED : ALERT_DATA_READY;
 }
+#endif
 
 /*!
     @brief  Get the error flags of INA234. **NOTE: This function will reset the alert pin if it was in the latch mode. Exactly like calling the ::INA234_resetAlert() function.**
@@ -627,16 +1739,10 @@ AlertSource INA234_getAlertSource(INA234* self){
 */
 ErrorType INA234_getErrors(INA234* self){
 	__INA234_readTwoBytes(self, MASK_ENABLE_REGISTER);
-	if(self->reg.mask_enable_register.MemError && self->reg.mask_enable_register.OVF)
-		return ERROR_BOTH_MEMORY_OVF;
-	else if(self->reg.mask_enable_register.MemError)
-		return ERROR_MEMORY;
-	else if(self->reg.mask_enable_register.OVF)
-		return ERROR_OVF;
-	else
-		return ERROR_NONE;
+	return __INA234_decodeErrors(self);
 }
 
+#if INA234_USE_ALERT
 /*!
     @brief  Reset the alert pin. This function is useful when set the alert pin to latch mode.
     @param  self
@@ -648,3 +1754,364 @@ ErrorType INA234_getErrors(INA234* self){
 Status INA234_resetAlert(INA234* self){
 	return __INA234_readTwoBytes(self, MASK_ENABLE_REGISTER);
 }
+
+/*!
+    @brief  Enable or disable the alert on conversion ready, keeping the other alert settings of ::INA234_alert_init(), and clear the pending alerts.
+						Use it to arm the alert before ::INA234_sleepUntilAlert(): ::ALERT_CONV_ENABLE to wake up on every conversion, or ::ALERT_CONV_DISABLE to wake up only on the limit.
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param	alert_conv_ready
+						- ::ALERT_CONV_ENABLE assert the alert pin on data ready event
+						- ::ALERT_CONV_DISABLE disable the data ready assertion
+		@return	Ths status of config
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut in case of failure
+*/
+Status INA234_armAlert(INA234* self, AlertConvReady alert_conv_ready){
+	self->alert_conv_ready = alert_conv_ready;
+	__INA234_buildRegister(self, MASK_ENABLE_REGISTER);
+	if(STATUS_OK != __INA234_writeTwoBytes(self, MASK_ENABLE_REGISTER))
+		return STATUS_TimeOut;
+	
+	// Clear the flag before reading, so an alert right after the read is not lost
+	self->alert_pending = 0;
+	return __INA234_readTwoBytes(self, MASK_ENABLE_REGISTER);
+}
+
+/*!
+    @brief  Tell the library that the alert pin was asserted. Call it from the EXTI callback of the alert pin (HAL_GPIO_EXTI_Callback),
+						on the falling edge for ::ALERT_ACTIVE_LOW or the rising edge for ::ALERT_ACTIVE_HIGH.
+    @param  self
+            A pointer to the ina234 object (struct)
+*/
+void INA234_alertISR(INA234* self){
+	self->alert_pending = 1;
+	__INA234_event(self, EVENT_ALERT_ISR, PHASE_INSTANT, 0);
+}
+
+/*!
+    @brief  Put the MCU in a low power mode until the INA234 asserts the alert pin (conversion ready or limit, see ::INA234_armAlert()), then read and decode
+						the mask/enable register in one transaction. The time from each wake up (by an alert or by the timeout) to the next call is counted
+						as awake time, so the average MCU awake time per wake up is ina234#awake_total / (ina234#wakeups - 1) and the last one is ina234#awake_last.
+						The check of the pending alert and the idle function run with the interrupts disabled, so an alert right before sleeping is not missed
+						(WFI still wakes up on a pending interrupt). Wake ups by other interrupts (SysTick, etc.) are counted in ina234#spurious_wakeups
+						and the MCU goes back to sleep; suspend the tick in the idle function to avoid them.
+						**NOTE: This function will reset the alert pin if it was in the latch mode. Exactly like calling the ::INA234_resetAlert() function.**
+    @param  self
+            A pointer to the ina234 object (struct)
+		@param  idle
+						The function that enters the low power mode, for example HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI)
+		@param  timeout
+						The maximum time (in us) to wait. 0 to wait forever. It is checked only on the wake ups, and needs a clock that runs in the low power mode.
+		@param  event
+						A pointer to the ::INA234_AlertEvent to be filled
+		@return	Ths status of waiting
+		@retval ::STATUS_OK in case of an alert
+		@retval ::STATUS_TimeOut in case of timeout or I2C failure
+*/
+Status INA234_sleepUntilAlert(INA234* self, INA234_Idle idle, uint32_t timeout, INA234_AlertEvent* event){
+	uint32_t start = __INA234_now(self);
+	
+	if(self->wakeups){
+		self->awake_last = start - self->wake_time;
+		self->awake_total += self->awake_last;
+	}
+	
+	Status status = STATUS_OK;
+	
+	__INA234_event(self, EVENT_ALERT_SLEEP, PHASE_BEGIN, 0);
+	while(1){
+		__disable_irq();
+		if(self->alert_pending){
+			__enable_irq();
+			break;
+		}
+		idle();
+		__enable_irq();
+		
+		if(!self->alert_pending)
+			self->spurious_wakeups++;
+		if(timeout && __INA234_now(self) - start >= timeout){
+			status = STATUS_TimeOut;
+			break;
+		}
+	}
+	__INA234_event(self, EVENT_ALERT_SLEEP, PHASE_END, status);
+	
+	// Both exits start an awake period, so the next call accounts it
+	self->wake_time = __INA234_now(self);
+	self->asleep_total += self->wake_time - start;
+	self->wakeups++;
+	if(status != STATUS_OK)
+		return status;
+	
+	// Decode the alert in one read. The flag is cleared before, so the next alert is not lost.
+	self->alert_pending = 0;
+	if(STATUS_OK != __INA234_readTwoBytes(self, MASK_ENABLE_REGISTER))
+		return STATUS_TimeOut;
+	event->data_ready = self->reg.mask_enable_register.CVRF;
+	event->limit_reached = self->reg.mask_enable_register.AFF;
+	event->errors = __INA234_decodeErrors(self);
+	
+	// The conversion ready flag is cleared by this read, so remember it for the next sample
+	self->ready_pending |= event->data_ready;
+	return STATUS_OK;
+}
+#endif
+
+// Chained Reads
+/*!
+    @brief  Initialize a chained read (sweep) of a list of (device, register) pairs on one I2C bus.
+						Each item is read by a register pointer write and a value read, chained with repeated STARTs by the sequential transfers of the HAL.
+						There is only one STOP at the end of the whole sweep, so the bus is never released between the devices.
+    @param  self
+            A pointer to the ::INA234_Sweep
+		@param  hi2c
+						The I2C handler of the bus. All of the devices in the items must be on it.
+		@param  items
+						An array of ::INA234_SweepItem. It must stay valid (and must not be on the stack if use_dma is 1) while the sweep is running.
+		@param  count
+						The number of items
+		@param  use_dma
+						1 to use HAL_I2C_Master_Seq_Transmit_DMA / HAL_I2C_Master_Seq_Receive_DMA, 0 to use the _IT ones
+*/
+void INA234_Sweep_init(INA234_Sweep* self, I2C_HandleTypeDef* hi2c, INA234_SweepItem* items, uint16_t count, uint8_t use_dma){
+	self->hi2c = hi2c;
+	self->items = items;
+	self->count = count;
+	self->use_dma = use_dma;
+	self->index = 0;
+	self->phase = 0;
+	self->busy = 0;
+	self->status = STATUS_OK;
+	self->start_time = 0;
+	self->sweeps = 0;
+	self->transfers = 0;
+	self->errors = 0;
+}
+
+/*!
+    @brief  Fill the items of a sweep with the four measurement registers of each device, in the order expected by ::INA234_Sweep_getSample()
+    @param  items
+            An array of at least 4 * count ::INA234_SweepItem
+		@param  devices
+						An array of initialized ina234 objects (struct)
+		@param  count
+						The number of devices
+		@return	The number of filled items
+*/
+uint16_t INA234_Sweep_fillMeasurements(INA234_SweepItem* items, INA234* devices, uint8_t count){
+	static const uint8_t registers[4] = {SHUNT_VOLTAGE_REGISTER, BUS_VOLTAGE_REGISTER, POWER_REGISTER, CURRENT_REGISTER};
+	uint16_t n = 0;
+	
+	for(uint8_t i=0; i<count; i++){
+		for(uint8_t j=0; j<4; j++){
+			items[n].device = &devices[i];
+			items[n].MemAddress = registers[j];
+			n++;
+		}
+	}
+	return n;
+}
+
+/*!
+    @brief  Start the sequential transfer of the current item of a sweep: the register pointer write with a (repeated) START,
+						or the value read with a repeated START, a NACK, and a STOP only after the last item.
+    @param  self
+            A pointer to the ::INA234_Sweep
+		@return	Ths status of starting the transfer
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut in case of failure
+*/
+Status __INA234_Sweep_transfer(INA234_Sweep* self){
+	INA234_SweepItem* item = &self->items[self->index];
+	uint16_t address = item->device->I2C_ADDR;
+	HAL_StatusTypeDef result;
+	
+	self->transfers++;
+	if(self->phase == 0){
+		if(self->use_dma)
+			result = HAL_I2C_Master_Seq_Transmit_DMA(self->hi2c, address, &item->MemAddress, 1, I2C_FIRST_FRAME);
+		else
+			result = HAL_I2C_Master_Seq_Transmit_IT(self->hi2c, address, &item->MemAddress, 1, I2C_FIRST_FRAME);
+	}
+	else{
+		uint32_t options = self->index + 1 == self->count ? I2C_LAST_FRAME : I2C_LAST_FRAME_NO_STOP;
+		if(self->use_dma)
+			result = HAL_I2C_Master_Seq_Receive_DMA(self->hi2c, address, item->raw_data, 2, options);
+		else
+			result = HAL_I2C_Master_Seq_Receive_IT(self->hi2c, address, item->raw_data, 2, options);
+	}
+	return result == HAL_OK ? STATUS_OK : STATUS_TimeOut;
+}
+
+/*!
+    @brief  Start a sweep without waiting. The next transfers are started from the I2C completion callbacks, which must call ::INA234_Sweep_onTransferComplete()
+						and ::INA234_Sweep_onError() (see the README). The sweep is finished when sweep::busy is 0, and its result is in sweep::status.
+    @param  self
+            A pointer to the ::INA234_Sweep
+		@return	Ths status of starting
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut if the sweep or the bus is busy, an item is on another bus, or the first transfer could not be started
+*/
+Status INA234_Sweep_start(INA234_Sweep* self){
+	if(self->busy || self->count == 0 || HAL_I2C_GetState(self->hi2c) != HAL_I2C_STATE_READY)
+		return STATUS_TimeOut;
+	
+	for(uint16_t i=0; i<self->count; i++)
+		if(self->items[i].device->hi2c != self->hi2c)
+			return STATUS_TimeOut;
+	
+	self->index = 0;
+	self->phase = 0;
+	self->status = STATUS_OK;
+	self->start_time = __INA234_now(self->items[0].device);
+	self->sweeps++;
+	self->busy = 1;
+	
+	if(STATUS_OK != __INA234_Sweep_transfer(self)){
+		self->errors++;
+		self->status = STATUS_TimeOut;
+		self->busy = 0;
+		return STATUS_TimeOut;
+	}
+	return STATUS_OK;
+}
+
+/*!
+    @brief  Wait for a sweep started by ::INA234_Sweep_start(). If it takes longer than ::INA234_I2C_TIMEOUT per item, the transfer is aborted.
+    @param  self
+            A pointer to the ::INA234_Sweep
+		@return	Ths status of the sweep
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut in case of timeout or failure
+*/
+Status INA234_Sweep_wait(INA234_Sweep* self){
+	uint32_t start = HAL_GetTick();
+	
+	while(self->busy){
+		if(HAL_GetTick() - start > (uint32_t)INA234_I2C_TIMEOUT * self->count){
+			self->busy = 0;
+			self->errors++;
+			self->status = STATUS_TimeOut;
+			HAL_I2C_Master_Abort_IT(self->hi2c, self->items[self->index].device->I2C_ADDR);
+			break;
+		}
+	}
+	return self->status;
+}
+
+/*!
+    @brief  Start a sweep and wait for it. See ::INA234_Sweep_start() and ::INA234_Sweep_wait().
+    @param  self
+            A pointer to the ::INA234_Sweep
+		@return	Ths status of the sweep
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut in case of timeout or failure
+*/
+Status INA234_Sweep_read(INA234_Sweep* self){
+	if(STATUS_OK != INA234_Sweep_start(self))
+		return STATUS_TimeOut;
+	return INA234_Sweep_wait(self);
+}
+
+/*!
+    @brief  Continue a sweep. Call it from HAL_I2C_MasterTxCpltCallback and HAL_I2C_MasterRxCpltCallback. It ignores the other buses and the idle sweeps.
+    @param  self
+            A pointer to the ::INA234_Sweep
+		@param  hi2c
+						The I2C handler given to the callback
+*/
+void INA234_Sweep_onTransferComplete(INA234_Sweep* self, I2C_HandleTypeDef* hi2c){
+	if(hi2c != self->hi2c || !self->busy)
+		return;
+	
+	__INA234_event(self->items[self->index].device, EVENT_SWEEP_ISR, PHASE_INSTANT, self->index);
+	if(self->phase == 0){
+		self->phase = 1;
+	}
+	else{
+		self->phase = 0;
+		self->index++;
+		if(self->index == self->count){
+			self->status = STATUS_OK;
+			self->busy = 0;
+			return;
+		}
+	}
+	
+	if(STATUS_OK != __INA234_Sweep_transfer(self)){
+		self->errors++;
+		self->status = STATUS_TimeOut;
+		self->busy = 0;
+	}
+}
+
+/*!
+    @brief  Stop a sweep after a bus error (for example a device that did not acknowledge). Call it from HAL_I2C_ErrorCallback.
+    @param  self
+            A pointer to the ::INA234_Sweep
+		@param  hi2c
+						The I2C handler given to the callback
+*/
+void INA234_Sweep_onError(INA234_Sweep* self, I2C_HandleTypeDef* hi2c){
+	if(hi2c != self->hi2c || !self->busy)
+		return;
+	
+	self->errors++;
+	self->status = STATUS_TimeOut;
+	self->busy = 0;
+}
+
+/*!
+    @brief  Get the value of one item of the last sweep
+    @param  self
+            A pointer to the ::INA234_Sweep
+		@param  index
+						Index of the item
+		@return	The raw register value
+*/
+uint16_t INA234_Sweep_getValue(const INA234_Sweep* self, uint16_t index){
+	return (uint16_t)((self->items[index].raw_data[0] << 8) | self->items[index].raw_data[1]);
+}
+
+/*!
+    @brief  Make a sample of one device from the last sweep, filled by ::INA234_Sweep_fillMeasurements(). The sample is timestamped at the start of the sweep,
+						so all of the devices should use the same clock. The conversion ready flag is not read, so the sample is counted as fresh if it was set by
+						::INA234_waitForData() or if a whole conversion period passed since the previous fresh sample. The sample is published like in ::INA234_acquire().
+    @param  self
+            A pointer to the ::INA234_Sweep
+		@param  device
+						Index of the device in the array given to ::INA234_Sweep_fillMeasurements()
+		@param  sample
+						A pointer to the ::INA234_Sample to be filled
+*/
+void INA234_Sweep_getSample(INA234_Sweep* self, uint8_t device, INA234_Sample* sample){
+	INA234_SweepItem* item = &self->items[(uint16_t)device * 4];
+	INA234* dev = item->device;
+	uint32_t period = INA234_getConversionPeriod(dev);
+	
+	sample->timestamp = self->start_time;
+	sample->adc_range = dev->adc_range;
+	sample->fresh = dev->ready_pending || dev->sequence == 0 || (period != 0 && sample->timestamp - dev->last_fresh_time >= period);
+	dev->ready_pending = 0;
+	
+	dev->reg.raw_data[0] = item[0].raw_data[1];
+	dev->reg.raw_data[1] = item[0].raw_data[0];
+	sample->shunt_voltage = dev->reg.shunt_voltage_register.VSHUNT;
+	
+	dev->reg.raw_data[0] = item[1].raw_data[1];
+	dev->reg.raw_data[1] = item[1].raw_data[0];
+	sample->bus_voltage = dev->reg.bus_voltage_register.VBUS;
+	
+	dev->reg.raw_data[0] = item[2].raw_data[1];
+	dev->reg.raw_data[1] = item[2].raw_data[0];
+	sample->power = dev->reg.power_register.POWER;
+	
+	dev->reg.raw_data[0] = item[3].raw_data[1];
+	dev->reg.raw_data[1] = item[3].raw_data[0];
+	sample->current = dev->reg.current_register.CURRENT;
+	
+	__INA234_updateSequence(dev, sample);
+	INA234_publish(dev, sample);
+}
@@ -44,6 +44,23 @@
 #include "main.h"
 #include "i2c.h"
 
+// Features: define them as 0 in the compiler flags (e.g. -DINA234_USE_FLOAT=0) to strip the parts you don't use
+#ifndef INA234_USE_FLOAT
+#define INA234_USE_FLOAT						1 // float getters and values. If 0, the shunt resistance is in micro Ohms and the alert limit in raw LSBs (integers).
+#endif
+#ifndef INA234_USE_ALERT
+#define INA234_USE_ALERT						1 // alert configuration, alert limit, alert source and reset
+#endif
+#ifndef INA234_USE_IDS
+#define INA234_USE_IDS							1 // manufacturer and device ID reads (and the ID check of INA234_probe)
+#endif
+#ifndef INA234_USE_CONFIG_GETTERS
+#define INA234_USE_CONFIG_GETTERS		1 // getters of the stored configurations
+#endif
+#ifndef INA234_USE_CACHE
+#define INA234_USE_CACHE						1 // cache of the measured registers within a conversion period (INA234_setCache)
+#endif
+
 #define MAXIMUM_EXPECTED_CURRENT	5.0
 #define CURRENT_LSB_MINIMUM				(MAXIMUM_EXPECTED_CURRENT / 2048.0)
 #define CURRENT_LSB								(CURRENT_LSB_MINIMUM * 1.0) // in A
@@ -52,6 +69,10 @@
 #define SHUNT_VOLTAGE_20_48mv_LSB	0.01  // in mV
 #define POWER_LSB									(CURRENT_LSB*0.032) // in W
 
+#define __INA234_CAL_81_92mV			((uint32_t)(81920.0 / CURRENT_LSB + 0.5)) // SHUNT_CAL times the shunt resistance in micro Ohms (integer build)
+#define __INA234_CAL_20_48mV			((uint32_t)(20480.0 / CURRENT_LSB + 0.5))
+#define __INA234_Q8(lsb)					((int32_t)((lsb) * 1000.0 * 256.0 + 0.5)) // LSB in thousandths of the unit (uV, mV, mW, mA) with 8 fractional bits
+
 #define CONFIGURATION_REGISTER	0x00
 #define SHUNT_VOLTAGE_REGISTER	0x01
 #define BUS_VOLTAGE_REGISTER		0x02
@@ -63,17 +84,100 @@
 #define MANUFACTURERID_REGISTER	0x3E
 #define DEVICEID_REGISTER				0x3F
 
+#define __INA234_PLAN_CALIBRATION	0x01
+#define __INA234_PLAN_ALERT_LIMIT	0x02
+
+#define INA234_I2C_TIMEOUT			100 // in ms
+#define INA234_SNAPSHOT_RETRIES	2
+#define INA234_WAIT_MIN_STEP		20 // in us, shortest delay between two polls of the conversion ready flag
+#define INA234_CACHE_TOLERANCE	10 // in %, tolerance of the conversion period of the chip (its internal timebase) against the MCU clock, used by the cache
+
+#define INA234_MANUFACTURER_ID	0x5449	// "TI" in ASCII
+#define INA234_DEVICE_ID				0xA08
+#define INA234_PROBE_FIRST_ADDR	0x40
+#define INA234_PROBE_LAST_ADDR	0x4F
+#define INA234_PROBE_TIMEOUT		1 // in ms
+
 typedef enum ADCRange				{RANGE_81_92mV, RANGE_20_48mV} ADCRange;
 typedef enum NumSamples			{NADC_1, NADC_4, NADC_16, NADC_64, NADC_128, NADC_256, NADC_512, NADC_1024} NumSamples;
 typedef enum ConvTime				{CTIME_140us, CTIME_204us, CTIME_332us, CTIME_588us, CTIME_1100us, CTIME_2116us, CTIME_4156us, CTIME_8244us} ConvTime;
 typedef enum Mode						{MODE_SHUTDOWN, MODE_SINGLESHOT_SUNT, MODE_SINGLESHOT_BUS, MODE_SINGLESHOT_BOTH_SHUNT_BUS, MODE_SHUTDOWN2, MODE_CONTINUOUS_SHUNT, MODE_CONTINUOUS_BUS, MODE_CONTINUOUS_BOTH_SHUNT_BUS} Mode;
-typedef enum Status					{STATUS_OK, STATUS_TimeOut} Status;
+typedef enum Status					{STATUS_OK, STATUS_TimeOut, STATUS_Torn} Status;
 typedef enum AlertOn				{ALERT_NONE, ALERT_SHUNT_OVER_LIMIT, ALERT_SHUNT_UNDER_LIMIT, ALERT_BUS_OVER_LIMIT, ALERT_BUS_UNDER_LIMIT, ALERT_POWER_OVER_LIMIT} AlertOn;
 typedef enum AlertPolarity	{ALERT_ACTIVE_LOW, ALERT_ACTIVE_HIGH} AlertPolarity;
 typedef enum AlertLatch			{ALERT_TRANSPARENT, ALERT_LATCHED} AlertLatch;
 typedef enum AlertConvReady	{ALERT_CONV_DISABLE, ALERT_CONV_ENABLE} AlertConvReady;
 typedef enum AlertSource		{ALERT_DATA_READY, ALERT_LIMIT_REACHED} AlertSource;
 typedef enum ErrorType			{ERROR_NONE, ERROR_MEMORY, ERROR_OVF, ERROR_BOTH_MEMORY_OVF} ErrorType;
+typedef enum Channel				{CHANNEL_SHUNT_VOLTAGE, CHANNEL_BUS_VOLTAGE, CHANNEL_POWER, CHANNEL_CURRENT} Channel;
+typedef enum EventType			{EVENT_ACQUIRE, EVENT_SNAPSHOT, EVENT_ACQUIRE_NEXT, EVENT_WAIT, EVENT_SLEEP, EVENT_POLL, EVENT_SNAPSHOT_RETRY, EVENT_SAMPLE,
+														 EVENT_ALERT_ISR, EVENT_ALERT_SLEEP, EVENT_SWEEP_ISR, EVENT_BUS_WAIT, EVENT_BUS_TRANSFER, EVENT_BUS_MISSED, EVENT_BUS_ISR, EVENTS} EventType;
+typedef enum EventPhase			{PHASE_BEGIN, PHASE_END, PHASE_INSTANT} EventPhase;
+
+#define INA234_CHANNELS			4
+
+#if INA234_USE_FLOAT
+typedef float			INA234_Resistance;	// in mOhm
+typedef float			INA234_Limit;				// in mV, V or W, depending on the alert
+#else
+typedef uint32_t	INA234_Resistance;	// in micro Ohm
+typedef int32_t		INA234_Limit;				// in raw LSBs of the alert limit register
+#endif
+
+/*! 
+    @brief  Monotonic clock used to timestamp the samples. It must return the time in microseconds and may wrap around at 2^32.
+*/
+typedef uint32_t (*INA234_Clock)(void);
+
+/*! 
+    @brief  Function that blocks (or yields to other tasks) for the given time in microseconds
+*/
+typedef void (*INA234_Sleep)(uint32_t time);
+
+/*! 
+    @brief  Function that puts the MCU in a low power mode until an interrupt (for example HAL_PWR_EnterSLEEPMode or HAL_PWR_EnterSTOPMode with WFI)
+*/
+typedef void (*INA234_Idle)(void);
+
+/*! 
+    @brief  Function that replaces the blocking HAL register reads and writes, for example to go through a shared bus queue (see ::INA234_Bus_attach in ina234_bus.h)
+						or a trace (see ::INA234_Trace_attach in ina234_trace.h). A write with Size 0 only sends MemAddress: the general call reset of ::INA234_SoftResetAll() is sent to DevAddress 0.
+*/
+typedef Status (*INA234_Transfer)(void* context, uint16_t DevAddress, uint8_t MemAddress, uint8_t* pData, uint16_t Size, uint8_t write);
+
+/*! 
+    @brief  Function called at the steps of the driver (see ::INA234_setEventHook), for example to record a timeline (see ::INA234_Trace_event in ina234_trace.h).
+						The argument is the status at the ::PHASE_END of the acquisitions, the conversion ready flag of the polls, the freshness of the samples,
+						the priority of the bus waits, the operation of the bus transfers and the item index of the sweep interrupts. It may be called from the interrupts.
+*/
+typedef void (*INA234_EventHook)(void* context, uint16_t DevAddress, EventType event, EventPhase phase, uint16_t argument);
+
+/*! 
+    @brief  Decoded content of the mask/enable register, read once after an alert
+*/
+typedef struct ina234_alert_event{
+	
+	uint8_t		data_ready;				/*!< A conversion is ready (CVRF) */
+	uint8_t		limit_reached;		/*!< The alert limit was reached (AFF) */
+	ErrorType	errors;						/*!< Memory and math overflow errors */
+	
+} INA234_AlertEvent;
+
+/*! 
+    @brief  One acquired sample: the raw measured values plus the time and conversion information
+*/
+typedef struct ina234_sample{
+	
+	uint32_t	timestamp;				/*!< Acquisition time (in us) from the clock given to ::INA234_setClock */
+	uint32_t	sequence;					/*!< Estimated number of the conversion this sample belongs to. Equal to the previous sample if no new conversion was done. */
+	int16_t		shunt_voltage;		/*!< Raw shunt voltage (in LSBs of the range below) */
+	uint16_t	bus_voltage;			/*!< Raw bus voltage (in ::BUS_VOLTAGE_LSB) */
+	uint16_t	power;						/*!< Raw power (in ::POWER_LSB) */
+	int16_t		current;					/*!< Raw current (in ::CURRENT_LSB) */
+	uint8_t		adc_range;				/*!< ::ADCRange that was active when the sample was acquired */
+	uint8_t		fresh;						/*!< 1 if a new conversion was completed since the previous sample, 0 if the sample is a duplicate */
+	
+} INA234_Sample;
 
 /*! 
     @brief  Class (struct) that stores variables for interacting with INA234
@@ -89,20 +193,43 @@ typedef struct ina234{
 	ConvTime		vbus_conversion_time;
 	ConvTime		vshunt_conversion_time;
 	Mode				mode;
-	float				ShuntResistor;
+	INA234_Resistance	ShuntResistor;
 	
+#if INA234_USE_ALERT
 	// Alert Configs
 	AlertOn					alert_on;
 	AlertPolarity		alert_polarity;
 	AlertLatch			alert_latch;
 	AlertConvReady	alert_conv_ready;
-	float						alert_limit;
+	INA234_Limit		alert_limit;
 	int32_t 				alert_limit_int;
+	
+	// Sleep until alert (INA234_sleepUntilAlert)
+	volatile uint8_t	alert_pending;	/*!< Set by INA234_alertISR */
+	uint32_t				wake_time;
+	uint32_t				wakeups;						/*!< Number of the returns of ::INA234_sleepUntilAlert(), by an alert or by the timeout */
+	uint32_t				spurious_wakeups;		/*!< Number of wake ups by other interrupts */
+	uint32_t				awake_last;					/*!< MCU awake time (in us) of the previous wake up: from the wake up to the next sleep */
+	uint32_t				awake_total;				/*!< Sum of the awake times (in us) */
+	uint32_t				asleep_total;				/*!< Sum of the sleep times (in us), only valid if the clock runs in the low power mode */
+#endif
+	
+	// Conversion plan, recalculated by __INA234_updatePlan only when adc_range, ShuntResistor or alert configs change
+	struct _plan{
+#if INA234_USE_FLOAT
+		float			shunt_voltage_lsb;	// in mV
+		float			bus_voltage_lsb;		// in V
+		float			current_lsb;				// in A
+		float			power_lsb;					// in W
+#endif
+		uint16_t	shunt_cal;
+	} plan;
 
-	float				ShuntVoltage;
-	float				BusVoltage;
-	float				Power;
-	float				Current;
+#if INA234_USE_FLOAT
+	// Values of the last published sample, converted by INA234_getValue on the first access
+	float				value[INA234_CHANNELS];		/*!< Indexed by ::Channel, in the units of the float getters */
+	uint8_t			converted;								/*!< Bit i is set if ina234#value[i] belongs to the last published sample */
+#endif
 	
 	union _reg {
 		uint8_t raw_data[2];
@@ -148,16 +275,156 @@ typedef struct ina234{
 		} devide_id_register;
 		
 	} reg;
+	
+	// Sample timing
+	INA234_Clock	clock;
+	uint32_t			sequence;
+	uint32_t			last_fresh_time;
+	uint32_t			duplicates;					/*!< Number of samples acquired before a new conversion was done */
+	uint32_t			gaps;								/*!< Number of conversions that were skipped between the acquired samples */
+	uint32_t			snapshots;					/*!< Number of calls to INA234_readSnapshot */
+	uint32_t			tears;							/*!< Number of reads in INA234_readSnapshot that were torn by a conversion and retried */
+	uint32_t			torn_snapshots;			/*!< Number of snapshots that were still torn after all of the retries */
+	
+	// Wait for data (INA234_waitForData)
+	INA234_Sleep	sleep;
+	uint32_t			next_ready;					/*!< Estimated time of the next conversion ready flag */
+	uint8_t				next_ready_valid;
+	uint8_t				ready_pending;			/*!< The conversion ready flag was read by INA234_waitForData and not yet used by a sample */
+	uint32_t			waits;							/*!< Number of calls to INA234_waitForData */
+	uint32_t			wait_polls;					/*!< Number of conversion ready flag reads done by INA234_waitForData */
+	
+#if INA234_USE_CACHE
+	// Register cache (INA234_setCache)
+	uint8_t				cache_enable;
+	uint8_t				cache_valid;				/*!< Bit i is set if the measured register i+1 is cached */
+	uint16_t			cache_value[4];			/*!< Shunt voltage, bus voltage, power and current registers (MCU byte order) */
+	uint32_t			cache_expires[4];		/*!< Time (in us) the next conversion is expected after each cached read */
+	uint8_t				cache_grid_valid;
+	uint8_t				cache_flag_valid;
+	uint8_t				cache_miss_valid;
+	uint32_t			cache_grid;					/*!< Earliest time of a conversion, measured at the configuration write or from an edge of the conversion ready flag */
+	uint32_t			cache_window;				/*!< The conversion was completed between ina234#cache_grid and ina234#cache_grid + ina234#cache_window */
+	uint32_t			cache_flag_time;		/*!< Time of the last conversion ready flag read */
+	uint32_t			cache_miss_time;
+	uint32_t			cache_syncs;				/*!< Number of the conversion timing measurements */
+	uint32_t			cache_hits;					/*!< Number of register reads served from the cache */
+	uint32_t			cache_misses;				/*!< Number of measured register reads that went to the bus while the cache was enabled */
+#endif
+	
+	// Register transfers (INA234_setTransfer)
+	INA234_Transfer	transfer;
+	void*						transfer_context;
+	
+	// Instrumentation (INA234_setEventHook)
+	INA234_EventHook	event_hook;
+	void*						event_context;
+	
+	// Published sample (INA234_publish / INA234_getPublished)
+	volatile uint32_t	published_seq;
+	INA234_Sample			published[2];
+	
+	// Non-blocking init (INA234_initMany)
+	uint8_t			init_step;
+	uint8_t			init_steps;
+	uint8_t			init_busy;
+	uint32_t		init_tick;
 
 } INA234;
 
-Status INA234_init(INA234* self, uint8_t I2C_ADDR, I2C_HandleTypeDef* hi2c, float ShuntResistor, ADCRange adc_range, NumSamples numer_of_adc_samples, ConvTime vbus_conversion_time, ConvTime vshunt_conversion_time, Mode mode);
-Status INA234_alert_init(INA234* self, AlertOn alert_on, AlertPolarity alert_polarity, AlertLatch alert_latch, AlertConvReady alert_conv_ready, float alert_limit);
+/*! 
+    @brief  Configurations of one INA234 for ::INA234_initMany
+*/
+typedef struct ina234_config{
+	
+	I2C_HandleTypeDef*	hi2c;										/*!< Specifies the I2C handler. */
+	uint8_t 						I2C_ADDR;								/*!< 7bit I2C address, same as the I2C_ADDR argument of ::INA234_init */
+	
+	// Main configs
+	INA234_Resistance	ShuntResistor;
+	ADCRange		adc_range;
+	NumSamples	number_of_adc_samples;
+	ConvTime		vbus_conversion_time;
+	ConvTime		vshunt_conversion_time;
+	Mode				mode;
+	
+#if INA234_USE_ALERT
+	// Alert Configs
+	uint8_t					alert_enable;						/*!< Set to 0 to skip writing the alert registers */
+	AlertOn					alert_on;
+	AlertPolarity		alert_polarity;
+	AlertLatch			alert_latch;
+	AlertConvReady	alert_conv_ready;
+	INA234_Limit		alert_limit;
+#endif
+	
+} INA234_Config;
+
+/*! 
+    @brief  One register read of a chained read (::INA234_Sweep)
+*/
+typedef struct ina234_sweep_item{
+	
+	INA234*		device;
+	uint8_t		MemAddress;							/*!< Register to read. It is also the buffer of the register pointer write. */
+	uint8_t		raw_data[2];						/*!< Register value as received (big endian), written by the I2C interrupt or DMA */
+	
+} INA234_SweepItem;
+
+/*! 
+    @brief  Class (struct) of a chained read of many registers of many INA234s on one bus, using the sequential transfers of the HAL (see ::INA234_Sweep_start)
+*/
+typedef struct ina234_sweep{
+	
+	I2C_HandleTypeDef*	hi2c;
+	INA234_SweepItem*		items;
+	uint16_t						count;
+	uint8_t							use_dma;				/*!< 1 to use the DMA sequential transfers, 0 for the interrupt ones */
+	
+	volatile uint16_t		index;					/*!< Item being transferred */
+	volatile uint8_t		phase;					/*!< 0 while writing the register pointer of the item, 1 while reading its value */
+	volatile uint8_t		busy;
+	volatile Status			status;					/*!< Status of the last sweep, valid when sweep::busy is 0 */
+	uint32_t						start_time;			/*!< Start time (in us) of the last sweep */
+	
+	uint32_t						sweeps;
+	uint32_t						transfers;			/*!< Number of sequential transfers, one completion interrupt each */
+	uint32_t						errors;
+	
+} INA234_Sweep;
+
+Status INA234_init(INA234* self, uint8_t I2C_ADDR, I2C_HandleTypeDef* hi2c, INA234_Resistance ShuntResistor, ADCRange adc_range, NumSamples numer_of_adc_samples, ConvTime vbus_conversion_time, ConvTime vshunt_conversion_time, Mode mode);
+#if INA234_USE_ALERT
+Status INA234_alert_init(INA234* self, AlertOn alert_on, AlertPolarity alert_polarity, AlertLatch alert_latch, AlertConvReady alert_conv_ready, INA234_Limit alert_limit);
+#endif
+Status INA234_initMany(INA234* devices, const INA234_Config* configs, Status* status, uint8_t count);
+uint8_t INA234_probe(I2C_HandleTypeDef* hi2c, INA234* devices, uint8_t max_devices);
 
 // Privates ----------------------------------
 
 Status __INA234_readTwoBytes(INA234* self, uint8_t MemAddress);
 Status __INA234_writeTwoBytes(INA234* self, uint8_t MemAddress);
+void __INA234_buildRegister(INA234* self, uint8_t MemAddress);
+uint8_t __INA234_updatePlan(INA234* self);
+Status __INA234_writePlan(INA234* self, uint8_t changed);
+void __INA234_swapBytes(INA234* self);
+void __INA234_resetCounters(INA234* self);
+uint32_t __INA234_now(INA234* self);
+void __INA234_sleep(INA234* self, uint32_t time);
+void __INA234_event(INA234* self, EventType event, EventPhase phase, uint16_t argument);
+Status __INA234_readMeasurements(INA234* self, INA234_Sample* sample);
+void __INA234_updateSequence(INA234* self, INA234_Sample* sample);
+ErrorType __INA234_decodeErrors(INA234* self);
+#if INA234_USE_CACHE
+uint32_t __INA234_cacheExpiry(INA234* self, uint32_t start, uint32_t now);
+uint8_t __INA234_cacheLookup(INA234* self, uint8_t MemAddress);
+void __INA234_cacheStore(INA234* self, uint8_t MemAddress, uint32_t start);
+#endif
+Status __INA234_acquire(INA234* self, INA234_Sample* sample);
+Status __INA234_readSnapshot(INA234* self, INA234_Sample* sample);
+Status __INA234_waitForData(INA234* self, uint32_t timeout);
+Status __INA234_acquireNext(INA234* self, INA234_Sample* sample, uint32_t timeout);
+Status __INA234_Sweep_transfer(INA234_Sweep* self);
 
 // Configurations ----------------------------
 
@@ -166,28 +433,75 @@ Status INA234_setNumberOfADCSamples(INA234* self, NumSamples numer_of_adc_sample
 Status INA234_setVBusConversionTime(INA234* self, ConvTime vbus_conversion_time);
 Status INA234_setVShuntConversionTime(INA234* self, ConvTime vshunt_conversion_time);
 Status INA234_setMode(INA234* self, Mode mode);
+Status INA234_setShuntResistor(INA234* self, INA234_Resistance ShuntResistor);
+#if INA234_USE_ALERT
+Status INA234_setAlertLimit(INA234* self, INA234_Limit alert_limit);
+#endif
 
+#if INA234_USE_CONFIG_GETTERS
 ADCRange		INA234_getADCRange(INA234* self);
 NumSamples	INA234_getNumberOfADCSamples(INA234* self);
 ConvTime		INA234_getVBusConversionTime(INA234* self);
 ConvTime		INA234_getVShuntConversionTime(INA234* self);
 Mode 				INA234_getMode(INA234* self);
+#endif
 
 void INA234_SoftResetAll(INA234* self);
 
+void			INA234_setClock(INA234* self, INA234_Clock clock);
+void			INA234_setSleep(INA234* self, INA234_Sleep sleep);
+void			INA234_setTransfer(INA234* self, INA234_Transfer transfer, void* context);
+void			INA234_setEventHook(INA234* self, INA234_EventHook event_hook, void* context);
+#if INA234_USE_CACHE
+void			INA234_setCache(INA234* self, uint8_t enable);
+void			INA234_forceRefresh(INA234* self);
+#endif
+uint32_t	INA234_getConversionPeriod(INA234* self);
+
 // Getting Data ------------------------------
 
+#if INA234_USE_IDS
 uint16_t	INA234_getManID(INA234* self);
 uint16_t	INA234_getDevID(INA234* self);
+#endif
 void			INA234_readAll(INA234* self);
+Status		INA234_acquire(INA234* self, INA234_Sample* sample);
+Status		INA234_readSnapshot(INA234* self, INA234_Sample* sample);
+Status		INA234_waitForData(INA234* self, uint32_t timeout);
+Status		INA234_acquireNext(INA234* self, INA234_Sample* sample, uint32_t timeout);
+void			INA234_publish(INA234* self, const INA234_Sample* sample);
+uint8_t		INA234_getPublished(INA234* self, INA234_Sample* sample);
+int32_t		INA234_Sample_getFixedQ8(const INA234_Sample* sample, Channel channel);
+int32_t		INA234_Sample_getFixed(const INA234_Sample* sample, Channel channel);
+#if INA234_USE_FLOAT
+float			INA234_Sample_getFloat(const INA234_Sample* sample, Channel channel);
+float			INA234_getValue(INA234* self, Channel channel);
 float			INA234_getCurrent(INA234* self);
 float			INA234_getBusVoltage(INA234* self);
 float			INA234_getShuntVoltage(INA234* self);
 float			INA234_getPower(INA234* self);
+#endif
 
 uint8_t			INA234_isDataReady(INA234* self);
-AlertSource	INA234_getAlertSource(INA234* self);
 ErrorType		INA234_getErrors(INA234* self);
+#if INA234_USE_ALERT
+AlertSource	INA234_getAlertSource(INA234* self);
 Status			INA234_resetAlert(INA234* self);
+Status			INA234_armAlert(INA234* self, AlertConvReady alert_conv_ready);
+void				INA234_alertISR(INA234* self);
+Status			INA234_sleepUntilAlert(INA234* self, INA234_Idle idle, uint32_t timeout, INA234_AlertEvent* event);
+#endif
+
+// Chained Reads -----------------------------
+
+void			INA234_Sweep_init(INA234_Sweep* self, I2C_HandleTypeDef* hi2c, INA234_SweepItem* items, uint16_t count, uint8_t use_dma);
+uint16_t	INA234_Sweep_fillMeasurements(INA234_SweepItem* items, INA234* devices, uint8_t count);
+Status		INA234_Sweep_start(INA234_Sweep* self);
+Status		INA234_Sweep_wait(INA234_Sweep* self);
+Status		INA234_Sweep_read(INA234_Sweep* self);
+void			INA234_Sweep_onTransferComplete(INA234_Sweep* self, I2C_HandleTypeDef* hi2c);
+void			INA234_Sweep_onError(INA234_Sweep* self, I2C_HandleTypeDef* hi2c);
+uint16_t	INA234_Sweep_getValue(const INA234_Sweep* self, uint16_t index);
+void			INA234_Sweep_getSample(INA234_Sweep* self, uint8_t device, INA234_Sample* sample);
 
 #endif
@@ -0,0 +1,428 @@
+/*!
+ * @file ina234_bus.c
+ *
+ * Optional queue of I2C transactions with priorities and deadlines (see ina234_bus.h).
+ *
+ */
+
+#include "ina234_bus.h"
+
+
+// Privates
+/*!
+    @brief  Get the current time from the clock of the bus
+*/
+static uint32_t __INA234_Bus_now(INA234_Bus* self){
+	return self->clock ? self->clock() : HAL_GetTick() * 1000;
+}
+
+/*!
+    @brief  Report an event of a transaction to the hook given to ::INA234_Bus_setEventHook(), if any
+*/
+static void __INA234_Bus_event(INA234_Bus* self, INA234_BusTransaction* t, EventType event, EventPhase phase, uint16_t argument){
+	if(self->event_hook)
+		self->event_hook(self->event_context, t->DevAddress, event, phase, argument);
+}
+
+/*!
+    @brief  Mark a transaction as done and call its callback
+*/
+static void __INA234_Bus_finish(INA234_BusTransaction* transaction, Status status){
+	transaction->status = status;
+	transaction->state = TRANSACTION_DONE;
+	if(transaction->done)
+		transaction->done(transaction->context, transaction);
+}
+
+/*!
+    @brief  Start the HAL transfer of a transaction in interrupt or DMA mode
+*/
+static HAL_StatusTypeDef __INA234_Bus_start(INA234_Bus* self, INA234_BusTransaction* t){
+	switch (t->operation) {
+		case BUS_MEM_READ:
+			return self->use_dma ? HAL_I2C_Mem_Read_DMA(self->hi2c, t->DevAddress, t->MemAddress, t->MemAddSize, t->pData, t->Size)
+													 : HAL_I2C_Mem_Read_IT(self->hi2c, t->DevAddress, t->MemAddress, t->MemAddSize, t->pData, t->Size);
+		case BUS_MEM_WRITE:
+			return self->use_dma ? HAL_I2C_Mem_Write_DMA(self->hi2c, t->DevAddress, t->MemAddress, t->MemAddSize, t->pData, t->Size)
+													 : HAL_I2C_Mem_Write_IT(self->hi2c, t->DevAddress, t->MemAddress, t->MemAddSize, t->pData, t->Size);
+		case BUS_TRANSMIT:
+			return self->use_dma ? HAL_I2C_Master_Transmit_DMA(self->hi2c, t->DevAddress, t->pData, t->Size)
+													 : HAL_I2C_Master_Transmit_IT(self->hi2c, t->DevAddress, t->pData, t->Size);
+		case BUS_RECEIVE:
+			return self->use_dma ? HAL_I2C_Master_Receive_DMA(self->hi2c, t->DevAddress, t->pData, t->Size)
+													 : HAL_I2C_Master_Receive_IT(self->hi2c, t->DevAddress, t->pData, t->Size);
+	}
+	return HAL_ERROR;
+}
+
+/*!
+    @brief  Record the wait time of a transaction that is being started
+*/
+static void __INA234_Bus_record(INA234_BusStats* stats, uint32_t wait){
+	uint8_t bin = 0;
+	
+	while(bin < INA234_BUS_HISTOGRAM_BINS - 1 && (wait >> bin) != 0)
+		bin++;
+	
+	stats->transactions++;
+	stats->wait_last = wait;
+	if(wait > stats->wait_max)
+		stats->wait_max = wait;
+	stats->wait_total += wait;
+	stats->histogram[bin]++;
+}
+
+/*!
+    @brief  If the bus is free, start the first queued transaction. The transactions whose deadline has passed are dropped.
+*/
+static void __INA234_Bus_startNext(INA234_Bus* self){
+	while(1){
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		
+		INA234_BusTransaction* t = self->queue;
+		if(self->current || !t){
+			__set_PRIMASK(primask);
+			return;
+		}
+		self->queue = t->next;
+		self->current = t;
+		t->state = TRANSACTION_RUNNING;
+		
+		__set_PRIMASK(primask);
+		
+		INA234_BusStats* stats = &self->stats[t->priority];
+		t->start_time = __INA234_Bus_now(self);
+		
+		__INA234_Bus_event(self, t, EVENT_BUS_WAIT, PHASE_END, t->priority);
+		if(t->deadline && t->start_time - t->submit_time > t->deadline){
+			stats->missed++;
+			self->current = NULL;
+			__INA234_Bus_event(self, t, EVENT_BUS_MISSED, PHASE_INSTANT, t->priority);
+			__INA234_Bus_finish(t, STATUS_TimeOut);
+			continue;
+		}
+		
+		__INA234_Bus_record(stats, t->start_time - t->submit_time);
+		__INA234_Bus_event(self, t, EVENT_BUS_TRANSFER, PHASE_BEGIN, t->operation);
+		
+		if(HAL_OK != __INA234_Bus_start(self, t)){
+			stats->errors++;
+			if(self->current == t){
+				self->current = NULL;
+				__INA234_Bus_event(self, t, EVENT_BUS_TRANSFER, PHASE_END, STATUS_TimeOut);
+				__INA234_Bus_finish(t, STATUS_TimeOut);
+			}
+			continue;
+		}
+		return;
+	}
+}
+
+/*!
+    @brief  Finish the running transaction from the I2C callbacks and start the next one
+*/
+static void __INA234_Bus_complete(INA234_Bus* self, I2C_HandleTypeDef* hi2c, Status status){
+	INA234_BusTransaction* t = self->current;
+	
+	if(hi2c != self->hi2c || !t)
+		return;
+	
+	__INA234_Bus_event(self, t, EVENT_BUS_ISR, PHASE_INSTANT, status);
+	if(status != STATUS_OK)
+		self->stats[t->priority].errors++;
+	self->current = NULL;
+	__INA234_Bus_event(self, t, EVENT_BUS_TRANSFER, PHASE_END, status);
+	__INA234_Bus_finish(t, status);
+	__INA234_Bus_startNext(self);
+}
+
+/*!
+    @brief  Remove a transaction that timed out, from the queue or from the bus
+*/
+static void __INA234_Bus_cancel(INA234_Bus* self, INA234_BusTransaction* transaction){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	
+	if(transaction->state == TRANSACTION_QUEUED){
+		INA234_BusTransaction** link = &self->queue;
+		while(*link && *link != transaction)
+			link = &(*link)->next;
+		if(*link)
+			*link = transaction->next;
+	}
+	else if(transaction->state == TRANSACTION_RUNNING && self->current == transaction){
+		// HAL_I2C_Master_Abort_IT rejects the memory transfers, so reset the peripheral instead. It stops the transfer (and its DMA)
+		// without a callback, so the buffer of the transaction is released and the next transaction finds the peripheral ready.
+		self->current = NULL;
+		HAL_I2C_DeInit(self->hi2c);
+		HAL_I2C_Init(self->hi2c);
+	}
+	else{
+		__set_PRIMASK(primask);
+		return;
+	}
+	if(transaction->state == TRANSACTION_QUEUED)
+		__INA234_Bus_event(self, transaction, EVENT_BUS_WAIT, PHASE_END, transaction->priority);
+	else
+		__INA234_Bus_event(self, transaction, EVENT_BUS_TRANSFER, PHASE_END, STATUS_TimeOut);
+	transaction->state = TRANSACTION_DONE;
+	transaction->status = STATUS_TimeOut;
+	self->stats[transaction->priority].errors++;
+	
+	__set_PRIMASK(primask);
+	
+	if(transaction->done)
+		transaction->done(transaction->context, transaction);
+	__INA234_Bus_startNext(self);
+}
+
+/*!
+    @brief  The ::INA234_Transfer of the INA234s attached by ::INA234_Bus_attach()
+*/
+static Status __INA234_Bus_transferRegister(void* context, uint16_t DevAddress, uint8_t MemAddress, uint8_t* pData, uint16_t Size, uint8_t write){
+	INA234_BusClient* client = (INA234_BusClient*)context;
+	
+	// Only the register address (the general call reset of INA234_SoftResetAll)
+	if(write && Size == 0){
+		INA234_BusTransaction t = {BUS_TRANSMIT, client->priority, client->deadline, DevAddress, 0, I2C_MEMADD_SIZE_8BIT, &MemAddress, 1, NULL, NULL, TRANSACTION_IDLE, STATUS_OK, 0, 0, NULL};
+		return INA234_Bus_transfer(client->bus, &t);
+	}
+	
+	if(write)
+		return INA234_BusClient_memWrite(client, DevAddress, MemAddress, I2C_MEMADD_SIZE_8BIT, pData, Size);
+	else
+		return INA234_BusClient_memRead(client, DevAddress, MemAddress, I2C_MEMADD_SIZE_8BIT, pData, Size);
+}
+
+// Bus
+/*!
+    @brief  Initialize the transaction queue of an I2C bus. The I2C event and error interrupts (and the DMA streams if use_dma is 1) must be enabled in CubeMX,
+						and the I2C callbacks must call ::INA234_Bus_onComplete() and ::INA234_Bus_onError().
+    @param  self
+            A pointer to the bus object (struct)
+		@param  hi2c
+						The I2C handler of the bus
+		@param  clock
+						A function returning the time in microseconds, or NULL to use HAL_GetTick() (1ms resolution)
+		@param  use_dma
+						1 to use the DMA transfers, 0 for the interrupt ones
+*/
+void INA234_Bus_init(INA234_Bus* self, I2C_HandleTypeDef* hi2c, INA234_Clock clock, uint8_t use_dma){
+	self->hi2c = hi2c;
+	self->clock = clock;
+	self->idle = NULL;
+	self->use_dma = use_dma;
+	self->queue = NULL;
+	self->current = NULL;
+	self->event_hook = NULL;
+	self->event_context = NULL;
+	INA234_Bus_resetStats(self);
+}
+
+/*!
+    @brief  Reset the wait time statistics of all of the priorities
+    @param  self
+            A pointer to the bus object (struct)
+*/
+void INA234_Bus_resetStats(INA234_Bus* self){
+	for(uint8_t p=0; p<INA234_BUS_PRIORITIES; p++){
+		INA234_BusStats* stats = &self->stats[p];
+		stats->transactions = 0;
+		stats->missed = 0;
+		stats->errors = 0;
+		stats->wait_last = 0;
+		stats->wait_max = 0;
+		stats->wait_total = 0;
+		for(uint8_t i=0; i<INA234_BUS_HISTOGRAM_BINS; i++)
+			stats->histogram[i] = 0;
+	}
+}
+
+/*!
+    @brief  Queue a transaction without waiting. It is started right away if the bus is free. It can be called from the tasks and the ISRs.
+    @param  self
+            A pointer to the bus object (struct)
+		@param  transaction
+						The transaction. It must stay valid until ina234_bus_transaction::state is ::TRANSACTION_DONE.
+		@return	Ths status of queuing
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut if the transaction is already queued or running, or its priority is invalid
+*/
+Status INA234_Bus_submit(INA234_Bus* self, INA234_BusTransaction* transaction){
+	if(transaction->priority >= INA234_BUS_PRIORITIES || transaction->state == TRANSACTION_QUEUED || transaction->state == TRANSACTION_RUNNING)
+		return STATUS_TimeOut;
+	
+	transaction->submit_time = __INA234_Bus_now(self);
+	transaction->status = STATUS_OK;
+	__INA234_Bus_event(self, transaction, EVENT_BUS_WAIT, PHASE_BEGIN, transaction->priority);
+	
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	
+	// After the higher priorities, the earlier deadlines, and the earlier submissions
+	INA234_BusTransaction** link = &self->queue;
+	while(*link){
+		INA234_BusTransaction* q = *link;
+		if(q->priority > transaction->priority)
+			break;
+		if(q->priority == transaction->priority && transaction->deadline){
+			if(!q->deadline)
+				break;
+			if((int32_t)((q->submit_time + q->deadline) - (transaction->submit_time + transaction->deadline)) > 0)
+				break;
+		}
+		link = &q->next;
+	}
+	transaction->next = *link;
+	*link = transaction;
+	transaction->state = TRANSACTION_QUEUED;
+	
+	__set_PRIMASK(primask);
+	
+	__INA234_Bus_startNext(self);
+	return STATUS_OK;
+}
+
+/*!
+    @brief  Queue a transaction and wait until it is done. If it is not done in ::INA234_I2C_TIMEOUT, it is removed from the queue (or, if it is running,
+						the peripheral is reset with HAL_I2C_DeInit and HAL_I2C_Init).
+						Do not call it from an ISR.
+    @param  self
+            A pointer to the bus object (struct)
+		@param  transaction
+						The transaction
+		@return	Ths status of the transaction
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut in case of a bus error, a timeout or a missed deadline
+*/
+Status INA234_Bus_transfer(INA234_Bus* self, INA234_BusTransaction* transaction){
+	uint32_t start = HAL_GetTick();
+	
+	if(STATUS_OK != INA234_Bus_submit(self, transaction))
+		return STATUS_TimeOut;
+	
+	while(transaction->state != TRANSACTION_DONE){
+		if(HAL_GetTick() - start > INA234_I2C_TIMEOUT){
+			__INA234_Bus_cancel(self, transaction);
+			break;
+		}
+		if(self->idle)
+			self->idle();
+	}
+	return transaction->status;
+}
+
+/*!
+    @brief  Finish the running transaction and start the next one. Call it from HAL_I2C_MemRxCpltCallback, HAL_I2C_MemTxCpltCallback,
+						HAL_I2C_MasterRxCpltCallback and HAL_I2C_MasterTxCpltCallback. It ignores the other buses.
+    @param  self
+            A pointer to the bus object (struct)
+		@param  hi2c
+						The I2C handler given to the callback
+*/
+void INA234_Bus_onComplete(INA234_Bus* self, I2C_HandleTypeDef* hi2c){
+	__INA234_Bus_complete(self, hi2c, STATUS_OK);
+}
+
+/*!
+    @brief  Fail the running transaction and start the next one. Call it from HAL_I2C_ErrorCallback.
+    @param  self
+            A pointer to the bus object (struct)
+		@param  hi2c
+						The I2C handler given to the callback
+*/
+void INA234_Bus_onError(INA234_Bus* self, I2C_HandleTypeDef* hi2c){
+	__INA234_Bus_complete(self, hi2c, STATUS_TimeOut);
+}
+
+/*!
+    @brief  Estimate a percentile of the wait times of one priority from its histogram
+    @param  stats
+            A pointer to the ina234_bus::stats of the priority
+		@param  percent
+						The percentile (0 to 100)
+		@return	The upper bound (in us) of the histogram bin of the percentile, or ina234_bus_stats::wait_max for the last bin
+*/
+uint32_t INA234_Bus_getWaitPercentile(const INA234_BusStats* stats, uint8_t percent){
+	uint32_t target = (uint32_t)(((uint64_t)stats->transactions * percent + 99) / 100);
+	uint32_t count = 0;
+	
+	for(uint8_t i=0; i<INA234_BUS_HISTOGRAM_BINS - 1; i++){
+		count += stats->histogram[i];
+		if(count >= target)
+			return i == 0 ? 0 : ((uint32_t)1 << i) - 1;
+	}
+	return stats->wait_max;
+}
+
+/*!
+    @brief  Set a function called when a transaction is queued (::EVENT_BUS_WAIT begin, with its priority), started (::EVENT_BUS_WAIT end and ::EVENT_BUS_TRANSFER begin,
+						with its ::BusOperation), dropped after its deadline (::EVENT_BUS_MISSED) and done (::EVENT_BUS_TRANSFER end, with its status), and at the I2C callbacks
+						(::EVENT_BUS_ISR). For example ::INA234_Trace_event() puts them on the timeline of a trace. It is called from the interrupts, so it must be short.
+    @param  self
+            A pointer to the bus object (struct)
+		@param  event_hook
+						The function, or NULL to stop reporting
+		@param  context
+						Passed to the function as its first argument
+*/
+void INA234_Bus_setEventHook(INA234_Bus* self, INA234_EventHook event_hook, void* context){
+	self->event_hook = event_hook;
+	self->event_context = context;
+}
+
+// Clients
+/*!
+    @brief  Initialize a user of a bus
+    @param  self
+            A pointer to the client object (struct)
+		@param  bus
+						The bus
+		@param  priority
+						One of the ::BusPriority values for all of the transactions of the client
+		@param  deadline
+						Relative deadline (in us) of the transactions, 0 for none
+*/
+void INA234_BusClient_init(INA234_BusClient* self, INA234_Bus* bus, BusPriority priority, uint32_t deadline){
+	self->bus = bus;
+	self->priority = priority;
+	self->deadline = deadline;
+}
+
+/*!
+    @brief  Blocking memory read through the bus queue, like HAL_I2C_Mem_Read
+    @param  self
+            A pointer to the client object (struct)
+		@return	Ths status of reading
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut in case of a bus error, a timeout or a missed deadline
+*/
+Status INA234_BusClient_memRead(INA234_BusClient* self, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size){
+	INA234_BusTransaction t = {BUS_MEM_READ, self->priority, self->deadline, DevAddress, MemAddress, MemAddSize, pData, Size, NULL, NULL, TRANSACTION_IDLE, STATUS_OK, 0, 0, NULL};
+	return INA234_Bus_transfer(self->bus, &t);
+}
+
+/*!
+    @brief  Blocking memory write through the bus queue, like HAL_I2C_Mem_Write
+    @param  self
+            A pointer to the client object (struct)
+		@return	Ths status of writing
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut in case of a bus error, a timeout or a missed deadline
+*/
+Status INA234_BusClient_memWrite(INA234_BusClient* self, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size){
+	INA234_BusTransaction t = {BUS_MEM_WRITE, self->priority, self->deadline, DevAddress, MemAddress, MemAddSize, pData, Size, NULL, NULL, TRANSACTION_IDLE, STATUS_OK, 0, 0, NULL};
+	return INA234_Bus_transfer(self->bus, &t);
+}
+
+/*!
+    @brief  Route the register reads and writes of an INA234 through a bus queue with the priority and deadline of a client. Call it after ::INA234_init().
+    @param  ina234
+            A pointer to the ina234 object (struct)
+		@param  client
+						The client. It must stay valid while it is attached.
+*/
+void INA234_Bus_attach(INA234* ina234, INA234_BusClient* client){
+	INA234_setTransfer(ina234, __INA234_Bus_transferRegister, client);
+}
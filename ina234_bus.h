@@ -0,0 +1,114 @@
+/*!
+ * @file ina234_bus.h
+ *
+ * Optional queue of I2C transactions with priorities and deadlines, for buses shared by the INA234 library (see ina234.h) and other drivers.
+ * The transactions run in interrupt or DMA mode one after another. When the bus gets free, the queued transaction with the highest priority
+ * (and then the earliest deadline) is started, so a monitoring read waits for at most one running transaction of the other drivers.
+ * A transaction whose deadline passed before it could start is dropped. The wait times are recorded per priority.
+ *
+ */
+
+#ifndef __INA234_BUS_H_
+#define __INA234_BUS_H_
+
+#include "ina234.h"
+
+#define INA234_BUS_PRIORITIES			4
+#define INA234_BUS_HISTOGRAM_BINS	16
+
+typedef enum BusPriority				{BUS_PRIORITY_CRITICAL, BUS_PRIORITY_HIGH, BUS_PRIORITY_NORMAL, BUS_PRIORITY_LOW} BusPriority;
+typedef enum BusOperation				{BUS_MEM_READ, BUS_MEM_WRITE, BUS_TRANSMIT, BUS_RECEIVE} BusOperation;
+typedef enum BusTransactionState	{TRANSACTION_IDLE, TRANSACTION_QUEUED, TRANSACTION_RUNNING, TRANSACTION_DONE} BusTransactionState;
+
+struct ina234_bus_transaction;
+
+typedef void (*INA234_BusDone)(void* context, struct ina234_bus_transaction* transaction);
+
+/*!
+    @brief  One I2C transaction. It must stay valid until it is done.
+*/
+typedef struct ina234_bus_transaction{
+	
+	BusOperation			operation;
+	BusPriority				priority;
+	uint32_t					deadline;					/*!< Relative deadline (in us) from the submission, 0 for none */
+	
+	uint16_t					DevAddress;
+	uint16_t					MemAddress;				/*!< Only for ::BUS_MEM_READ and ::BUS_MEM_WRITE */
+	uint16_t					MemAddSize;				/*!< I2C_MEMADD_SIZE_8BIT or I2C_MEMADD_SIZE_16BIT */
+	uint8_t*					pData;
+	uint16_t					Size;
+	
+	INA234_BusDone		done;							/*!< Called (maybe from the I2C interrupt) when the transaction is done. Can be NULL. */
+	void*							context;
+	
+	volatile BusTransactionState	state;
+	volatile Status		status;						/*!< ::STATUS_OK, or ::STATUS_TimeOut after a bus error, a timeout or a missed deadline */
+	uint32_t					submit_time;
+	uint32_t					start_time;
+	
+	struct ina234_bus_transaction* next;
+	
+} INA234_BusTransaction;
+
+/*!
+    @brief  Wait time statistics of one priority
+*/
+typedef struct ina234_bus_stats{
+	
+	uint32_t	transactions;										/*!< Number of the started transactions */
+	uint32_t	missed;													/*!< Number of the transactions dropped because their deadline passed before they could start */
+	uint32_t	errors;													/*!< Number of the bus errors and timeouts */
+	uint32_t	wait_last;											/*!< Time (in us) from the submission to the start of the last transaction */
+	uint32_t	wait_max;
+	uint64_t	wait_total;
+	uint32_t	histogram[INA234_BUS_HISTOGRAM_BINS];	/*!< Bin 0 counts the waits below 1us, bin i the waits from 2^(i-1) to 2^i - 1 us, and the last bin all of the longer ones */
+	
+} INA234_BusStats;
+
+/*!
+    @brief  Class (struct) of the transaction queue of one I2C bus
+*/
+typedef struct ina234_bus{
+	
+	I2C_HandleTypeDef*	hi2c;
+	INA234_Clock				clock;						/*!< Microsecond clock of the wait times and deadlines. If it is NULL, HAL_GetTick() is used. */
+	INA234_Idle					idle;							/*!< Called while a blocking transfer waits (for example a yield of an RTOS). Can be NULL. */
+	uint8_t							use_dma;					/*!< 1 to use the DMA transfers, 0 for the interrupt ones */
+	
+	INA234_BusTransaction*	queue;				/*!< Sorted by the priority, then the deadline, then the submission */
+	INA234_BusTransaction* volatile current;
+	
+	INA234_BusStats			stats[INA234_BUS_PRIORITIES];
+	
+	INA234_EventHook		event_hook;				/*!< Called at the submissions, starts and ends of the transactions (see ::INA234_Bus_setEventHook). Can be NULL. */
+	void*								event_context;
+	
+} INA234_Bus;
+
+/*!
+    @brief  A user of a bus with its priority and deadline, for example one INA234 (see ::INA234_Bus_attach) or another driver
+*/
+typedef struct ina234_bus_client{
+	
+	INA234_Bus*		bus;
+	BusPriority		priority;
+	uint32_t			deadline;							/*!< Relative deadline (in us) of the transactions, 0 for none */
+	
+} INA234_BusClient;
+
+void			INA234_Bus_init(INA234_Bus* self, I2C_HandleTypeDef* hi2c, INA234_Clock clock, uint8_t use_dma);
+void			INA234_Bus_resetStats(INA234_Bus* self);
+Status		INA234_Bus_submit(INA234_Bus* self, INA234_BusTransaction* transaction);
+Status		INA234_Bus_transfer(INA234_Bus* self, INA234_BusTransaction* transaction);
+void			INA234_Bus_onComplete(INA234_Bus* self, I2C_HandleTypeDef* hi2c);
+void			INA234_Bus_onError(INA234_Bus* self, I2C_HandleTypeDef* hi2c);
+uint32_t	INA234_Bus_getWaitPercentile(const INA234_BusStats* stats, uint8_t percent);
+void			INA234_Bus_setEventHook(INA234_Bus* self, INA234_EventHook event_hook, void* context);
+
+void			INA234_BusClient_init(INA234_BusClient* self, INA234_Bus* bus, BusPriority priority, uint32_t deadline);
+Status		INA234_BusClient_memRead(INA234_BusClient* self, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size);
+Status		INA234_BusClient_memWrite(INA234_BusClient* self, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size);
+void			INA234_Bus_attach(INA234* ina234, INA234_BusClient* client);
+
+#endif
@@ -0,0 +1,297 @@
+/*!
+ * @file ina234_proto.c
+ *
+ * Compact binary telemetry protocol for the INA234 library (see ina234_proto.h for the frame format).
+ *
+ */
+
+#include "ina234_proto.h"
+
+static const uint16_t __INA234_Proto_crcTable[16] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+static uint8_t __INA234_Proto_put16(uint8_t* buffer, uint16_t value){
+	buffer[0] = value & 0xFF;
+	buffer[1] = value >> 8;
+	return 2;
+}
+
+static uint8_t __INA234_Proto_put32(uint8_t* buffer, uint32_t value){
+	buffer[0] = value & 0xFF;
+	buffer[1] = (value >> 8) & 0xFF;
+	buffer[2] = (value >> 16) & 0xFF;
+	buffer[3] = value >> 24;
+	return 4;
+}
+
+static uint16_t __INA234_Proto_get16(const uint8_t* buffer){
+	return (uint16_t)(buffer[0] | (buffer[1] << 8));
+}
+
+static uint32_t __INA234_Proto_get32(const uint8_t* buffer){
+	return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+/*!
+    @brief  Calculate the CRC-16/CCITT-FALSE of a buffer, using a 16 entries (nibble) table
+    @param  data
+            A pointer to the data
+		@param  length
+						Number of bytes
+		@return	The CRC
+*/
+uint16_t INA234_Proto_crc16(const uint8_t* data, uint16_t length){
+	uint16_t crc = 0xFFFF;
+	
+	while(length--){
+		crc = (crc << 4) ^ __INA234_Proto_crcTable[(crc >> 12) ^ (*data >> 4)];
+		crc = (crc << 4) ^ __INA234_Proto_crcTable[(crc >> 12) ^ (*data & 0x0F)];
+		data++;
+	}
+	
+	return crc;
+}
+
+/*!
+    @brief  Initialize an encoder
+    @param  self
+            A pointer to the encoder object (struct)
+*/
+void INA234_Proto_initEncoder(INA234_ProtoEncoder* self){
+	self->sequence = 0;
+}
+
+/*!
+    @brief  Encode a frame into a buffer. The frame sequence number is assigned by the encoder.
+    @param  self
+            A pointer to the encoder object (struct)
+		@param  frame
+						A pointer to the frame to be encoded. ina234_proto_frame::sequence is filled by this function.
+		@param  buffer
+						A pointer to the output buffer. It must have at least ::INA234_PROTO_MAX_FRAME bytes.
+		@return	Number of the written bytes, or 0 if the frame type is unknown
+*/
+uint16_t INA234_Proto_encode(INA234_ProtoEncoder* self, INA234_ProtoFrame* frame, uint8_t* buffer){
+	uint8_t* payload = buffer + INA234_PROTO_HEADER_SIZE;
+	uint8_t length = 0;
+	
+	switch (frame->type) {
+		case PROTO_SAMPLE:
+			length += __INA234_Proto_put32(payload + length, frame->payload.sample.timestamp);
+			length += __INA234_Proto_put32(payload + length, frame->payload.sample.sequence);
+			length += __INA234_Proto_put16(payload + length, (uint16_t)frame->payload.sample.shunt_voltage);
+			length += __INA234_Proto_put16(payload + length, frame->payload.sample.bus_voltage);
+			length += __INA234_Proto_put16(payload + length, frame->payload.sample.power);
+			length += __INA234_Proto_put16(payload + length, (uint16_t)frame->payload.sample.current);
+			payload[length++] = frame->payload.sample.flags;
+			break;
+		case PROTO_STATS:
+			length += __INA234_Proto_put32(payload + length, frame->payload.stats.duplicates);
+			length += __INA234_Proto_put32(payload + length, frame->payload.stats.gaps);
+			length += __INA234_Proto_put32(payload + length, frame->payload.stats.snapshots);
+			length += __INA234_Proto_put32(payload + length, frame->payload.stats.tears);
+			length += __INA234_Proto_put32(payload + length, frame->payload.stats.torn_snapshots);
+			break;
+		case PROTO_ALERT:
+			length += __INA234_Proto_put32(payload + length, frame->payload.alert.timestamp);
+			payload[length++] = frame->payload.alert.source;
+			length += __INA234_Proto_put16(payload + length, frame->payload.alert.mask_enable);
+			break;
+		default:
+			return 0;
+	}
+	
+	frame->sequence = self->sequence++;
+	
+	buffer[0] = INA234_PROTO_SOF;
+	buffer[1] = frame->type;
+	buffer[2] = frame->device;
+	buffer[3] = frame->sequence;
+	buffer[4] = length;
+	__INA234_Proto_put16(payload + length, INA234_Proto_crc16(buffer + 1, INA234_PROTO_HEADER_SIZE - 1 + length));
+	
+	return INA234_PROTO_HEADER_SIZE + length + INA234_PROTO_CRC_SIZE;
+}
+
+/*!
+    @brief  Initialize a decoder
+    @param  self
+            A pointer to the decoder object (struct)
+*/
+void INA234_Proto_initDecoder(INA234_ProtoDecoder* self){
+	self->index = 0;
+	self->dropped = 0;
+	self->synced = 0;
+	self->next_sequence = 0;
+	self->frames = 0;
+	self->crc_errors = 0;
+	self->parse_errors = 0;
+	self->lost_frames = 0;
+}
+
+/*!
+    @brief  Parse the payload of a received frame
+    @param  frame
+            A pointer to the output frame
+		@param  buffer
+						A pointer to the received frame (starting from SOF)
+		@retval True if the payload length matches the frame type
+		@retval False otherwise
+*/
+static uint8_t __INA234_Proto_parse(INA234_ProtoFrame* frame, const uint8_t* buffer){
+	const uint8_t* payload = buffer + INA234_PROTO_HEADER_SIZE;
+	uint8_t length = buffer[4];
+	
+	frame->type = buffer[1];
+	frame->device = buffer[2];
+	frame->sequence = buffer[3];
+	
+	switch (frame->type) {
+		case PROTO_SAMPLE:
+			if(length != 17)
+				return 0;
+			frame->payload.sample.timestamp = __INA234_Proto_get32(payload);
+			frame->payload.sample.sequence = __INA234_Proto_get32(payload + 4);
+			frame->payload.sample.shunt_voltage = (int16_t)__INA234_Proto_get16(payload + 8);
+			frame->payload.sample.bus_voltage = __INA234_Proto_get16(payload + 10);
+			frame->payload.sample.power = __INA234_Proto_get16(payload + 12);
+			frame->payload.sample.current = (int16_t)__INA234_Proto_get16(payload + 14);
+			frame->payload.sample.flags = payload[16];
+			return 1;
+		case PROTO_STATS:
+			if(length != 20)
+				return 0;
+			frame->payload.stats.duplicates = __INA234_Proto_get32(payload);
+			frame->payload.stats.gaps = __INA234_Proto_get32(payload + 4);
+			frame->payload.stats.snapshots = __INA234_Proto_get32(payload + 8);
+			frame->payload.stats.tears = __INA234_Proto_get32(payload + 12);
+			frame->payload.stats.torn_snapshots = __INA234_Proto_get32(payload + 16);
+			return 1;
+		case PROTO_ALERT:
+			if(length != 7)
+				return 0;
+			frame->payload.alert.timestamp = __INA234_Proto_get32(payload);
+			frame->payload.alert.source = payload[4];
+			frame->payload.alert.mask_enable = __INA234_Proto_get16(payload + 5);
+			return 1;
+	}
+	return 0;
+}
+
+/*!
+    @brief  Remove the first bytes of the buffer, and then the bytes before the next SOF, keeping the rest for the next frames
+    @param  self
+            A pointer to the decoder object (struct)
+		@param  count
+						Number of the bytes to remove at least
+*/
+static void __INA234_Proto_drop(INA234_ProtoDecoder* self, uint8_t count){
+	uint8_t start = count;
+	
+	while(start < self->index && self->buffer[start] != INA234_PROTO_SOF)
+		start++;
+	for(uint8_t i = start; i < self->index; i++)
+		self->buffer[i - start] = self->buffer[i];
+	self->index -= start;
+	self->dropped = self->dropped > start ? self->dropped - start : 0;
+}
+
+/*!
+    @brief  Drop a bad frame starting at the first byte of the buffer, and search the next SOF inside its bytes.
+						A false SOF inside the bytes of an already dropped frame is not counted again.
+    @param  self
+            A pointer to the decoder object (struct)
+		@param  size
+						Size of the bad frame in the buffer
+*/
+static void __INA234_Proto_reject(INA234_ProtoDecoder* self, uint8_t size){
+	if(self->dropped == 0)
+		self->crc_errors++;
+	if(self->dropped < size)
+		self->dropped = size;
+	__INA234_Proto_drop(self, 1);
+}
+
+/*!
+    @brief  Decode the first complete frame of the buffer
+    @param  self
+            A pointer to the decoder object (struct)
+		@param  frame
+						A pointer to the frame which is filled when a complete valid frame is found
+		@retval True if a frame is decoded
+		@retval False if more bytes are needed
+*/
+static uint8_t __INA234_Proto_scan(INA234_ProtoDecoder* self, INA234_ProtoFrame* frame){
+	
+	while(self->index >= INA234_PROTO_HEADER_SIZE){
+		uint8_t length = self->buffer[4];
+		
+		if(length > INA234_PROTO_MAX_PAYLOAD){
+			__INA234_Proto_reject(self, INA234_PROTO_HEADER_SIZE);
+			continue;
+		}
+		
+		uint8_t size = INA234_PROTO_HEADER_SIZE + length + INA234_PROTO_CRC_SIZE;
+		if(self->index < size)
+			return 0;
+		
+		if(__INA234_Proto_get16(self->buffer + INA234_PROTO_HEADER_SIZE + length) != INA234_Proto_crc16(self->buffer + 1, INA234_PROTO_HEADER_SIZE - 1 + length)){
+			__INA234_Proto_reject(self, size);
+			continue;
+		}
+		
+		// The CRC is valid, so the frame is consumed even if its payload is unknown
+		uint8_t parsed = __INA234_Proto_parse(frame, self->buffer);
+		self->dropped = 0;
+		__INA234_Proto_drop(self, size);
+		if(!parsed){
+			self->parse_errors++;
+			continue;
+		}
+		
+		self->frames++;
+		if(self->synced)
+			self->lost_frames += (uint8_t)(frame->sequence - self->next_sequence);
+		self->synced = 1;
+		self->next_sequence = frame->sequence + 1;
+		return 1;
+	}
+	return 0;
+}
+
+/*!
+    @brief  Feed one received byte to the decoder. After a bad frame the decoder resynchronizes on the next SOF inside the dropped bytes,
+						and keeps the bytes after a frame found there, so they can hold more frames: call ::INA234_Proto_next() after each decoded frame
+						to get them (otherwise they are returned with the next bytes).
+    @param  self
+            A pointer to the decoder object (struct)
+		@param  byte
+						The received byte
+		@param  frame
+						A pointer to the frame which is filled when a complete valid frame is received
+		@retval True if a frame is decoded
+		@retval False otherwise
+*/
+uint8_t INA234_Proto_decode(INA234_ProtoDecoder* self, uint8_t byte, INA234_ProtoFrame* frame){
+	
+	if(self->index == 0 && byte != INA234_PROTO_SOF)
+		return 0;
+	
+	self->buffer[self->index++] = byte;
+	return __INA234_Proto_scan(self, frame);
+}
+
+/*!
+    @brief  Get the next frame that is already complete in the bytes kept by the decoder, without a new byte
+    @param  self
+            A pointer to the decoder object (struct)
+		@param  frame
+						A pointer to the frame which is filled when a complete valid frame is found
+		@retval True if a frame is decoded
+		@retval False otherwise
+*/
+uint8_t INA234_Proto_next(INA234_ProtoDecoder* self, INA234_ProtoFrame* frame){
+	return __INA234_Proto_scan(self, frame);
+}
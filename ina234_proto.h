@@ -0,0 +1,113 @@
+/*!
+ * @file ina234_proto.h
+ *
+ * Compact binary telemetry protocol for the INA234 library. This module depends only on the C standard library,
+ * so the same encoder and decoder can be compiled for the MCU and for the host.
+ *
+ * Each frame is:
+ * | SOF (0xA5) | type | device | sequence | length | payload (length bytes) | CRC16 (little endian) |
+ *
+ * The CRC is CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF) over type, device, sequence, length and payload.
+ * The sequence is incremented by the encoder for every frame, so the decoder can count the lost frames.
+ * All of the multi-byte fields of the payloads are little endian.
+ *
+ */
+
+#ifndef __INA234_PROTO_H_
+#define __INA234_PROTO_H_
+
+#include <stdint.h>
+
+#define INA234_PROTO_SOF					0xA5
+#define INA234_PROTO_HEADER_SIZE	5
+#define INA234_PROTO_CRC_SIZE			2
+#define INA234_PROTO_MAX_PAYLOAD	20
+#define INA234_PROTO_MAX_FRAME		(INA234_PROTO_HEADER_SIZE + INA234_PROTO_MAX_PAYLOAD + INA234_PROTO_CRC_SIZE)
+
+#define INA234_PROTO_FLAG_RANGE_20_48mV	0x01	// the shunt voltage LSB is 0.01 mV instead of 0.04 mV
+#define INA234_PROTO_FLAG_FRESH					0x02	// a new conversion was done since the previous sample
+
+typedef enum ProtoType			{PROTO_SAMPLE = 1, PROTO_STATS = 2, PROTO_ALERT = 3} ProtoType;
+
+/*! 
+    @brief  Payload of a ::PROTO_SAMPLE frame (17 bytes)
+*/
+typedef struct ina234_proto_sample{
+	uint32_t	timestamp;
+	uint32_t	sequence;
+	int16_t		shunt_voltage;
+	uint16_t	bus_voltage;
+	uint16_t	power;
+	int16_t		current;
+	uint8_t		flags;
+} INA234_ProtoSample;
+
+/*! 
+    @brief  Payload of a ::PROTO_STATS frame (20 bytes)
+*/
+typedef struct ina234_proto_stats{
+	uint32_t	duplicates;
+	uint32_t	gaps;
+	uint32_t	snapshots;
+	uint32_t	tears;
+	uint32_t	torn_snapshots;
+} INA234_ProtoStats;
+
+/*! 
+    @brief  Payload of a ::PROTO_ALERT frame (7 bytes), filled by ::INA234_Report_alertFrame()
+*/
+typedef struct ina234_proto_alert{
+	uint32_t	timestamp;
+	uint8_t		source;
+	uint16_t	mask_enable;
+} INA234_ProtoAlert;
+
+/*! 
+    @brief  One decoded (or to be encoded) frame
+*/
+typedef struct ina234_proto_frame{
+	uint8_t		type;								/*!< One of the ::ProtoType values */
+	uint8_t		device;							/*!< Index of the device, to multiplex several INA234s on one link */
+	uint8_t		sequence;						/*!< Frame sequence number. Filled by the encoder. */
+	union{
+		INA234_ProtoSample	sample;
+		INA234_ProtoStats		stats;
+		INA234_ProtoAlert		alert;
+	} payload;
+} INA234_ProtoFrame;
+
+/*! 
+    @brief  Class (struct) that stores the state of an encoder
+*/
+typedef struct ina234_proto_encoder{
+	uint8_t		sequence;
+} INA234_ProtoEncoder;
+
+/*! 
+    @brief  Class (struct) that stores the state of a byte-by-byte decoder
+*/
+typedef struct ina234_proto_decoder{
+	
+	uint8_t		buffer[INA234_PROTO_MAX_FRAME];
+	uint8_t		index;
+	uint8_t		dropped;						/*!< Number of the buffered bytes that belong to the last dropped frame */
+	uint8_t		synced;							/*!< 1 after the first valid frame */
+	uint8_t		next_sequence;
+	
+	uint32_t	frames;							/*!< Number of valid frames */
+	uint32_t	crc_errors;					/*!< Number of frames dropped because of a wrong CRC or length */
+	uint32_t	parse_errors;				/*!< Number of frames with a valid CRC, dropped because of an unknown type or a payload length that does not match it */
+	uint32_t	lost_frames;				/*!< Number of frames missing according to the sequence numbers */
+	
+} INA234_ProtoDecoder;
+
+uint16_t	INA234_Proto_crc16(const uint8_t* data, uint16_t length);
+
+void			INA234_Proto_initEncoder(INA234_ProtoEncoder* self);
+uint16_t	INA234_Proto_encode(INA234_ProtoEncoder* self, INA234_ProtoFrame* frame, uint8_t* buffer);
+
+void			INA234_Proto_initDecoder(INA234_ProtoDecoder* self);
+uint8_t		INA234_Proto_decode(INA234_ProtoDecoder* self, uint8_t byte, INA234_ProtoFrame* frame);
+uint8_t		INA234_Proto_next(INA234_ProtoDecoder* self, INA234_ProtoFrame* frame);
+
+#endif
@@ -0,0 +1,668 @@
+/*!
+ * @file ina234_report.c
+ *
+ * Optional helpers to report the samples of the INA234 library (see ina234.c).
+ *
+ */
+
+#include "ina234_report.h"
+
+
+/*!
+    @brief  Get the raw value of one channel of a sample
+    @param  sample
+            A pointer to the ::INA234_Sample
+		@param  channel
+						One of the ::Channel values
+		@return	The raw value (in LSBs)
+*/
+int32_t INA234_Sample_getRaw(const INA234_Sample* sample, Channel channel){
+	switch (channel) {
+		case CHANNEL_SHUNT_VOLTAGE:
+			return sample->shunt_voltage;
+		case CHANNEL_BUS_VOLTAGE:
+			return sample->bus_voltage;
+		case CHANNEL_POWER:
+			return sample->power;
+		case CHANNEL_CURRENT:
+			return sample->current;
+	}
+	return 0;
+}
+
+/*!
+    @brief  Initialize a deadband filter. The filter reports a sample only if at least one channel moved more than its threshold since the last reported sample,
+						or if max_interval passed since then.
+    @param  self
+            A pointer to the deadband object (struct)
+		@param  shunt_voltage
+						Threshold of the shunt voltage (in raw LSBs). 0 reports every change.
+		@param  bus_voltage
+						Threshold of the bus voltage (in raw LSBs)
+		@param  power
+						Threshold of the power (in raw LSBs)
+		@param  current
+						Threshold of the current (in raw LSBs)
+		@param  max_interval
+						Maximum time (in us) between two reported samples, so the receiver knows the link is alive. 0 to disable.
+*/
+void INA234_Deadband_init(INA234_Deadband* self, uint16_t shunt_voltage, uint16_t bus_voltage, uint16_t power, uint16_t current, uint32_t max_interval){
+	self->threshold[CHANNEL_SHUNT_VOLTAGE] = shunt_voltage;
+	self->threshold[CHANNEL_BUS_VOLTAGE] = bus_voltage;
+	self->threshold[CHANNEL_POWER] = power;
+	self->threshold[CHANNEL_CURRENT] = current;
+	self->max_interval = max_interval;
+	self->primed = 0;
+	self->reported = 0;
+	self->suppressed = 0;
+}
+
+/*!
+    @brief  Check if a sample should be reported. If yes, it becomes the new reference of the filter.
+    @param  self
+            A pointer to the deadband object (struct)
+		@param  sample
+						A pointer to the ::INA234_Sample
+		@retval True if the sample should be reported
+		@retval False if the sample is within the deadband
+*/
+uint8_t INA234_Deadband_check(INA234_Deadband* self, const INA234_Sample* sample){
+	uint8_t report = !self->primed || sample->adc_range != self->last.adc_range;
+	
+	if(!report && self->max_interval != 0 && sample->timestamp - self->last.timestamp >= self->max_interval)
+		report = 1;
+	
+	for(uint8_t channel = 0; channel < INA234_CHANNELS && !report; channel++){
+		int32_t delta = INA234_Sample_getRaw(sample, (Channel)channel) - INA234_Sample_getRaw(&self->last, (Channel)channel);
+		if(delta > self->threshold[channel] || -delta > self->threshold[channel])
+			report = 1;
+	}
+	
+	if(report){
+		self->last = *sample;
+		self->primed = 1;
+		self->reported++;
+	}
+	else{
+		self->suppressed++;
+	}
+	
+	return report;
+}
+
+/*!
+    @brief  Set the raw value of one channel of a sample
+    @param  sample
+            A pointer to the ::INA234_Sample
+		@param  channel
+						One of the ::Channel values
+		@param  value
+						The raw value (in LSBs)
+*/
+static void __INA234_Sample_setRaw(INA234_Sample* sample, Channel channel, int32_t value){
+	switch (channel) {
+		case CHANNEL_SHUNT_VOLTAGE:
+			sample->shunt_voltage = (int16_t)value;
+			break;
+		case CHANNEL_BUS_VOLTAGE:
+			sample->bus_voltage = (uint16_t)value;
+			break;
+		case CHANNEL_POWER:
+			sample->power = (uint16_t)value;
+			break;
+		case CHANNEL_CURRENT:
+			sample->current = (int16_t)value;
+			break;
+	}
+}
+
+/*!
+    @brief  Initialize a subscription that delivers its results to a callback. The callback is called from the context of ::INA234_Dispatcher_feed().
+    @param  self
+            A pointer to the subscription object (struct)
+		@param  decimation
+						Number of the samples aggregated into one result (1 for full rate)
+		@param  aggregation
+						- ::AGGREGATE_LAST deliver the last sample
+						- ::AGGREGATE_MEAN deliver the mean of the samples
+						- ::AGGREGATE_MIN_MAX deliver the last sample plus the minimum and maximum of each channel
+		@param  callback
+						The function to be called with each result
+		@param  context
+						A user pointer passed to the callback
+*/
+void INA234_Subscription_initCallback(INA234_Subscription* self, uint16_t decimation, Aggregation aggregation, INA234_Callback callback, void* context){
+	self->decimation = decimation ? decimation : 1;
+	self->aggregation = aggregation;
+	self->callback = callback;
+	self->context = context;
+	self->queue = NULL;
+	self->queue_size = 0;
+	self->head = 0;
+	self->tail = 0;
+	self->overflows = 0;
+	self->pending.count = 0;
+	self->next = NULL;
+}
+
+/*!
+    @brief  Initialize a subscription that delivers its results to a queue. The queue has one producer (the dispatcher) and one consumer (::INA234_Subscription_pop()),
+						so they can run in different tasks or ISRs without a lock.
+    @param  self
+            A pointer to the subscription object (struct)
+		@param  decimation
+						Number of the samples aggregated into one result (1 for full rate)
+		@param  aggregation
+						One of the ::Aggregation values (see ::INA234_Subscription_initCallback())
+		@param  queue
+						A pointer to an array of ::INA234_Aggregate used as the queue
+		@param  queue_size
+						Number of the elements of the queue array. The queue holds queue_size - 1 results.
+*/
+void INA234_Subscription_initQueue(INA234_Subscription* self, uint16_t decimation, Aggregation aggregation, INA234_Aggregate* queue, uint16_t queue_size){
+	INA234_Subscription_initCallback(self, decimation, aggregation, NULL, NULL);
+	self->queue = queue;
+	self->queue_size = queue_size;
+}
+
+/*!
+    @brief  Get the oldest result from the queue of a subscription
+    @param  self
+            A pointer to the subscription object (struct)
+		@param  aggregate
+						A pointer to the ::INA234_Aggregate to be filled
+		@retval True if a result was available
+		@retval False if the queue is empty
+*/
+uint8_t INA234_Subscription_pop(INA234_Subscription* self, INA234_Aggregate* aggregate){
+	uint16_t tail = self->tail;
+	
+	if(tail == self->head)
+		return 0;
+	
+	__DMB();
+	*aggregate = self->queue[tail];
+	__DMB();
+	self->tail = (tail + 1) % self->queue_size;
+	return 1;
+}
+
+/*!
+    @brief  Add one sample to the aggregation of a subscription, and deliver the result when the decimation count is reached
+    @param  self
+            A pointer to the subscription object (struct)
+		@param  sample
+						A pointer to the ::INA234_Sample
+*/
+static void __INA234_Subscription_feed(INA234_Subscription* self, const INA234_Sample* sample){
+	INA234_Aggregate* pending = &self->pending;
+	
+	if(pending->count == 0){
+		pending->min = *sample;
+		pending->max = *sample;
+		for(uint8_t channel = 0; channel < INA234_CHANNELS; channel++)
+			self->sum[channel] = 0;
+	}
+	pending->value = *sample;
+	pending->count++;
+	
+	if(self->aggregation == AGGREGATE_MEAN){
+		for(uint8_t channel = 0; channel < INA234_CHANNELS; channel++)
+			self->sum[channel] += INA234_Sample_getRaw(sample, (Channel)channel);
+	}
+	else if(self->aggregation == AGGREGATE_MIN_MAX){
+		for(uint8_t channel = 0; channel < INA234_CHANNELS; channel++){
+			int32_t value = INA234_Sample_getRaw(sample, (Channel)channel);
+			if(value < INA234_Sample_getRaw(&pending->min, (Channel)channel))
+				__INA234_Sample_setRaw(&pending->min, (Channel)channel, value);
+			if(value > INA234_Sample_getRaw(&pending->max, (Channel)channel))
+				__INA234_Sample_setRaw(&pending->max, (Channel)channel, value);
+		}
+	}
+	
+	if(pending->count < self->decimation)
+		return;
+	
+	if(self->aggregation == AGGREGATE_MEAN){
+		int32_t half = pending->count / 2;
+		for(uint8_t channel = 0; channel < INA234_CHANNELS; channel++){
+			int32_t sum = self->sum[channel];
+			__INA234_Sample_setRaw(&pending->value, (Channel)channel, (sum >= 0 ? sum + half : sum - half) / pending->count);
+		}
+	}
+	
+	if(self->callback){
+		self->callback(self->context, pending);
+	}
+	else if(self->queue){
+		uint16_t head = self->head;
+		uint16_t next = (head + 1) % self->queue_size;
+		if(next == self->tail){
+			self->overflows++;
+		}
+		else{
+			self->queue[head] = *pending;
+			__DMB();
+			self->head = next;
+		}
+	}
+	
+	pending->count = 0;
+}
+
+/*!
+    @brief  Initialize a batch size controller. The controller starts with the minimum batch size (lowest latency).
+    @param  self
+            A pointer to the controller object (struct)
+		@param  min_size
+						Minimum batch size (in samples)
+		@param  max_size
+						Maximum batch size (in samples). It must fit in one block of the used ::INA234_Pool.
+*/
+void INA234_Batch_init(INA234_BatchControl* self, uint16_t min_size, uint16_t max_size){
+	self->min_size = min_size;
+	self->max_size = max_size;
+	self->size = min_size;
+	self->fill_time = 0;
+	self->transmit_time = 0;
+	self->grows = 0;
+	self->shrinks = 0;
+}
+
+/*!
+    @brief  Report a filled batch to the controller
+    @param  self
+            A pointer to the controller object (struct)
+		@param  samples
+						Number of the samples in the batch
+		@param  fill_time
+						The time spent to fill the batch (in any unit, the same as ::INA234_Batch_transmitted())
+*/
+void INA234_Batch_filled(INA234_BatchControl* self, uint16_t samples, uint32_t fill_time){
+	if(samples == 0)
+		return;
+	
+	// Moving average (1/8) of the time per sample, with 4 fractional bits
+	uint32_t per_sample = (fill_time << 4) / samples;
+	self->fill_time = self->fill_time ? self->fill_time - (self->fill_time >> 3) + (per_sample >> 3) : per_sample;
+}
+
+/*!
+    @brief  Report a transmitted batch to the controller and get the size of the next batch.
+						If the link lags (batches are waiting or a batch takes longer to send than to fill), the batch size grows by 50% to amortize the per-transfer overhead.
+						If the link is idle (nothing is waiting and a batch is sent in less than a quarter of its fill time), the batch size shrinks by 25% to cut the latency.
+    @param  self
+            A pointer to the controller object (struct)
+		@param  transmit_time
+						The time from starting the transfer until its completion (in any unit, the same as ::INA234_Batch_filled())
+		@param  occupancy
+						Number of the batches waiting to be transmitted
+		@return	The size of the next batch (in samples)
+*/
+uint16_t INA234_Batch_transmitted(INA234_BatchControl* self, uint32_t transmit_time, uint16_t occupancy){
+	self->transmit_time = self->transmit_time ? self->transmit_time - (self->transmit_time >> 2) + (transmit_time >> 2) : transmit_time;
+	
+	uint32_t batch_fill_time = (self->fill_time * self->size) >> 4;
+	uint32_t size = self->size;
+	
+	if(occupancy > 0 || self->transmit_time > batch_fill_time){
+		size += size / 2 + 1;
+		if(size > self->max_size)
+			size = self->max_size;
+		if(size != self->size)
+			self->grows++;
+	}
+	else if(self->transmit_time * 4 < batch_fill_time){
+		size -= size / 4;
+		if(size < self->min_size)
+			size = self->min_size;
+		if(size != self->size)
+			self->shrinks++;
+	}
+	
+	self->size = size;
+	return self->size;
+}
+
+/*!
+    @brief  Initialize a dispatcher
+    @param  self
+            A pointer to the dispatcher object (struct)
+		@param  ina234
+						A pointer to the ina234 object (struct) to be read by ::INA234_Dispatcher_poll()
+*/
+void INA234_Dispatcher_init(INA234_Dispatcher* self, INA234* ina234){
+	self->ina234 = ina234;
+	self->subscriptions = NULL;
+	self->reads = 0;
+}
+
+/*!
+    @brief  Add a subscription to a dispatcher
+    @param  self
+            A pointer to the dispatcher object (struct)
+		@param  subscription
+						A pointer to an initialized subscription object (struct). It must stay valid while the dispatcher is used.
+*/
+void INA234_Dispatcher_subscribe(INA234_Dispatcher* self, INA234_Subscription* subscription){
+	subscription->next = self->subscriptions;
+	self->subscriptions = subscription;
+}
+
+/*!
+    @brief  Feed a sample to all of the subscriptions of a dispatcher. Use it if the samples are acquired somewhere else (for example by ::INA234_readSnapshot()).
+    @param  self
+            A pointer to the dispatcher object (struct)
+		@param  sample
+						A pointer to the ::INA234_Sample
+*/
+void INA234_Dispatcher_feed(INA234_Dispatcher* self, const INA234_Sample* sample){
+	for(INA234_Subscription* subscription = self->subscriptions; subscription; subscription = subscription->next)
+		__INA234_Subscription_feed(subscription, sample);
+}
+
+/*!
+    @brief  Acquire one sample with ::INA234_acquire() and feed it to all of the subscriptions. The duplicate samples (no new conversion) are not fed.
+    @param  self
+            A pointer to the dispatcher object (struct)
+		@return	Ths status of reading
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut in case of failure
+*/
+Status INA234_Dispatcher_poll(INA234_Dispatcher* self){
+	INA234_Sample sample;
+	
+	if(STATUS_OK != INA234_acquire(self->ina234, &sample))
+		return STATUS_TimeOut;
+	
+	self->reads++;
+	if(sample.fresh)
+		INA234_Dispatcher_feed(self, &sample);
+	
+	return STATUS_OK;
+}
+
+/*!
+    @brief  Initialize a block pool on a static storage
+    @param  self
+            A pointer to the pool object (struct)
+		@param  storage
+						A pointer to a 4-byte aligned buffer of ::INA234_POOL_STORAGE_SIZE(capacity, count) bytes
+		@param  capacity
+						Number of the data bytes of each block
+		@param  count
+						Number of the blocks
+*/
+void INA234_Pool_init(INA234_Pool* self, void* storage, uint16_t capacity, uint16_t count){
+	uint8_t* address = (uint8_t*)storage;
+	
+	self->free = NULL;
+	self->count = count;
+	self->used = 0;
+	self->high_water = 0;
+	self->exhaustions = 0;
+	
+	for(uint16_t i = 0; i < count; i++){
+		INA234_Block* block = (INA234_Block*)(address + i * INA234_POOL_BLOCK_STRIDE(capacity));
+		block->capacity = capacity;
+		block->length = 0;
+		block->next = self->free;
+		self->free = block;
+	}
+}
+
+/*!
+    @brief  Allocate a block from the pool
+    @param  self
+            A pointer to the pool object (struct)
+		@return	A pointer to the block (with ina234_block::length set to 0), or NULL if the pool is exhausted
+*/
+INA234_Block* INA234_Pool_alloc(INA234_Pool* self){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	
+	INA234_Block* block = self->free;
+	if(block){
+		self->free = block->next;
+		if(++self->used > self->high_water)
+			self->high_water = self->used;
+	}
+	else{
+		self->exhaustions++;
+	}
+	
+	__set_PRIMASK(primask);
+	
+	if(block){
+		block->next = NULL;
+		block->length = 0;
+	}
+	return block;
+}
+
+/*!
+    @brief  Return a block to the pool
+    @param  self
+            A pointer to the pool object (struct)
+		@param  block
+						A pointer to the block allocated by ::INA234_Pool_alloc()
+*/
+void INA234_Pool_free(INA234_Pool* self, INA234_Block* block){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	
+	block->next = self->free;
+	self->free = block;
+	self->used--;
+	
+	__set_PRIMASK(primask);
+}
+
+/*!
+    @brief  Initialize an empty block queue
+    @param  self
+            A pointer to the queue object (struct)
+*/
+void INA234_BlockQueue_init(INA234_BlockQueue* self){
+	self->head = NULL;
+	self->tail = NULL;
+	self->length = 0;
+}
+
+/*!
+    @brief  Append a block to the end of the queue
+    @param  self
+            A pointer to the queue object (struct)
+		@param  block
+						A pointer to the block
+*/
+void INA234_BlockQueue_put(INA234_BlockQueue* self, INA234_Block* block){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	
+	block->next = NULL;
+	if(self->tail)
+		self->tail->next = block;
+	else
+		self->head = block;
+	self->tail = block;
+	self->length++;
+	
+	__set_PRIMASK(primask);
+}
+
+/*!
+    @brief  Remove the first block of the queue
+    @param  self
+            A pointer to the queue object (struct)
+		@return	A pointer to the block, or NULL if the queue is empty
+*/
+INA234_Block* INA234_BlockQueue_get(INA234_BlockQueue* self){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	
+	INA234_Block* block = self->head;
+	if(block){
+		self->head = block->next;
+		if(!self->head)
+			self->tail = NULL;
+		self->length--;
+	}
+	
+	__set_PRIMASK(primask);
+	return block;
+}
+
+/*!
+    @brief  Append a string to the buffer
+    @param  buffer
+            A pointer to the output buffer
+		@param  text
+						The string
+		@return	Number of the written characters
+*/
+static uint16_t __INA234_Report_appendText(char* buffer, const char* text){
+	uint16_t length = 0;
+	while(text[length]){
+		buffer[length] = text[length];
+		length++;
+	}
+	return length;
+}
+
+/*!
+    @brief  Append a fixed-point value to the buffer with the given number of decimals, rounded like printf does
+    @param  buffer
+            A pointer to the output buffer
+		@param  value
+						The value in thousandths of the unit with 8 fractional bits (see ::INA234_Sample_getFixedQ8())
+		@param  decimals
+						Number of the decimals (0 to 3)
+		@return	Number of the written characters
+*/
+static uint16_t __INA234_Report_appendFixed(char* buffer, int32_t value, uint8_t decimals){
+	static const uint32_t divisors[4] = {1000 * 256, 100 * 256, 10 * 256, 256};
+	char digits[12];
+	uint16_t length = 0;
+	uint8_t count = 0;
+	
+	if(value < 0)
+		buffer[length++] = '-';
+	
+	uint32_t magnitude = value < 0 ? (uint32_t)(-value) : (uint32_t)value;
+	uint32_t rounded = (magnitude + divisors[decimals] / 2) / divisors[decimals];
+	
+	// Digits in reverse order, at least one digit before the point
+	do{
+		digits[count++] = '0' + rounded % 10;
+		rounded /= 10;
+	}while(rounded || count <= decimals);
+	
+	while(count){
+		if(count == decimals)
+			buffer[length++] = '.';
+		buffer[length++] = digits[--count];
+	}
+	
+	return length;
+}
+
+/*!
+    @brief  Format a sample as a human-readable line using integer operations only. The output is the same as
+						`"Shunt Voltage: %.3fmV \t Bus Voltage: %.2fV \t Current: %.2fA \t Power: %.2fW\r\n"` of printf,
+						without linking the float support of printf.
+    @param  buffer
+            A pointer to the output buffer. It must have at least ::INA234_REPORT_LINE_SIZE characters.
+		@param  sample
+						A pointer to the ::INA234_Sample
+		@return	Length of the line (without the null terminator)
+*/
+uint16_t INA234_Report_format(char* buffer, const INA234_Sample* sample){
+	uint16_t length = 0;
+	
+	length += __INA234_Report_appendText(buffer + length, "Shunt Voltage: ");
+	length += __INA234_Report_appendFixed(buffer + length, INA234_Sample_getFixedQ8(sample, CHANNEL_SHUNT_VOLTAGE), 3);
+	length += __INA234_Report_appendText(buffer + length, "mV \t Bus Voltage: ");
+	length += __INA234_Report_appendFixed(buffer + length, INA234_Sample_getFixedQ8(sample, CHANNEL_BUS_VOLTAGE), 2);
+	length += __INA234_Report_appendText(buffer + length, "V \t Current: ");
+	length += __INA234_Report_appendFixed(buffer + length, INA234_Sample_getFixedQ8(sample, CHANNEL_CURRENT), 2);
+	length += __INA234_Report_appendText(buffer + length, "A \t Power: ");
+	length += __INA234_Report_appendFixed(buffer + length, INA234_Sample_getFixedQ8(sample, CHANNEL_POWER), 2);
+	length += __INA234_Report_appendText(buffer + length, "W\r\n");
+	buffer[length] = 0;
+	
+	return length;
+}
+
+/*!
+    @brief  Fill a ::PROTO_SAMPLE frame from a sample, to be encoded by ::INA234_Proto_encode()
+    @param  frame
+            A pointer to the frame
+		@param  device
+						Index of the device on the link
+		@param  sample
+						A pointer to the ::INA234_Sample
+*/
+void INA234_Report_sampleFrame(INA234_ProtoFrame* frame, uint8_t device, const INA234_Sample* sample){
+	frame->type = PROTO_SAMPLE;
+	frame->device = device;
+	frame->payload.sample.timestamp = sample->timestamp;
+	frame->payload.sample.sequence = sample->sequence;
+	frame->payload.sample.shunt_voltage = sample->shunt_voltage;
+	frame->payload.sample.bus_voltage = sample->bus_voltage;
+	frame->payload.sample.power = sample->power;
+	frame->payload.sample.current = sample->current;
+	frame->payload.sample.flags = (sample->adc_range == RANGE_20_48mV ? INA234_PROTO_FLAG_RANGE_20_48mV : 0) | (sample->fresh ? INA234_PROTO_FLAG_FRESH : 0);
+}
+
+/*!
+    @brief  Fill a ::PROTO_STATS frame from the statistic counters of an INA234, to be encoded by ::INA234_Proto_encode()
+    @param  frame
+            A pointer to the frame
+		@param  device
+						Index of the device on the link
+		@param  ina234
+						A pointer to the ina234 object (struct)
+*/
+void INA234_Report_statsFrame(INA234_ProtoFrame* frame, uint8_t device, INA234* ina234){
+	frame->type = PROTO_STATS;
+	frame->device = device;
+	frame->payload.stats.duplicates = ina234->duplicates;
+	frame->payload.stats.gaps = ina234->gaps;
+	frame->payload.stats.snapshots = ina234->snapshots;
+	frame->payload.stats.tears = ina234->tears;
+	frame->payload.stats.torn_snapshots = ina234->torn_snapshots;
+}
+
+#if INA234_USE_ALERT
+/*!
+    @brief  Fill a ::PROTO_ALERT frame from an alert decoded by ::INA234_sleepUntilAlert(), to be encoded by ::INA234_Proto_encode()
+    @param  frame
+            A pointer to the frame
+		@param  device
+						Index of the device on the link
+		@param  ina234
+						A pointer to the ina234 object (struct). The timestamp is the time it woke up (ina234::wake_time).
+		@param  event
+						A pointer to the ::INA234_AlertEvent. ina234_proto_alert::mask_enable gets its flags at their places in the mask/enable register
+						(OVF, CVRF, AFF and MemError), and ina234_proto_alert::source is ::ALERT_LIMIT_REACHED or ::ALERT_DATA_READY like ::INA234_getAlertSource().
+*/
+void INA234_Report_alertFrame(INA234_ProtoFrame* frame, uint8_t device, INA234* ina234, const INA234_AlertEvent* event){
+	uint16_t mask_enable = 0;
+	
+	if(event->errors == ERROR_OVF || event->errors == ERROR_BOTH_MEMORY_OVF)
+		mask_enable |= 0x0004;
+	if(event->data_ready)
+		mask_enable |= 0x0008;
+	if(event->limit_reached)
+		mask_enable |= 0x0010;
+	if(event->errors == ERROR_MEMORY || event->errors == ERROR_BOTH_MEMORY_OVF)
+		mask_enable |= 0x0020;
+	
+	frame->type = PROTO_ALERT;
+	frame->device = device;
+	frame->payload.alert.timestamp = ina234->wake_time;
+	frame->payload.alert.source = event->limit_reached ? ALERT_LIMIT_REACHED : ALERT_DATA_READY;
+	frame->payload.alert.mask_enable = mask_enable;
+}
+#endif
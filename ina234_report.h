@@ -0,0 +1,174 @@
+/*!
+ * @file ina234_report.h
+ *
+ * Optional helpers to report the samples of the INA234 library (see ina234.h).
+ *
+ */
+
+#ifndef __INA234_REPORT_H_
+#define __INA234_REPORT_H_
+
+#include "ina234.h"
+#include "ina234_proto.h"
+
+#define INA234_REPORT_LINE_SIZE	100
+
+typedef enum Aggregation		{AGGREGATE_LAST, AGGREGATE_MEAN, AGGREGATE_MIN_MAX} Aggregation;
+
+/*! 
+    @brief  Class (struct) that stores the state of a deadband (change-only) reporting filter
+*/
+typedef struct ina234_deadband{
+	
+	uint16_t			threshold[INA234_CHANNELS];		/*!< Minimum change (in raw LSBs) of each ::Channel to report a sample */
+	uint32_t			max_interval;									/*!< Maximum time (in us) between two reported samples. 0 to disable. */
+	
+	INA234_Sample	last;
+	uint8_t				primed;
+	
+	uint32_t			reported;
+	uint32_t			suppressed;
+	
+} INA234_Deadband;
+
+/*! 
+    @brief  The result of aggregating ina234_aggregate::count samples for a subscriber
+*/
+typedef struct ina234_aggregate{
+	
+	INA234_Sample	value;							/*!< The last sample (::AGGREGATE_LAST and ::AGGREGATE_MIN_MAX) or the mean of the samples (::AGGREGATE_MEAN) */
+	INA234_Sample	min;								/*!< Minimum of each channel (only for ::AGGREGATE_MIN_MAX) */
+	INA234_Sample	max;								/*!< Maximum of each channel (only for ::AGGREGATE_MIN_MAX) */
+	uint16_t			count;							/*!< Number of the aggregated samples */
+	
+} INA234_Aggregate;
+
+typedef void (*INA234_Callback)(void* context, const INA234_Aggregate* aggregate);
+
+/*! 
+    @brief  Class (struct) that stores one consumer of the samples. The results are delivered either to a callback or to a queue.
+*/
+typedef struct ina234_subscription{
+	
+	uint16_t					decimation;				/*!< Number of the samples aggregated into one result */
+	Aggregation				aggregation;
+	
+	INA234_Callback		callback;
+	void*							context;
+	
+	INA234_Aggregate*	queue;
+	uint16_t					queue_size;
+	volatile uint16_t	head;
+	volatile uint16_t	tail;
+	uint32_t					overflows;				/*!< Number of the results dropped because the queue was full */
+	
+	INA234_Aggregate	pending;
+	int32_t						sum[INA234_CHANNELS];
+	
+	struct ina234_subscription* next;
+	
+} INA234_Subscription;
+
+/*! 
+    @brief  Class (struct) that feeds the samples of one INA234 to all of its subscriptions
+*/
+typedef struct ina234_dispatcher{
+	
+	INA234*								ina234;
+	INA234_Subscription*	subscriptions;
+	uint32_t							reads;				/*!< Number of the bus reads done by ::INA234_Dispatcher_poll */
+	
+} INA234_Dispatcher;
+
+/*! 
+    @brief  One block of a ::INA234_Pool. The blocks are passed between the stages (acquisition, encoding, transmit) by reference.
+*/
+typedef struct ina234_block{
+	
+	struct ina234_block*	next;				/*!< Link of the free list or of a ::INA234_BlockQueue */
+	uint16_t							length;			/*!< Number of the used bytes of ina234_block::data */
+	uint16_t							capacity;		/*!< Size of ina234_block::data */
+	uint32_t							timestamp;	/*!< Free for the stages, for example to measure the transmit time */
+	uint8_t								data[];
+	
+} INA234_Block;
+
+#define INA234_POOL_BLOCK_STRIDE(capacity)						(sizeof(INA234_Block) + (((capacity) + 3) & ~3))
+#define INA234_POOL_STORAGE_SIZE(capacity, count)		((count) * INA234_POOL_BLOCK_STRIDE(capacity))
+
+/*! 
+    @brief  Class (struct) of a fixed-size block allocator. Allocating and freeing take constant time and can be called from ISRs.
+*/
+typedef struct ina234_pool{
+	
+	INA234_Block*	free;
+	uint16_t			count;							/*!< Total number of the blocks */
+	uint16_t			used;								/*!< Number of the allocated blocks */
+	uint16_t			high_water;					/*!< Maximum of ina234_pool::used so far */
+	uint32_t			exhaustions;				/*!< Number of the failed allocations */
+	
+} INA234_Pool;
+
+/*! 
+    @brief  FIFO of blocks, used to hand the blocks from one stage to the next one. It can be used from ISRs.
+*/
+typedef struct ina234_block_queue{
+	
+	INA234_Block*	head;
+	INA234_Block*	tail;
+	uint16_t			length;
+	
+} INA234_BlockQueue;
+
+/*! 
+    @brief  Class (struct) that adapts the number of samples per batch to the throughput of the transport
+*/
+typedef struct ina234_batch_control{
+	
+	uint16_t	min_size;							/*!< Minimum batch size (in samples) */
+	uint16_t	max_size;							/*!< Maximum batch size (in samples) */
+	uint16_t	size;									/*!< The batch size to be used for the next batch */
+	
+	uint32_t	fill_time;						/*!< Average time to fill one sample into a batch (x16) */
+	uint32_t	transmit_time;				/*!< Average transmit time of one batch */
+	
+	uint32_t	grows;
+	uint32_t	shrinks;
+	
+} INA234_BatchControl;
+
+int32_t	INA234_Sample_getRaw(const INA234_Sample* sample, Channel channel);
+
+void		INA234_Deadband_init(INA234_Deadband* self, uint16_t shunt_voltage, uint16_t bus_voltage, uint16_t power, uint16_t current, uint32_t max_interval);
+uint8_t	INA234_Deadband_check(INA234_Deadband* self, const INA234_Sample* sample);
+
+void		INA234_Subscription_initCallback(INA234_Subscription* self, uint16_t decimation, Aggregation aggregation, INA234_Callback callback, void* context);
+void		INA234_Subscription_initQueue(INA234_Subscription* self, uint16_t decimation, Aggregation aggregation, INA234_Aggregate* queue, uint16_t queue_size);
+uint8_t	INA234_Subscription_pop(INA234_Subscription* self, INA234_Aggregate* aggregate);
+
+void					INA234_Pool_init(INA234_Pool* self, void* storage, uint16_t capacity, uint16_t count);
+INA234_Block*	INA234_Pool_alloc(INA234_Pool* self);
+void					INA234_Pool_free(INA234_Pool* self, INA234_Block* block);
+
+void					INA234_BlockQueue_init(INA234_BlockQueue* self);
+void					INA234_BlockQueue_put(INA234_BlockQueue* self, INA234_Block* block);
+INA234_Block*	INA234_BlockQueue_get(INA234_BlockQueue* self);
+
+void			INA234_Batch_init(INA234_BatchControl* self, uint16_t min_size, uint16_t max_size);
+void			INA234_Batch_filled(INA234_BatchControl* self, uint16_t samples, uint32_t fill_time);
+uint16_t	INA234_Batch_transmitted(INA234_BatchControl* self, uint32_t transmit_time, uint16_t occupancy);
+
+void		INA234_Dispatcher_init(INA234_Dispatcher* self, INA234* ina234);
+void		INA234_Dispatcher_subscribe(INA234_Dispatcher* self, INA234_Subscription* subscription);
+void		INA234_Dispatcher_feed(INA234_Dispatcher* self, const INA234_Sample* sample);
+Status	INA234_Dispatcher_poll(INA234_Dispatcher* self);
+
+uint16_t	INA234_Report_format(char* buffer, const INA234_Sample* sample);
+
+void		INA234_Report_sampleFrame(INA234_ProtoFrame* frame, uint8_t device, const INA234_Sample* sample);
+void		INA234_Report_statsFrame(INA234_ProtoFrame* frame, uint8_t device, INA234* ina234);
+#if INA234_USE_ALERT
+void		INA234_Report_alertFrame(INA234_ProtoFrame* frame, uint8_t device, INA234* ina234, const INA234_AlertEvent* event);
+#endif
+
+#endif
@@ -0,0 +1,382 @@
+/*!
+ * @file ina234_trace.c
+ *
+ * Optional trace and replay of the I2C transactions of the INA234 library (see ina234_trace.h).
+ *
+ */
+
+#include "ina234_trace.h"
+
+
+// Privates
+/*!
+    @brief  Get the current time from the clock of the trace
+*/
+static uint32_t __INA234_Trace_now(INA234_Trace* self){
+	return self->clock ? self->clock() : HAL_GetTick() * 1000;
+}
+
+/*!
+    @brief  Append a record to the ring. The events may come from the interrupts, so it is done with the interrupts disabled.
+*/
+static void __INA234_Trace_push(INA234_Trace* self, const INA234_TraceRecord* record){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	self->records[self->head % self->capacity] = *record;
+	self->head++;
+	__set_PRIMASK(primask);
+}
+
+/*!
+    @brief  Find the saved transport of an attached ina234 object. The general call (address 0) goes through the first one.
+*/
+static INA234_TraceDevice* __INA234_Trace_device(INA234_Trace* self, uint16_t DevAddress){
+	for(uint8_t i = 0; i < self->devices_count; i++)
+		if(self->devices[i].address == DevAddress)
+			return &self->devices[i];
+	return self->devices_count ? &self->devices[0] : NULL;
+}
+
+/*!
+    @brief  The ::INA234_Transfer of the traced ina234 objects: run the transaction on the previous transport and record it
+*/
+static Status __INA234_Trace_record(void* context, uint16_t DevAddress, uint8_t MemAddress, uint8_t* pData, uint16_t Size, uint8_t write){
+	INA234_Trace* self = (INA234_Trace*)context;
+	INA234_TraceDevice* device = __INA234_Trace_device(self, DevAddress);
+	INA234_TraceRecord record;
+	uint32_t timestamp = __INA234_Trace_now(self);
+	Status status;
+	
+	if(device->transfer)
+		status = device->transfer(device->transfer_context, DevAddress, MemAddress, pData, Size, write);
+	else if(write && Size == 0)
+		status = HAL_OK == HAL_I2C_Master_Transmit(device->hi2c, DevAddress, &MemAddress, 1, INA234_I2C_TIMEOUT) ? STATUS_OK : STATUS_TimeOut;
+	else if(write)
+		status = HAL_OK == HAL_I2C_Mem_Write(device->hi2c, DevAddress, MemAddress, I2C_MEMADD_SIZE_8BIT, pData, Size, INA234_I2C_TIMEOUT) ? STATUS_OK : STATUS_TimeOut;
+	else
+		status = HAL_OK == HAL_I2C_Mem_Read(device->hi2c, DevAddress, MemAddress, I2C_MEMADD_SIZE_8BIT, pData, Size, INA234_I2C_TIMEOUT) ? STATUS_OK : STATUS_TimeOut;
+	
+	if(self->mode != TRACE_RECORD)
+		return status;
+	
+	uint32_t duration = __INA234_Trace_now(self) - timestamp;
+	record.timestamp = timestamp;
+	record.duration = duration > 0xFFFF ? 0xFFFF : (uint16_t)duration;
+	record.address = (uint8_t)DevAddress;
+	record.reg = MemAddress;
+	record.flags = (write ? INA234_TRACE_WRITE : 0) | (status != STATUS_OK ? INA234_TRACE_ERROR : 0);
+	record.size = Size > 2 ? 2 : (uint8_t)Size;
+	record.data[0] = Size > 0 ? pData[0] : 0;
+	record.data[1] = Size > 1 ? pData[1] : 0;
+	__INA234_Trace_push(self, &record);
+	
+	return status;
+}
+
+/*!
+    @brief  Move the replay clock after a replayed record: the clock reads of the driver between two records get the start of the later one,
+						and after the last record the end of the replayed one
+*/
+static void __INA234_Trace_follow(INA234_Trace* self, const INA234_TraceRecord* replayed){
+	uint32_t first = self->head > self->capacity ? self->head - self->capacity : 0;
+	INA234_TraceRecord next;
+	
+	if(INA234_Trace_get(self, self->cursor - first, &next))
+		self->time = next.timestamp;
+	else
+		self->time = replayed->timestamp + replayed->duration;
+}
+
+/*!
+    @brief  The ::INA234_Transfer of the replayed ina234 objects: answer the transaction from the next record
+*/
+static Status __INA234_Trace_play(void* context, uint16_t DevAddress, uint8_t MemAddress, uint8_t* pData, uint16_t Size, uint8_t write){
+	INA234_Trace* self = (INA234_Trace*)context;
+	uint32_t first = self->head > self->capacity ? self->head - self->capacity : 0;
+	INA234_TraceRecord record;
+	
+	// The events are only for the timeline
+	while(INA234_Trace_get(self, self->cursor - first, &record) && (record.flags & INA234_TRACE_EVENT))
+		self->cursor++;
+	
+	if(self->cursor - first >= INA234_Trace_count(self)){
+		self->mismatches++;
+		return STATUS_TimeOut;
+	}
+	if(record.address != (uint8_t)DevAddress || record.reg != MemAddress || (record.flags & INA234_TRACE_WRITE) != (write ? INA234_TRACE_WRITE : 0) ||
+			record.size != (Size > 2 ? 2 : Size)){
+		self->mismatches++;
+		return STATUS_TimeOut;
+	}
+	
+	self->cursor++;
+	self->replayed++;
+	__INA234_Trace_follow(self, &record);
+	if(!write)
+		for(uint16_t i = 0; i < Size && i < 2; i++)
+			pData[i] = record.data[i];
+	
+	return (record.flags & INA234_TRACE_ERROR) ? STATUS_TimeOut : STATUS_OK;
+}
+
+/*!
+    @brief  Save the transport of an ina234 object before the trace is put in front of it. It is kept if the trace is already there.
+						It fails if ::INA234_TRACE_DEVICES other addresses are already saved, since the transactions of the object could not be routed to its transport.
+*/
+static Status __INA234_Trace_save(INA234_Trace* self, INA234* ina234){
+	INA234_TraceDevice* device = NULL;
+	
+	if(ina234->transfer == __INA234_Trace_record || ina234->transfer == __INA234_Trace_play)
+		return STATUS_OK;
+	for(uint8_t i = 0; i < self->devices_count; i++)
+		if(self->devices[i].address == ina234->I2C_ADDR)
+			device = &self->devices[i];
+	if(!device && self->devices_count < INA234_TRACE_DEVICES)
+		device = &self->devices[self->devices_count++];
+	if(!device)
+		return STATUS_TimeOut;
+	
+	device->address = ina234->I2C_ADDR;
+	device->hi2c = ina234->hi2c;
+	device->transfer = ina234->transfer;
+	device->transfer_context = ina234->transfer_context;
+	return STATUS_OK;
+}
+
+// Trace
+/*!
+    @brief  Initialize a trace
+    @param  self
+            A pointer to the trace object (struct)
+		@param  records
+						Storage of the ring
+		@param  capacity
+						Number of the records of the storage. When it is full, the oldest records are overwritten.
+		@param  clock
+						Microsecond clock of the timestamps (see ::INA234_setClock()), or NULL to use HAL_GetTick()
+*/
+void INA234_Trace_init(INA234_Trace* self, INA234_TraceRecord* records, uint32_t capacity, INA234_Clock clock){
+	self->records = records;
+	self->capacity = capacity;
+	self->head = 0;
+	self->clock = clock;
+	self->mode = TRACE_OFF;
+	self->devices_count = 0;
+	self->cursor = 0;
+	self->time = 0;
+	self->replayed = 0;
+	self->mismatches = 0;
+}
+
+/*!
+    @brief  Record all of the transactions and the events (see ::INA234_setEventHook()) of an ina234 object. Call it after ::INA234_init() and after the transport
+						(for example ::INA234_Bus_attach()) is set. Up to ::INA234_TRACE_DEVICES ina234 objects with different addresses can be attached to the same trace,
+						to get all of them on one timeline. Each one keeps its own transport. One more is refused.
+    @param  self
+            A pointer to the trace object (struct)
+		@param  ina234
+						A pointer to the ina234 object (struct)
+		@return	Ths status of attaching
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut if ::INA234_TRACE_DEVICES ina234 objects with other addresses are already attached. The ina234 object is left untouched.
+*/
+Status INA234_Trace_attach(INA234_Trace* self, INA234* ina234){
+	if(STATUS_OK != __INA234_Trace_save(self, ina234))
+		return STATUS_TimeOut;
+	
+	self->mode = TRACE_RECORD;
+	INA234_setTransfer(ina234, __INA234_Trace_record, self);
+	INA234_setEventHook(ina234, INA234_Trace_event, self);
+	return STATUS_OK;
+}
+
+/*!
+    @brief  Stop recording or replaying an ina234 object, and give it back its previous transport. The other attached objects go on;
+						the trace stops when the last one is detached. An object that is not attached is left untouched.
+    @param  self
+            A pointer to the trace object (struct)
+		@param  ina234
+						A pointer to the ina234 object (struct)
+*/
+void INA234_Trace_detach(INA234_Trace* self, INA234* ina234){
+	uint8_t index = 0;
+	
+	while(index < self->devices_count && self->devices[index].address != ina234->I2C_ADDR)
+		index++;
+	if(index == self->devices_count)
+		return;
+	
+	INA234_setTransfer(ina234, self->devices[index].transfer, self->devices[index].transfer_context);
+	INA234_setEventHook(ina234, NULL, NULL);
+	
+	// Free the slot
+	self->devices_count--;
+	for(uint8_t i = index; i < self->devices_count; i++)
+		self->devices[i] = self->devices[i + 1];
+	if(self->devices_count == 0)
+		self->mode = TRACE_OFF;
+}
+
+/*!
+    @brief  Get the number of the records kept in the ring
+*/
+uint32_t INA234_Trace_count(const INA234_Trace* self){
+	return self->head > self->capacity ? self->capacity : self->head;
+}
+
+/*!
+    @brief  Get a record of the ring
+    @param  self
+            A pointer to the trace object (struct)
+		@param  index
+						0 for the oldest record kept in the ring
+		@param  record
+						A pointer to the record to be filled
+		@retval True in case of success
+		@retval False if there is no such record
+*/
+uint8_t INA234_Trace_get(const INA234_Trace* self, uint32_t index, INA234_TraceRecord* record){
+	uint32_t count = INA234_Trace_count(self);
+	
+	if(index >= count)
+		return 0;
+	*record = self->records[(self->head - count + index) % self->capacity];
+	return 1;
+}
+
+/*!
+    @brief  Write the records of the ring, the oldest first, as ::INA234_TRACE_RECORD_SIZE bytes each:
+						timestamp (4 bytes, little endian), duration (2 bytes, little endian), address, register, flags, size, and the two data bytes
+    @param  self
+            A pointer to the trace object (struct)
+		@param  buffer
+						The output
+		@param  size
+						Size of the output in bytes
+		@return	Number of the bytes written. The newest records that do not fit are left out.
+*/
+uint32_t INA234_Trace_serialize(const INA234_Trace* self, uint8_t* buffer, uint32_t size){
+	uint32_t count = INA234_Trace_count(self);
+	uint32_t length = 0;
+	INA234_TraceRecord record;
+	
+	for(uint32_t i = 0; i < count && length + INA234_TRACE_RECORD_SIZE <= size && INA234_Trace_get(self, i, &record); i++){
+		buffer[length++] = record.timestamp & 0xFF;
+		buffer[length++] = (record.timestamp >> 8) & 0xFF;
+		buffer[length++] = (record.timestamp >> 16) & 0xFF;
+		buffer[length++] = record.timestamp >> 24;
+		buffer[length++] = record.duration & 0xFF;
+		buffer[length++] = record.duration >> 8;
+		buffer[length++] = record.address;
+		buffer[length++] = record.reg;
+		buffer[length++] = record.flags;
+		buffer[length++] = record.size;
+		buffer[length++] = record.data[0];
+		buffer[length++] = record.data[1];
+	}
+	return length;
+}
+
+/*!
+    @brief  Fill the ring with serialized records (see ::INA234_Trace_serialize()), for example to replay the trace of a field unit on a PC
+    @param  self
+            A pointer to the trace object (struct)
+		@param  buffer
+						The serialized records
+		@param  length
+						Length of the buffer in bytes
+		@return	Number of the records loaded. If there are more than the capacity, only the newest ones are kept.
+*/
+uint32_t INA234_Trace_load(INA234_Trace* self, const uint8_t* buffer, uint32_t length){
+	uint32_t count = length / INA234_TRACE_RECORD_SIZE;
+	
+	self->head = 0;
+	for(uint32_t i = 0; i < count; i++){
+		const uint8_t* bytes = buffer + i * INA234_TRACE_RECORD_SIZE;
+		INA234_TraceRecord* record = &self->records[self->head % self->capacity];
+		
+		record->timestamp = bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+		record->duration = bytes[4] | ((uint16_t)bytes[5] << 8);
+		record->address = bytes[6];
+		record->reg = bytes[7];
+		record->flags = bytes[8];
+		record->size = bytes[9];
+		record->data[0] = bytes[10];
+		record->data[1] = bytes[11];
+		self->head++;
+	}
+	return INA234_Trace_count(self);
+}
+
+/*!
+    @brief  Answer the transactions of an ina234 object from the records, the oldest first, instead of the bus.
+						Each transaction must match the next record (address, register, direction and size): it then gets the recorded data and status.
+						Otherwise, and after the last record, it fails and is counted in ina234_trace::mismatches. The event records are skipped, unless the driver emits the same event
+						(it sets ::INA234_Trace_event as the event hook). ina234_trace::time is the timestamp of the next record, so a clock that returns it (see ::INA234_setClock())
+						gives the driver the times it read while recording, and its timing repeats the recorded one.
+						Call ::INA234_init() before, since its transactions are usually not in the trace. To replay a trace of many ina234 objects, call it for each of them before the run.
+    @param  self
+            A pointer to the trace object (struct)
+		@param  ina234
+						A pointer to the ina234 object (struct)
+		@return	Ths status of attaching
+		@retval ::STATUS_OK in case of success
+		@retval ::STATUS_TimeOut if ::INA234_TRACE_DEVICES ina234 objects with other addresses are already attached. The ina234 object is left untouched.
+*/
+Status INA234_Trace_replay(INA234_Trace* self, INA234* ina234){
+	if(STATUS_OK != __INA234_Trace_save(self, ina234))
+		return STATUS_TimeOut;
+	
+	self->mode = TRACE_REPLAY;
+	self->cursor = self->head > self->capacity ? self->head - self->capacity : 0;
+	self->replayed = 0;
+	self->mismatches = 0;
+	INA234_TraceRecord record;
+	if(INA234_Trace_get(self, 0, &record))
+		self->time = record.timestamp;
+	INA234_setTransfer(ina234, __INA234_Trace_play, self);
+	INA234_setEventHook(ina234, INA234_Trace_event, self);
+	return STATUS_OK;
+}
+
+/*!
+    @brief  Record an event of the driver. It is the ::INA234_EventHook of the traces: ::INA234_Trace_attach() sets it on the ina234 objects, and it can be given
+						to ::INA234_Bus_setEventHook() (and to ::INA234_setEventHook() of the objects that are not attached) with the trace as the context. It can be called from the interrupts.
+						In a replay, an event equal to the next record moves the replay clock past it (see ::INA234_Trace_replay()).
+    @param  context
+            A pointer to the trace object (struct)
+		@param  DevAddress
+						I2C address of the device (shifted, as given to the HAL)
+		@param  event
+						The event
+		@param  phase
+						Begin or end of a span, or an instant
+		@param  argument
+						Depends on the event (see ::INA234_EventHook)
+*/
+void INA234_Trace_event(void* context, uint16_t DevAddress, EventType event, EventPhase phase, uint16_t argument){
+	INA234_Trace* self = (INA234_Trace*)context;
+	INA234_TraceRecord record;
+	
+	if(self->mode == TRACE_REPLAY){
+		uint32_t first = self->head > self->capacity ? self->head - self->capacity : 0;
+		if(INA234_Trace_get(self, self->cursor - first, &record) && (record.flags & INA234_TRACE_EVENT) && record.address == (uint8_t)DevAddress &&
+				record.reg == (uint8_t)event && record.size == (uint8_t)phase){
+			self->cursor++;
+			__INA234_Trace_follow(self, &record);
+		}
+		return;
+	}
+	if(self->mode != TRACE_RECORD)
+		return;
+	
+	record.timestamp = __INA234_Trace_now(self);
+	record.duration = 0;
+	record.address = (uint8_t)DevAddress;
+	record.reg = (uint8_t)event;
+	record.flags = INA234_TRACE_EVENT;
+	record.size = (uint8_t)phase;
+	record.data[0] = argument & 0xFF;
+	record.data[1] = argument >> 8;
+	__INA234_Trace_push(self, &record);
+}
@@ -0,0 +1,88 @@
+/*!
+ * @file ina234_trace.h
+ *
+ * Optional trace of the I2C transactions of the INA234 library (see ina234.h), to reproduce the behavior of a field unit in the lab.
+ * ::INA234_Trace_attach puts a tracing transport in front of the register reads and writes (and the general call reset) of an
+ * ina234 object: each transaction is recorded with its address, register, data, status and time into a ring of compact records.
+ * The records can be serialized, sent to a PC and loaded into a trace there. ::INA234_Trace_replay then answers the same
+ * transactions of the driver with the recorded data and status, without any chip, so a run can be repeated deterministically.
+ * ::INA234_Trace_event can also be given to ::INA234_setEventHook and ::INA234_Bus_setEventHook, so the steps of the driver (acquisitions, waits,
+ * interrupts, bus queue waits) are recorded on the same timeline; host/trace2json turns a serialized trace into a Chrome / Perfetto trace.
+ *
+ */
+
+#ifndef __INA234_TRACE_H_
+#define __INA234_TRACE_H_
+
+#include "ina234.h"
+
+#define INA234_TRACE_RECORD_SIZE		12					// Size of a serialized record in bytes
+#define INA234_TRACE_DEVICES				8						// Number of the ina234 objects that can be attached to one trace
+
+#define INA234_TRACE_WRITE					0x01				// Record flags
+#define INA234_TRACE_ERROR					0x02
+#define INA234_TRACE_EVENT					0x04				// An event of ::INA234_Trace_event instead of a transaction
+
+typedef enum TraceMode			{TRACE_OFF, TRACE_RECORD, TRACE_REPLAY} TraceMode;
+
+/*!
+    @brief  One recorded transaction, or event (with ::INA234_TRACE_EVENT)
+*/
+typedef struct ina234_trace_record{
+	
+	uint32_t	timestamp;					/*!< Start of the transaction (in us) from the clock of the trace */
+	uint16_t	duration;						/*!< Duration of the transaction in us (0xFFFF for longer ones), 0 for the events */
+	uint8_t		address;						/*!< I2C address (shifted, as given to the HAL). 0 for the general call. */
+	uint8_t		reg;								/*!< Register address, or the ::EventType */
+	uint8_t		flags;							/*!< ::INA234_TRACE_WRITE, ::INA234_TRACE_ERROR and ::INA234_TRACE_EVENT */
+	uint8_t		size;								/*!< Number of data bytes (0 for the general call), or the ::EventPhase */
+	uint8_t		data[2];						/*!< The bytes on the bus: read from the chip, or written to it. The argument of the events (little endian). */
+	
+} INA234_TraceRecord;
+
+/*!
+    @brief  The transport of an attached ina234 object, in front of which the trace was put
+*/
+typedef struct ina234_trace_device{
+	
+	uint16_t						address;				/*!< I2C address (shifted) */
+	I2C_HandleTypeDef*	hi2c;
+	INA234_Transfer			transfer;
+	void*								transfer_context;
+	
+} INA234_TraceDevice;
+
+/*!
+    @brief  Class (struct) of a trace
+*/
+typedef struct ina234_trace{
+	
+	INA234_TraceRecord*	records;		/*!< Ring storage given by the user */
+	uint32_t		capacity;
+	uint32_t		head;								/*!< Number of the records written since the start. The ring keeps the last ina234_trace::capacity ones. */
+	INA234_Clock	clock;						/*!< Microsecond clock of the timestamps. If it is NULL, HAL_GetTick() is used. */
+	TraceMode		mode;
+	
+	// The transports in front of which the trace was attached
+	INA234_TraceDevice	devices[INA234_TRACE_DEVICES];
+	uint8_t			devices_count;
+	
+	// Replay
+	uint32_t		cursor;							/*!< Number of the next record to replay */
+	uint32_t		time;								/*!< Timestamp of the next record to replay (the end of the last one at the end), for a clock that follows the trace */
+	uint32_t		replayed;
+	uint32_t		mismatches;					/*!< Transactions that did not match the next record (address, register, direction or size) */
+	
+} INA234_Trace;
+
+void			INA234_Trace_init(INA234_Trace* self, INA234_TraceRecord* records, uint32_t capacity, INA234_Clock clock);
+Status		INA234_Trace_attach(INA234_Trace* self, INA234* ina234);
+void			INA234_Trace_detach(INA234_Trace* self, INA234* ina234);
+uint32_t	INA234_Trace_count(const INA234_Trace* self);
+uint8_t		INA234_Trace_get(const INA234_Trace* self, uint32_t index, INA234_TraceRecord* record);
+uint32_t	INA234_Trace_serialize(const INA234_Trace* self, uint8_t* buffer, uint32_t size);
+uint32_t	INA234_Trace_load(INA234_Trace* self, const uint8_t* buffer, uint32_t length);
+Status		INA234_Trace_replay(INA234_Trace* self, INA234* ina234);
+void			INA234_Trace_event(void* context, uint16_t DevAddress, EventType event, EventPhase phase, uint16_t argument);
+
+#endif
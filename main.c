@@ -25,9 +25,13 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "ina234.h"
+#include "ina234_report.h"
 
-#define SAMPLES_PER_BATCH 500
+#define SAMPLES_PER_BATCH 500 // maximum batch size
+#define MIN_SAMPLES_PER_BATCH	20
+#define TX_BLOCKS					4
 #define TIME_CALC			0
+#define ALERT_PIN			GPIO_PIN_0 // EXTI line connected to the alert pin of INA234
 
 // Print setting -------------------
 #define DEBUG_ENABLE  1
@@ -37,6 +41,7 @@
 
 #if DEBUG_ENABLE
   #include "stdarg.h"
+  #include "stdio.h"
   #include "string.h"
   #include "stdlib.h"
 
@@ -66,15 +71,40 @@
 
 /* USER CODE BEGIN PV */
 INA234 ina234;
+INA234_Sample sample;
+INA234_AlertEvent alert_event;
+INA234_Deadband deadband;
+INA234_ProtoEncoder encoder;
+INA234_ProtoFrame frame;
+uint8_t FrameBuffer[INA234_PROTO_MAX_FRAME];
+uint16_t FrameLength;
 
 #if TIME_CALC
 	uint32_t ptime = 0;
 	double conv_time = 0;
 	double sampling_rate = 0.0;
+	uint32_t sprintf_cycles = 0;
+	uint32_t format_cycles = 0;
 #endif
 
+char Line[INA234_REPORT_LINE_SIZE];
+uint16_t LineLength;
+
 uint8_t raw[2];
-uint8_t TxBuffer[SAMPLES_PER_BATCH*2];
+
+// Batches of raw samples handed from the reading loop to the USB transmitter
+uint32_t PoolStorage[INA234_POOL_STORAGE_SIZE(SAMPLES_PER_BATCH*2, TX_BLOCKS) / 4];
+INA234_Pool pool;
+INA234_BlockQueue tx_queue;
+INA234_Block* tx_block = NULL;
+uint8_t tx_sent = 0;
+INA234_Block* batch = NULL;
+INA234_BatchControl batch_control;
+uint32_t fill_start;
+
+#if USB_DEBUG
+	extern USBD_HandleTypeDef hUsbDeviceFS;
+#endif
 
 /* USER CODE END PV */
 
@@ -82,6 +112,11 @@ uint8_t TxBuffer[SAMPLES_PER_BATCH*2];
 void SystemClock_Config(void);
 /* USER CODE BEGIN PFP */
 void DEBUG(const char* _str, ...);
+void DEBUG_WRITE(uint8_t* buffer, uint16_t size);
+void Idle(void);
+uint8_t UsbIdle(void);
+void ServiceTransmit(void);
+void SendFrame(INA234_ProtoFrame* frame);
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
@@ -124,10 +159,18 @@ int main(void)
 	
 	HAL_Delay(2000);
 	
+	#if TIME_CALC
+		// Cycle counter to compare INA234_Report_format with sprintf
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->CYCCNT = 0;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	#endif
+	
 	//INA234_SoftResetAll(&ina234);
 	//HAL_Delay(2000);
 	
-	if(STATUS_OK == INA234_init(&ina234, 0x48, &hi2c1, 1, RANGE_20_48mV, NADC_1, CTIME_140us, CTIME_140us, MODE_CONTINUOUS_SHUNT) &&
+	if(1 == INA234_probe(&hi2c1, &ina234, 1) &&
+		 STATUS_OK == INA234_init(&ina234, ina234.I2C_ADDR >> 1, &hi2c1, 1, RANGE_20_48mV, NADC_1, CTIME_140us, CTIME_140us, MODE_CONTINUOUS_SHUNT) &&
 		 STATUS_OK == INA234_alert_init(&ina234, ALERT_SHUNT_OVER_LIMIT, ALERT_ACTIVE_LOW, ALERT_TRANSPARENT, ALERT_CONV_DISABLE, 2.5)){
 		
 		//*/
@@ -135,14 +178,21 @@ int main(void)
 			DEBUG("      Device ID is 0x%04X \r\n", INA234_getDevID(&ina234));
 		//*/
 		
+		// Report only the changes bigger than 2 LSBs, or at least once per 5 seconds
+		INA234_Deadband_init(&deadband, 2, 2, 2, 2, 5000000);
+		INA234_Proto_initEncoder(&encoder);
+		INA234_Pool_init(&pool, PoolStorage, SAMPLES_PER_BATCH*2, TX_BLOCKS);
+		INA234_BlockQueue_init(&tx_queue);
+		INA234_Batch_init(&batch_control, MIN_SAMPLES_PER_BATCH, SAMPLES_PER_BATCH);
+		
+		/*/ Wake up on every conversion (for "Sleep until alert") ---
+			INA234_armAlert(&ina234, ALERT_CONV_ENABLE);
+		//*/
+		
 		while(1){
 			
 			/*/ Read seperately ----------------------------
-				INA234_getShuntVoltage(&ina234);
-				INA234_getBusVoltage(&ina234);
-				INA234_getPower(&ina234);
-				INA234_getCurrent(&ina234);
-				DEBUG("Shunt Voltage: %.3fmV \t Bus Voltage: %.2fV \t Current: %.2fA \t Power: %.2fW\r\n", ina234.ShuntVoltage, ina234.BusVoltage, ina234.Current, ina234.Power);
+				DEBUG("Shunt Voltage: %.3fmV \t Bus Voltage: %.2fV \t Current: %.2fA \t Power: %.2fW\r\n", INA234_getShuntVoltage(&ina234), INA234_getBusVoltage(&ina234), INA234_getCurrent(&ina234), INA234_getPower(&ina234));
 				HAL_Delay(200);
 			//*/
 			
@@ -150,21 +200,66 @@ int main(void)
 				#if TIME_CALC
 					ptime = HAL_GetTick();
 				#endif
-				for(int32_t i=0; i<SAMPLES_PER_BATCH; i++){
-					HAL_I2C_Mem_Read(&hi2c1, 0x48<<1, SHUNT_VOLTAGE_REGISTER, I2C_MEMADD_SIZE_8BIT, raw, 2, 100);
-					TxBuffer[i * 2 + 0] = raw[0];
-					TxBuffer[i * 2 + 1] = raw[1];
+				batch = INA234_Pool_alloc(&pool);
+				// ServiceTransmit() can resize the batches while this one is filled, so it keeps the size it was started with
+				uint16_t n = batch_control.size;
+				if(batch){
+					fill_start = HAL_GetTick();
+					for(int32_t i=0; i<n; i++){
+						HAL_I2C_Mem_Read(&hi2c1, ina234.I2C_ADDR, SHUNT_VOLTAGE_REGISTER, I2C_MEMADD_SIZE_8BIT, raw, 2, 100);
+						batch->data[i * 2 + 0] = raw[0];
+						batch->data[i * 2 + 1] = raw[1];
+						// Poll the transfer while filling, so its completion is seen when it happens and not after the whole batch
+						ServiceTransmit();
+					}
+					batch->length = n*2;
+					INA234_Batch_filled(&batch_control, n, HAL_GetTick() - fill_start);
+					INA234_BlockQueue_put(&tx_queue, batch);
 				}
-				CDC_Transmit_FS(TxBuffer, SAMPLES_PER_BATCH*2);
+				ServiceTransmit();
 				#if TIME_CALC
-					conv_time = (HAL_GetTick() - ptime) / ((double)SAMPLES_PER_BATCH);
+					conv_time = (HAL_GetTick() - ptime) / ((double)n);
 					sampling_rate = 1/conv_time;
 				#endif
 			//*/
 			
+			/*/ Sleep until alert --------------------------
+				if(STATUS_OK == INA234_sleepUntilAlert(&ina234, Idle, 0, &alert_event)){
+					// The event is only filled on an alert. The limit alert goes first, so the host sees it before the sample that reached the limit.
+					if(alert_event.limit_reached){
+						INA234_Report_alertFrame(&frame, 0, &ina234, &alert_event);
+						SendFrame(&frame);
+					}
+					if(alert_event.data_ready && STATUS_OK == INA234_acquire(&ina234, &sample)){
+						INA234_Report_sampleFrame(&frame, 0, &sample);
+						SendFrame(&frame);
+					}
+				}
+			//*/
+			
+			/*/ Binary telemetry ---------------------------
+				if(STATUS_OK == INA234_acquire(&ina234, &sample) && sample.fresh && INA234_Deadband_check(&deadband, &sample)){
+					INA234_Report_sampleFrame(&frame, 0, &sample);
+					SendFrame(&frame);
+				}
+			//*/
+			
 			//*/ Read all -----------------------------------
 				INA234_readAll(&ina234);
-				DEBUG("Shunt Voltage: %.3fmV \t Bus Voltage: %.2fV \t Current: %.2fA \t Power: %.2fW\r\n", ina234.ShuntVoltage, ina234.BusVoltage, ina234.Current, ina234.Power);
+				INA234_getPublished(&ina234, &sample);
+				if(INA234_Deadband_check(&deadband, &sample)){
+					#if TIME_CALC
+						ptime = DWT->CYCCNT;
+						sprintf(Line, "Shunt Voltage: %.3fmV \t Bus Voltage: %.2fV \t Current: %.2fA \t Power: %.2fW\r\n", INA234_getValue(&ina234, CHANNEL_SHUNT_VOLTAGE), INA234_getValue(&ina234, CHANNEL_BUS_VOLTAGE), INA234_getValue(&ina234, CHANNEL_CURRENT), INA234_getValue(&ina234, CHANNEL_POWER));
+						sprintf_cycles = DWT->CYCCNT - ptime;
+						ptime = DWT->CYCCNT;
+					#endif
+					LineLength = INA234_Report_format(Line, &sample);
+					#if TIME_CALC
+						format_cycles = DWT->CYCCNT - ptime;
+					#endif
+					DEBUG_WRITE((uint8_t*)Line, LineLength);
+				}
 				HAL_Delay(200);
 			//*/
 			
@@ -234,6 +329,47 @@ void SystemClock_Config(void)
 
 /* USER CODE BEGIN 4 */
 
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin){
+	if(GPIO_Pin == ALERT_PIN)
+		INA234_alertISR(&ina234);
+}
+
+void Idle(void){
+	// Stop the tick so only the alert (or another peripheral) wakes the MCU up
+	HAL_SuspendTick();
+	HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+	HAL_ResumeTick();
+}
+
+uint8_t UsbIdle(void){
+	// No transfer of the CDC class in progress
+	return ((USBD_CDC_HandleTypeDef*)hUsbDeviceFS.pClassData)->TxState == 0;
+}
+
+void ServiceTransmit(void){
+	// Free the sent batch and adapt the batch size
+	if(tx_block && tx_sent && UsbIdle()){
+		INA234_Batch_transmitted(&batch_control, HAL_GetTick() - tx_block->timestamp, tx_queue.length);
+		INA234_Pool_free(&pool, tx_block);
+		tx_block = NULL;
+		tx_sent = 0;
+	}
+	// Start sending the next batch. It is in flight only if the CDC class accepted it, otherwise it is retried on the next call.
+	if(!tx_block)
+		tx_block = INA234_BlockQueue_get(&tx_queue);
+	if(tx_block && !tx_sent && USBD_OK == CDC_Transmit_FS(tx_block->data, tx_block->length)){
+		tx_block->timestamp = HAL_GetTick();
+		tx_sent = 1;
+	}
+}
+
+void SendFrame(INA234_ProtoFrame* frame){
+	// Encode once (each encoding takes a sequence number), and only after the previous frame has left the buffer
+	while(!UsbIdle());
+	FrameLength = INA234_Proto_encode(&encoder, frame, FrameBuffer);
+	while(USBD_BUSY == CDC_Transmit_FS(FrameBuffer, FrameLength));
+}
+
 void DEBUG(const char* _str, ...){
   #if DEBUG_ENABLE
     va_list args;
@@ -241,10 +377,16 @@ void DEBUG(const char* _str, ...){
     char buffer[150];
     memset(buffer, 0, 150);
     int buffer_size = vsprintf(buffer, _str, args);
+    DEBUG_WRITE((uint8_t*) buffer, buffer_size);
+  #endif
+}
+
+void DEBUG_WRITE(uint8_t* buffer, uint16_t size){
+  #if DEBUG_ENABLE
     #if USB_DEBUG
-      CDC_Transmit_FS((uint8_t*) buffer, buffer_size);
+      CDC_Transmit_FS(buffer, size);
     #else
-      HAL_UART_Transmit(DEBUG_UART, (uint8_t*)buffer, buffer_size, 5000);
+      HAL_UART_Transmit(DEBUG_UART, buffer, size, 5000);
     #endif
   #endif
 }